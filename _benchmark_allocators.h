@@ -0,0 +1,422 @@
+#pragma once
+
+#include <random>
+#include <thread>
+
+#include "_test.h"
+#include "array.h"
+#include "allocator_arena.h"
+#include "allocator_stack.h"
+#include "allocator_stack_ring.h"
+#include "allocator_linear.h"
+#include "allocator_thread_cache.h"
+#include "benchmark.h"
+
+#define ALLOCATOR_GIVEN_TIME 300
+
+namespace jot
+{
+namespace benchmarks
+{
+    //Each benchmark is run for every allocator both with and without writing to the allocated memory.
+    //Arena_Allocator and Linear_Allocator are reset at the end of every run (the reset is part of the measured time)
+    // since they cannot reclaim memory freed out of order. The fixed buffer allocators are given a buffer big enough
+    // that they never fall back to their parent.
+
+    //Allocates batch size blocks of random small sizes then frees them in the reverse order.
+    //Reports time per allocation (allocate + deallocate)
+    static void benchmark_allocator_lifo();
+
+    //Allocates batch size blocks of random small sizes then frees them in the same order.
+    //Reports time per allocation (allocate + deallocate)
+    static void benchmark_allocator_fifo();
+
+    //Allocates batch size blocks of random small sizes then frees them in a random order.
+    //Reports time per allocation (allocate + deallocate)
+    static void benchmark_allocator_random_free();
+
+    //Simulates batch size arrays growing one after the other from 16 to 1024 bytes. Each growth first attempts
+    // resize and falls back to allocate, copy, deallocate. The arrays are freed in reverse order at the end.
+    //Reports time per growth
+    static void benchmark_allocator_resize();
+
+    //Keeps a window of batch size / 4 live blocks with sizes from 8 to 4096 (log uniform). Every allocation
+    // past the window frees a random live block. Models general purpose usage.
+    //Reports time per allocation (allocate + deallocate)
+    static void benchmark_allocator_mixed();
+
+    //Every thread repeatedly allocates batch size blocks of random small sizes then frees them in a random order.
+    // Compares Thread_Caching_Allocator shared by all threads against malloc at 1 to hardware_concurrency threads.
+    //Reports time per allocation (allocate + deallocate) of all threads together and the speedup over one thread
+    static void benchmark_allocator_threads();
+
+    //Runs all of the above
+    static void benchmark_allocators();
+}
+}
+
+namespace jot
+{
+namespace benchmarks
+{
+    namespace allocator_benchmark_internal
+    {
+        static constexpr isize BUFFER_SIZE = 16 * memory_constants::MEBI_BYTE;
+        static constexpr isize ALIGN = 8;
+
+        struct Bench_Data
+        {
+            Array<isize> sizes;
+            Array<isize> free_order; //permutation of 0..batch_size
+            Array<isize> random;     //random numbers used to pick live blocks
+            Array<void*> blocks;
+        };
+
+        static Bench_Data make_bench_data(isize batch_size, isize min_size, isize max_size)
+        {
+            std::mt19937 random(42);
+            Bench_Data bench_data;
+            resize(&bench_data.sizes, batch_size);
+            resize(&bench_data.free_order, batch_size);
+            resize(&bench_data.random, batch_size);
+            resize(&bench_data.blocks, batch_size);
+
+            //log uniform so that the small sizes are as common as they are in practice
+            std::uniform_real_distribution<double> log_size(log2((double) min_size), log2((double) max_size));
+            for(isize i = 0; i < batch_size; i++)
+            {
+                bench_data.sizes[i] = (isize) exp2(log_size(random));
+                bench_data.free_order[i] = i;
+                bench_data.random[i] = (isize) (random() & 0x7FFFFFFF);
+            }
+
+            for(isize i = 0; i < batch_size - 1; i++)
+            {
+                isize j = (isize) (random() % (uint64_t) (batch_size - i));
+                swap(&bench_data.free_order[i], &bench_data.free_order[i + j]);
+            }
+
+            return bench_data;
+        }
+
+        static void touch(void* block, isize size)
+        {
+            if(block != nullptr)
+                memset(block, 0x55, (size_t) size);
+        }
+
+        //Calls bench_one(name, allocator, reset) for every benchmarked allocator
+        template <typename Fn>
+        static void for_each_allocator(Fn bench_one)
+        {
+            Array<uint8_t> buffer;
+            resize(&buffer, BUFFER_SIZE);
+
+            {
+                Malloc_Allocator alloc;
+                bench_one("malloc:            ", &alloc, [&]{});
+            }
+            {
+                Arena_Allocator alloc;
+                bench_one("arena:             ", &alloc, [&]{ alloc.reset(); });
+            }
+            {
+                Stack_Allocator alloc(data(&buffer), size(buffer));
+                bench_one("stack:             ", &alloc, [&]{});
+            }
+            {
+                Stack_Ring_Allocator alloc(data(&buffer), size(buffer));
+                bench_one("stack ring:        ", &alloc, [&]{});
+            }
+            {
+                Linear_Allocator alloc(data(&buffer), size(buffer));
+                bench_one("linear:            ", &alloc, [&]{ alloc.reset(); });
+            }
+        }
+
+        //Runs pattern(allocator, touch) for every allocator with and without touching and prints the results
+        template <typename Pattern>
+        static void bench_pattern(const char* name, isize batch_size, isize runs_mult, Pattern pattern)
+        {
+            for(bool touch : {false, true})
+            {
+                println("\n", name, " ", batch_size, touch ? " touched" : "");
+                for_each_allocator([&](const char* allocator_name, Allocator* alloc, auto reset){
+                    Bench_Result result = benchmark(ALLOCATOR_GIVEN_TIME, [&]{
+                        pattern(alloc, touch);
+                        reset();
+                        read_write_barrier();
+                        return true;
+                    }, runs_mult);
+
+                    println(allocator_name, result);
+                });
+            }
+        }
+    }
+
+    static void benchmark_allocator_lifo()
+    {
+        using namespace allocator_benchmark_internal;
+        const auto bench = [&](isize batch_size){
+            Bench_Data bench_data = make_bench_data(batch_size, 8, 256);
+            bench_pattern("LIFO", batch_size, batch_size, [&](Allocator* alloc, bool should_touch){
+                for(isize i = 0; i < batch_size; i++)
+                {
+                    bench_data.blocks[i] = alloc->allocate(bench_data.sizes[i], ALIGN, GET_LINE_INFO());
+                    if(should_touch)
+                        touch(bench_data.blocks[i], bench_data.sizes[i]);
+                    do_no_optimize(bench_data.blocks[i]);
+                }
+
+                for(isize i = batch_size; i-- > 0; )
+                    alloc->deallocate(bench_data.blocks[i], bench_data.sizes[i], ALIGN, GET_LINE_INFO());
+            });
+        };
+
+        bench(10);
+        bench(100);
+        bench(1000);
+        bench(10000);
+    }
+
+    static void benchmark_allocator_fifo()
+    {
+        using namespace allocator_benchmark_internal;
+        const auto bench = [&](isize batch_size){
+            Bench_Data bench_data = make_bench_data(batch_size, 8, 256);
+            bench_pattern("FIFO", batch_size, batch_size, [&](Allocator* alloc, bool should_touch){
+                for(isize i = 0; i < batch_size; i++)
+                {
+                    bench_data.blocks[i] = alloc->allocate(bench_data.sizes[i], ALIGN, GET_LINE_INFO());
+                    if(should_touch)
+                        touch(bench_data.blocks[i], bench_data.sizes[i]);
+                    do_no_optimize(bench_data.blocks[i]);
+                }
+
+                for(isize i = 0; i < batch_size; i++)
+                    alloc->deallocate(bench_data.blocks[i], bench_data.sizes[i], ALIGN, GET_LINE_INFO());
+            });
+        };
+
+        bench(10);
+        bench(100);
+        bench(1000);
+        bench(10000);
+    }
+
+    static void benchmark_allocator_random_free()
+    {
+        using namespace allocator_benchmark_internal;
+        const auto bench = [&](isize batch_size){
+            Bench_Data bench_data = make_bench_data(batch_size, 8, 256);
+            bench_pattern("RANDOM FREE", batch_size, batch_size, [&](Allocator* alloc, bool should_touch){
+                for(isize i = 0; i < batch_size; i++)
+                {
+                    bench_data.blocks[i] = alloc->allocate(bench_data.sizes[i], ALIGN, GET_LINE_INFO());
+                    if(should_touch)
+                        touch(bench_data.blocks[i], bench_data.sizes[i]);
+                    do_no_optimize(bench_data.blocks[i]);
+                }
+
+                for(isize i = 0; i < batch_size; i++)
+                {
+                    isize index = bench_data.free_order[i];
+                    alloc->deallocate(bench_data.blocks[index], bench_data.sizes[index], ALIGN, GET_LINE_INFO());
+                }
+            });
+        };
+
+        bench(10);
+        bench(100);
+        bench(1000);
+        bench(10000);
+    }
+
+    static void benchmark_allocator_resize()
+    {
+        using namespace allocator_benchmark_internal;
+        const isize FROM_SIZE = 16;
+        const isize TO_SIZE = 1024;
+        const isize GROWTHS_PER_ARRAY = 6; //16 -> 1024
+
+        const auto bench = [&](isize batch_size){
+            Bench_Data bench_data = make_bench_data(batch_size, 8, 8);
+            bench_pattern("RESIZE", batch_size, batch_size * GROWTHS_PER_ARRAY, [&](Allocator* alloc, bool should_touch){
+                for(isize i = 0; i < batch_size; i++)
+                {
+                    void* block = alloc->allocate(FROM_SIZE, ALIGN, GET_LINE_INFO());
+                    if(should_touch)
+                        touch(block, FROM_SIZE);
+
+                    for(isize size = FROM_SIZE; size < TO_SIZE; size *= 2)
+                    {
+                        if(alloc->resize(block, size, size * 2, ALIGN, GET_LINE_INFO()) == false)
+                        {
+                            void* new_block = alloc->allocate(size * 2, ALIGN, GET_LINE_INFO());
+                            if(should_touch && new_block != nullptr)
+                                memcpy(new_block, block, (size_t) size);
+                            alloc->deallocate(block, size, ALIGN, GET_LINE_INFO());
+                            block = new_block;
+                        }
+
+                        if(should_touch)
+                            touch((uint8_t*) block + size, size);
+                        do_no_optimize(block);
+                    }
+
+                    bench_data.blocks[i] = block;
+                }
+
+                for(isize i = batch_size; i-- > 0; )
+                    alloc->deallocate(bench_data.blocks[i], TO_SIZE, ALIGN, GET_LINE_INFO());
+            });
+        };
+
+        bench(10);
+        bench(100);
+        bench(1000);
+    }
+
+    static void benchmark_allocator_mixed()
+    {
+        using namespace allocator_benchmark_internal;
+        const auto bench = [&](isize batch_size){
+            Bench_Data bench_data = make_bench_data(batch_size, 8, 4096);
+            Array<isize> live_indices;
+            reserve(&live_indices, batch_size);
+
+            isize window = max(batch_size / 4, 1);
+            bench_pattern("MIXED", batch_size, batch_size, [&](Allocator* alloc, bool should_touch){
+                clear(&live_indices);
+                for(isize i = 0; i < batch_size; i++)
+                {
+                    if(size(live_indices) >= window)
+                    {
+                        isize live_i = bench_data.random[i] % size(live_indices);
+                        isize index = live_indices[live_i];
+                        alloc->deallocate(bench_data.blocks[index], bench_data.sizes[index], ALIGN, GET_LINE_INFO());
+                        swap(&live_indices[live_i], last(&live_indices));
+                        pop(&live_indices);
+                    }
+
+                    bench_data.blocks[i] = alloc->allocate(bench_data.sizes[i], ALIGN, GET_LINE_INFO());
+                    if(should_touch)
+                        touch(bench_data.blocks[i], bench_data.sizes[i]);
+                    do_no_optimize(bench_data.blocks[i]);
+                    push(&live_indices, i);
+                }
+
+                for(isize i = 0; i < size(live_indices); i++)
+                {
+                    isize index = live_indices[i];
+                    alloc->deallocate(bench_data.blocks[index], bench_data.sizes[index], ALIGN, GET_LINE_INFO());
+                }
+            });
+        };
+
+        bench(100);
+        bench(1000);
+        bench(10000);
+    }
+
+    static void benchmark_allocator_threads()
+    {
+        using namespace allocator_benchmark_internal;
+        const isize BATCH_SIZE = 1000;
+        const isize ROUNDS = 200;
+        const isize REPEATS = 3;
+        Bench_Data bench_data = make_bench_data(BATCH_SIZE, 8, 256);
+
+        isize max_threads = max((isize) std::thread::hardware_concurrency(), (isize) 1);
+        Array<isize> thread_counts;
+        for(isize count = 1; count < max_threads; count *= 2)
+            push(&thread_counts, count);
+        push(&thread_counts, max_threads);
+
+        //Each thread gets its own Malloc_Allocator since its stats are not thread safe. 
+        // The malloc underneath is shared either way.
+        const auto run_thread = [&](Allocator* alloc){
+            Array<void*> blocks;
+            resize(&blocks, BATCH_SIZE);
+            for(isize round = 0; round < ROUNDS; round++)
+            {
+                for(isize i = 0; i < BATCH_SIZE; i++)
+                {
+                    blocks[i] = alloc->allocate(bench_data.sizes[i], ALIGN, GET_LINE_INFO());
+                    do_no_optimize(blocks[i]);
+                }
+
+                for(isize i = 0; i < BATCH_SIZE; i++)
+                {
+                    isize index = bench_data.free_order[i];
+                    alloc->deallocate(blocks[index], bench_data.sizes[index], ALIGN, GET_LINE_INFO());
+                }
+            }
+        };
+
+        //Returns the best time in seconds of REPEATS runs
+        const auto measure = [&](isize thread_count, auto get_alloc){
+            double best = INFINITY;
+            for(isize repeat = 0; repeat < REPEATS; repeat++)
+            {
+                Array<std::thread> threads;
+                reserve(&threads, thread_count);
+                double time = ellapsed_time([&]{
+                    for(isize i = 0; i < thread_count; i++)
+                        push(&threads, std::thread(run_thread, get_alloc(i)));
+                    for(isize i = 0; i < thread_count; i++)
+                        threads[i].join();
+                });
+
+                if(best > time)
+                    best = time;
+            }
+            return best;
+        };
+
+        println("\nTHREADS ", BATCH_SIZE, " x ", ROUNDS, " per thread");
+        Array<Malloc_Allocator> mallocs;
+        resize(&mallocs, max_threads);
+        Thread_Caching_Allocator thread_caching;
+
+        double malloc_single = 0;
+        double caching_single = 0;
+        for(isize i = 0; i < size(thread_counts); i++)
+        {
+            isize thread_count = thread_counts[i];
+            double malloc_time = measure(thread_count, [&](isize thread_i) -> Allocator* { return &mallocs[thread_i]; });
+            double caching_time = measure(thread_count, [&](isize) -> Allocator* { return &thread_caching; });
+            if(thread_count == 1)
+            {
+                malloc_single = malloc_time;
+                caching_single = caching_time;
+            }
+
+            double allocations = (double) (thread_count * ROUNDS * BATCH_SIZE);
+            double malloc_speedup = malloc_single * (double) thread_count / malloc_time;
+            double caching_speedup = caching_single * (double) thread_count / caching_time;
+            println("threads: ", to_padded_format(thread_count, 3, ' '), 
+                " malloc: ", CFormat_Float{malloc_time * 1e9 / allocations, "%.2lf"}, "ns x", CFormat_Float{malloc_speedup, "%.2lf"},
+                " thread caching: ", CFormat_Float{caching_time * 1e9 / allocations, "%.2lf"}, "ns x", CFormat_Float{caching_speedup, "%.2lf"});
+        }
+    }
+
+    static void benchmark_allocators()
+    {
+        println("\n=== ignore below ===");
+        allocator_benchmark_internal::bench_pattern("WARM UP", 1000, 1000, [](Allocator* alloc, bool){
+            for(isize i = 0; i < 1000; i++)
+                alloc->deallocate(alloc->allocate(64, 8, GET_LINE_INFO()), 64, 8, GET_LINE_INFO());
+        });
+        println("=== ignore above ===\n");
+
+        benchmark_allocator_lifo();
+        benchmark_allocator_fifo();
+        benchmark_allocator_random_free();
+        benchmark_allocator_resize();
+        benchmark_allocator_mixed();
+        benchmark_allocator_threads();
+    }
+}
+}
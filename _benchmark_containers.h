@@ -11,6 +11,7 @@
 #include "weak_bucket_array.h"
 #include "slot_array.h"
 #include "hash_index.h"
+#include "allocator_arena.h"
 #include "benchmark.h"
 
 #define BENCHMARK_STD false
@@ -49,19 +50,13 @@ namespace benchmarks
     // purely for upper bound of whats possible
     //Reports time per batch ( (insert + insert + remove)*N )
     static void benchmark_cotainer_insert_remove_sections();
-}
-}
 
-namespace jot
-{
-    template <> struct Formattable<Bench_Result>
-    {
-        static
-        void format(String_Builder* appender, Bench_Result result) noexcept
-        {
-            format_into(appender, "{ ", CFormat_Float{result.mean_ms, "%.8lf"}, "ms ", result.deviation_ms, " δ ", to_padded_format(result.iters, 9, ' '), " i }");
-        }
-    };
+    //Builds many small arrays by pushing batch size elements into each and then destroys them. 
+    //Compares the default runtime dispatched allocator against arena allocator called virtually
+    // and the same arena given as the statically dispatched allocator type (Array<isize, Arena_Allocator>).
+    //Reports time per push
+    static void benchmark_array_allocator_dispatch();
+}
 }
 
 namespace jot
@@ -1132,5 +1127,68 @@ namespace benchmarks
         bench(10000, 100);
         bench(100000, 100);
     }
+
+    static void benchmark_array_allocator_dispatch()
+    {
+        const isize ARRAY_COUNT = 64;
+        const auto bench = [&](isize batch_size)
+        {
+            println("\nARRAY ALLOCATOR DISPATCH ", batch_size);
+
+            Bench_Result res_default = benchmark(GIVEN_TIME, [&]{
+                for(isize j = 0; j < ARRAY_COUNT; j++)
+                {
+                    Array<isize> array;
+                    for(isize i = 0; i < batch_size; i++)
+                        push(&array, i);
+                        
+                    do_no_optimize(array);
+                    read_write_barrier();
+                }
+                return true;
+            }, batch_size * ARRAY_COUNT);
+            
+            Arena_Allocator arena;
+            Bench_Result res_arena_virtual = benchmark(GIVEN_TIME, [&]{
+                for(isize j = 0; j < ARRAY_COUNT; j++)
+                {
+                    Array<isize> array(&arena);
+                    for(isize i = 0; i < batch_size; i++)
+                        push(&array, i);
+                        
+                    do_no_optimize(array);
+                    read_write_barrier();
+                }
+                arena.reset();
+                return true;
+            }, batch_size * ARRAY_COUNT);
+            
+            Bench_Result res_arena_static = benchmark(GIVEN_TIME, [&]{
+                for(isize j = 0; j < ARRAY_COUNT; j++)
+                {
+                    Array<isize, Arena_Allocator> array(&arena);
+                    for(isize i = 0; i < batch_size; i++)
+                        push(&array, i);
+                        
+                    do_no_optimize(array);
+                    read_write_barrier();
+                }
+                arena.reset();
+                return true;
+            }, batch_size * ARRAY_COUNT);
+
+            println("default:           ", res_default);
+            println("arena virtual:     ", res_arena_virtual);
+            println("arena static:      ", res_arena_static);
+        };
+        
+        println("\n=== ignore below ===");
+        bench(100);
+        println("=== ignore above ===\n");
+        bench(4);
+        bench(16);
+        bench(100);
+        bench(1000);
+    }
 }
 }
@@ -6,9 +6,107 @@
 #include "_test.h"
 #include "array.h"
 #include "format.h"
+#include "allocator_arena.h"
+#include "small_array.h"
+#include "allocator_failing.h"
 
 namespace jot
 {
+namespace tests
+{
+    struct Relocation_Counts
+    {
+        isize constructed = 0;
+        isize moved = 0;
+        isize destructed = 0;
+    };
+
+    struct Relocatable_Counter
+    {
+        isize val = 0;
+        Relocation_Counts* counts = nullptr;
+
+        Relocatable_Counter(isize val, Relocation_Counts* counts) noexcept : val(val), counts(counts) { counts->constructed ++; }
+        Relocatable_Counter(Relocatable_Counter const& other) noexcept : val(other.val), counts(other.counts) { counts->constructed ++; }
+        Relocatable_Counter(Relocatable_Counter && other) noexcept : val(other.val), counts(other.counts) { counts->constructed ++; counts->moved ++; }
+        ~Relocatable_Counter() noexcept { counts->destructed ++; }
+
+        Relocatable_Counter& operator=(Relocatable_Counter const&) noexcept = default;
+        Relocatable_Counter& operator=(Relocatable_Counter &&) noexcept = default;
+    };
+
+    //Forwards to parent counting the calls made to it
+    struct Call_Counting_Allocator : Allocator
+    {
+        Allocator* parent = default_allocator();
+        isize allocate_calls = 0;
+        isize deallocate_calls = 0;
+        isize resize_calls = 0;
+        isize relocate_calls = 0;
+
+        virtual void* allocate(isize size, isize align, Line_Info callee) noexcept override
+        {
+            allocate_calls ++;
+            return parent->allocate(size, align, callee);
+        }
+
+        virtual bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override
+        {
+            deallocate_calls ++;
+            return parent->deallocate(allocated, old_size, align, callee);
+        }
+
+        virtual bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            resize_calls ++;
+            return parent->resize(allocated, old_size, new_size, align, callee);
+        }
+
+        virtual void* relocate(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            relocate_calls ++;
+            return parent->relocate(allocated, old_size, new_size, align, callee);
+        }
+
+        virtual Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Call_Counting_Allocator";
+            stats.parent = parent;
+            return stats;
+        }
+    };
+
+    //Counts the calls that reached the arena virtually. Containers using Arena_Allocator as their static type
+    // should never make any.
+    struct Virtual_Call_Probe : Arena_Allocator
+    {
+        isize virtual_calls = 0;
+
+        using Arena_Allocator::Arena_Allocator;
+
+        virtual void* allocate(isize size, isize align, Line_Info callee) noexcept override
+        {
+            virtual_calls ++;
+            return Arena_Allocator::allocate(size, align, callee);
+        }
+
+        virtual bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override
+        {
+            virtual_calls ++;
+            return Arena_Allocator::deallocate(allocated, old_size, align, callee);
+        }
+
+        virtual bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            virtual_calls ++;
+            return Arena_Allocator::resize(allocated, old_size, new_size, align, callee);
+        }
+    };
+}
+
+    template<> constexpr bool is_trivially_relocatable<tests::Relocatable_Counter> = true;
+
 namespace tests
 {
     template<typename T>
@@ -239,6 +337,11 @@ namespace tests
 
             TEST(capacity(empty) >= 13);
             TEST(size(empty) == 3);
+
+            shrink_to_fit(&empty);
+            TEST(capacity(empty) == 3);
+            TEST(size(empty) == 3);
+            TEST(empty[2] == vals[0]);
         }
 
         after = trackers_alive();
@@ -640,6 +743,266 @@ namespace tests
         }
     }
 
+    template<typename T>
+    void test_array_static_allocator(Static_Array<T, 6> vals)
+    {
+        Arena_Allocator arena;
+        {
+            Array<T, Arena_Allocator> arr(&arena);
+            for(isize i = 0; i < 100; i++)
+                push(&arr, vals[i % 6]);
+
+            TEST(size(arr) == 100);
+            TEST(allocator(arr) == &arena);
+            TEST(arena.get_stats().bytes_allocated > 0);
+            for(isize i = 0; i < 100; i++)
+                TEST(arr[i] == vals[i % 6]);
+
+            Array<T, Arena_Allocator> copied = arr;
+            TEST(allocator(copied) == &arena);
+            TEST(size(copied) == 100);
+
+            Array<T, Arena_Allocator> moved = (Array<T, Arena_Allocator>&&) copied;
+            TEST(allocator(moved) == &arena);
+            TEST(allocator(copied) == &arena);
+            TEST(size(moved) == 100 && size(copied) == 0);
+
+            for(isize i = 0; i < 50; i++)
+                (void) pop(&moved);
+
+            insert(&moved, 0, vals[5]);
+            TEST(moved[0] == vals[5]);
+            TEST(moved[1] == vals[0]);
+            TEST(is_invariant(moved));
+
+            //Can also be passed where the allocator is expected as Allocator*
+            Array<T> runtime_dispatched(&arena);
+            push(&runtime_dispatched, vals[0]);
+            TEST(runtime_dispatched[0] == vals[0]);
+        }
+        TEST(arena.get_stats().bytes_allocated == 0);
+    }
+
+    template<typename T>
+    void test_small_array(Static_Array<T, 6> vals)
+    {
+        isize mem_before = default_allocator()->get_stats().bytes_allocated;
+        isize trackers_before = trackers_alive();
+        {
+            //stays inline up to N items
+            Small_Array<T, 4> arr;
+            TEST(is_inline(arr) && capacity(arr) == 4 && size(arr) == 0);
+            for(isize i = 0; i < 4; i++)
+                push(&arr, vals[i]);
+
+            TEST(is_inline(arr) && size(arr) == 4);
+            //items such as Test_String allocate on their own
+            bool items_allocate = __is_trivially_copyable(T) == false;
+            TEST(items_allocate || default_allocator()->get_stats().bytes_allocated == mem_before);
+
+            //spills past N
+            for(isize i = 4; i < 10; i++)
+                push(&arr, vals[i % 6]);
+
+            TEST(is_inline(arr) == false && size(arr) == 10);
+            for(isize i = 0; i < 10; i++)
+                TEST(arr[i] == vals[i % 6]);
+
+            //and comes back once shrunk
+            pop_multiple(&arr, 7);
+            shrink_to_fit(&arr);
+            TEST(is_inline(arr) && size(arr) == 3);
+            TEST(items_allocate || default_allocator()->get_stats().bytes_allocated == mem_before);
+            TEST(arr[0] == vals[0] && arr[1] == vals[1] && arr[2] == vals[2]);
+
+            //copies and moves of inline and spilled arrays
+            Small_Array<T, 4> copied = arr;
+            TEST(is_inline(copied) && size(copied) == 3 && copied[2] == vals[2]);
+
+            Small_Array<T, 4> spilled;
+            for(isize i = 0; i < 6; i++)
+                push(&spilled, vals[i]);
+
+            const T* spilled_data = data(spilled);
+            Small_Array<T, 4> moved = (Small_Array<T, 4>&&) spilled;
+            TEST(data(moved) == spilled_data && size(moved) == 6);
+            TEST(is_inline(spilled) && size(spilled) == 0);
+
+            Small_Array<T, 4> moved_inline = (Small_Array<T, 4>&&) copied;
+            TEST(is_inline(moved_inline) && size(moved_inline) == 3 && size(copied) == 0);
+
+            swap(&moved, &moved_inline);
+            TEST(is_inline(moved) && size(moved) == 3 && moved[0] == vals[0]);
+            TEST(is_inline(moved_inline) == false && size(moved_inline) == 6 && moved_inline[5] == vals[5]);
+
+            moved = moved_inline;
+            TEST(size(moved) == 6 && is_inline(moved) == false && moved[4] == vals[4]);
+            TEST(is_invariant(moved) && is_invariant(moved_inline));
+
+            //works wherever Array<T>* is expected
+            Array<T>* as_array = &moved_inline;
+            insert(as_array, 0, vals[3]);
+            TEST(size(moved_inline) == 7 && moved_inline[0] == vals[3] && moved_inline[1] == vals[0]);
+        }
+        TEST(trackers_alive() == trackers_before);
+        TEST(default_allocator()->get_stats().bytes_allocated == mem_before);
+    }
+
+    static
+    void test_small_string()
+    {
+        isize mem_before = default_allocator()->get_stats().bytes_allocated;
+        {
+            Small_String<16> str;
+            TEST(size(str) == 0 && data(str)[0] == '\0');
+
+            format_into(&str, "hello ", 42);
+            TEST(is_inline(str) && strcmp(data(str), "hello 42") == 0);
+            TEST(default_allocator()->get_stats().bytes_allocated == mem_before);
+
+            //exactly at the inline capacity the null termination still fits
+            push_multiple(&str, Slice<const char>{"12345678", 8});
+            TEST(is_inline(str) && size(str) == 16 && data(str)[16] == '\0');
+
+            format_into(&str, " and some longer text");
+            TEST(is_inline(str) == false);
+            TEST(strcmp(data(str), "hello 4212345678 and some longer text") == 0);
+
+            Small_String<16> copied = str;
+            TEST(strcmp(data(copied), data(str)) == 0);
+        }
+        TEST(default_allocator()->get_stats().bytes_allocated == mem_before);
+    }
+
+    static
+    void test_array_relocation()
+    {
+        static_assert(is_trivially_relocatable<i32>);
+        static_assert(is_trivially_relocatable<Array<Test_String>>);
+        static_assert(is_trivially_relocatable<Test_String> == false);
+        static_assert(is_trivially_relocatable<Small_Array<i32, 4>> == false);
+        static_assert(is_self_referential<Small_Array<i32, 4>>);
+        static_assert(is_self_referential<Array<i32>> == false);
+
+        //relocatable items are never moved or destroyed by growth
+        Relocation_Counts counts;
+        {
+            Array<Relocatable_Counter> arr;
+            for(isize i = 0; i < 100; i++)
+                push(&arr, Relocatable_Counter(i, &counts));
+
+            TEST(counts.constructed - counts.destructed == 100);
+            TEST(counts.moved == 100); //only the moves into the array by push
+
+            insert(&arr, 0, Relocatable_Counter(-1, &counts));
+            insert(&arr, 50, Relocatable_Counter(-2, &counts));
+            TEST(counts.moved == 102);
+            TEST(size(arr) == 102 && arr[0].val == -1 && arr[1].val == 0 && arr[50].val == -2 && arr[51].val == 49 && arr[101].val == 99);
+
+            isize destructed_before = counts.destructed;
+            TEST(remove(&arr, 50).val == -2);
+            TEST(remove(&arr, 0).val == -1);
+            TEST(counts.destructed - destructed_before == 4); //the removed items and their moved out copies
+            for(isize i = 0; i < 100; i++)
+                TEST(arr[i].val == i);
+
+            //shrinking destroys exactly the cut off items
+            destructed_before = counts.destructed;
+            set_capacity(&arr, 30);
+            TEST(size(arr) == 30 && capacity(arr) == 30);
+            TEST(counts.destructed - destructed_before == 70);
+            TEST(arr[29].val == 29);
+            TEST(counts.constructed - counts.destructed == 30);
+        }
+        TEST(counts.constructed == counts.destructed);
+
+        //Nested arrays are relocated the same way
+        isize mem_before = default_allocator()->get_stats().bytes_allocated;
+        {
+            Array<Array<i32>> nested;
+            for(i32 i = 0; i < 50; i++)
+            {
+                Array<i32> inner;
+                push(&inner, i);
+                push(&inner, i*2);
+                insert(&nested, 0, (Array<i32>&&) inner);
+            }
+
+            Array<i32> removed = remove(&nested, 10);
+            TEST(removed[0] == 39 && removed[1] == 78);
+            for(isize i = 0; i < size(nested); i++)
+            {
+                i32 expected = i < 10 ? (i32) (49 - i) : (i32) (48 - i);
+                TEST(size(nested[i]) == 2 && nested[i][0] == expected && nested[i][1] == expected*2);
+            }
+        }
+        TEST(default_allocator()->get_stats().bytes_allocated == mem_before);
+
+        //relocate is only used when the allocator can do better than copying the used items
+        static_assert(has_own_relocate<Malloc_Allocator>);
+        static_assert(has_own_relocate<Arena_Allocator> == false);
+        static_assert(has_own_relocate<Allocator> == false);
+        {
+            Call_Counting_Allocator counting;
+            Array<i32> arr(&counting);
+            set_capacity(&arr, 1000);
+            for(i32 i = 0; i < 10; i++)
+                push(&arr, i);
+
+            //mostly empty capacity is not relocated as a whole
+            set_capacity(&arr, 2000);
+            TEST(counting.relocate_calls == 0);
+            TEST(size(arr) == 10 && arr[9] == 9);
+
+            for(i32 i = 10; i < 2000; i++)
+                push(&arr, i);
+
+            set_capacity(&arr, 4000);
+            TEST(counting.relocate_calls == 1);
+            TEST(size(arr) == 2000 && arr[0] == 0 && arr[1999] == 1999);
+
+            //failed set_capacity leaves the array unchanged even when it would cut off items
+            Failing_Allocator failing;
+            counting.parent = &failing;
+            TEST(set_capacity_failing(&arr, 10) == false);
+            TEST(set_capacity_failing(&arr, 2500) == false);
+            TEST(set_capacity_failing(&arr, 8000) == false);
+            TEST(size(arr) == 2000 && capacity(arr) == 4000);
+            for(i32 i = 0; i < 2000; i++)
+                TEST(arr[i] == i);
+
+            counting.parent = default_allocator();
+        }
+
+        //relocating through a concrete allocator type makes no virtual calls
+        {
+            Virtual_Call_Probe probe(default_allocator(), 64 * 1024);
+            Arena_Allocator* arena = &probe;
+
+            //obtaining the first block calls allocate again virtually 
+            dispatch_deallocate(arena, dispatch_allocate(arena, 8, 8, GET_LINE_INFO()), 8, 8, GET_LINE_INFO());
+            probe.virtual_calls = 0;
+            {
+                Array<i64, Arena_Allocator> arr(arena);
+                for(i64 i = 0; i < 100; i++)
+                    push(&arr, i);
+
+                i64* relocated = (i64*) dispatch_allocate(arena, 16 * sizeof(i64), alignof(i64), GET_LINE_INFO());
+                for(i64 i = 0; i < 16; i++)
+                    relocated[i] = i;
+
+                relocated = (i64*) dispatch_relocate(arena, relocated, 16 * sizeof(i64), 64 * sizeof(i64), alignof(i64), GET_LINE_INFO());
+                TEST(relocated != nullptr);
+                for(i64 i = 0; i < 16; i++)
+                    TEST(relocated[i] == i);
+
+                dispatch_deallocate(arena, relocated, 64 * sizeof(i64), alignof(i64), GET_LINE_INFO());
+                TEST(size(arr) == 100 && arr[99] == 99);
+            }
+            TEST(probe.virtual_calls == 0);
+        }
+    }
+
     template<typename T>
     void test_array(Static_Array<T, 6> vals)
     {
@@ -648,6 +1011,8 @@ namespace tests
         test_array_resize<T>(dup(vals));
         test_array_reserve<T>(dup(vals));
         test_array_insert_remove<T>(dup(vals));
+        test_array_static_allocator<T>(dup(vals));
+        test_small_array<T>(dup(vals));
     }
 
     static
@@ -673,6 +1038,12 @@ namespace tests
 
         if(print) println("  type: Tracker<i32>");
 
+        if(print) println("  test_small_string()");
+        test_small_string();
+
+        if(print) println("  test_array_relocation()");
+        test_array_relocation();
+
 
         if(flags & Test_Flags::STRESS)
             test_array_stress(print);
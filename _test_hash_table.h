@@ -248,6 +248,36 @@ namespace tests
         println("linker: {}", format_linker(table));
     }
 
+    //checks that each control byte (including the mirrored ones past the end) agrees with its linker slot
+    template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
+    bool are_controls_consistent(Hash_Table<Key, Value, hash, equals> const& table)
+    {
+        using namespace hash_table_internal;
+        for(isize i = 0; i < table._linker_size; i++)
+        {
+            uint32_t link = table._linker[i];
+            uint8_t control = table._control[i];
+            if(link == EMPTY_LINK)
+            {
+                if(control != CONTROL_EMPTY)
+                    return false;
+            }
+            else if(link == GRAVESTONE_LINK)
+            {
+                if(control != CONTROL_GRAVESTONE)
+                    return false;
+            }
+            else if(control != control_tag(hash(table._keys[link], table._seed)))
+                return false;
+        }
+
+        for(isize i = 0; i < table._linker_size && i < CONTROL_GROUP_SIZE; i++)
+            if(table._control[table._linker_size + i] != table._control[i % table._linker_size])
+                return false;
+
+        return true;
+    }
+
     template <typename Table> 
     void test_hash_table_remove()
     {
@@ -346,6 +376,121 @@ namespace tests
         return (uint64_t) key.val;
     }   
     
+    static void test_hash_table_control()
+    {
+        using namespace hash_table_internal;
+        //tiny jump table so that groups wrap around it multiple times
+        Hash_Table_Growth growth = {};
+        growth.jump_table_base_size = 4;
+
+        isize memory_before = default_allocator()->get_stats().bytes_allocated;
+        {
+            Hash_Table<u64, u64, int_hash<u64>> table;
+            set(&table, 1, 10, growth);
+            TEST(jump_table_size(table) == 4);
+            TEST(are_controls_consistent(table));
+            TEST(get(table, 1, 0) == 10 && has(table, 2) == false);
+
+            for(u64 i = 0; i < 1000; i++)
+            {
+                set(&table, i, i*10, growth);
+                TEST(are_controls_consistent(table));
+            }
+
+            for(u64 i = 0; i < 1000; i += 3)
+                TEST(remove(&table, i));
+            for(u64 i = 1; i < 1000; i += 3)
+                TEST(mark_removed(&table, i) != -1);
+            TEST(are_controls_consistent(table));
+
+            for(u64 i = 0; i < 1000; i++)
+                TEST(has(table, i) == (i % 3 == 2));
+            for(u64 i = 2; i < 1000; i += 3)
+                TEST(get(table, i, 0) == i*10);
+
+            rehash(&table);
+            TEST(are_controls_consistent(table));
+            for(u64 i = 0; i < 1000; i++)
+                TEST(has(table, i) == (i % 3 == 2));
+
+            //keys differing only above the slot bits share a slot but mostly not a tag
+            Hash_Table<u64, u64, test_int_hash<u64>> same_slot;
+            for(u64 i = 0; i < 100; i++)
+                set(&same_slot, i << 20, i);
+
+            TEST(are_controls_consistent(same_slot));
+            for(u64 i = 0; i < 100; i++)
+                TEST(get(same_slot, i << 20, (u64) -1) == i);
+            TEST(has(same_slot, 0) && has(same_slot, 1) == false);
+        }
+        TEST(default_allocator()->get_stats().bytes_allocated == memory_before);
+    }
+
+    static isize counted_hash_calls = 0;
+    static uint64_t counted_hash(u64 const& key, uint64_t seed) 
+    {
+        counted_hash_calls ++;
+        return int_hash<u64>(key, seed);
+    }
+
+    static void test_hash_table_stored_hashes()
+    {
+        isize memory_before = default_allocator()->get_stats().bytes_allocated;
+        {
+            Hash_Table<u64, u64, counted_hash> table;
+            for(u64 i = 0; i < 100; i++)
+                set(&table, i, i);
+
+            //enabling on a filled table hashes the present entries
+            store_hashes(&table);
+            TEST(stores_hashes(table));
+            for(isize i = 0; i < size(table); i++)
+                TEST(table._hashes[i] == (uint32_t) int_hash<u64>(keys(table)[i], table._seed));
+
+            for(u64 i = 100; i < 1000; i++)
+                set(&table, i, i);
+            
+            //rehashes during the growth nor explicit ones call hash
+            isize calls_before = counted_hash_calls;
+            rehash(&table);
+            rehash(&table, jump_table_size(table) * 4, table._seed);
+            TEST(counted_hash_calls == calls_before);
+            TEST(are_controls_consistent(table));
+
+            for(u64 i = 0; i < 1000; i += 2)
+                TEST(remove(&table, i));
+            for(u64 i = 0; i < 1000; i++)
+                TEST(has(table, i) == (i % 2 == 1));
+            for(isize i = 0; i < size(table); i++)
+                TEST(table._hashes[i] == (uint32_t) int_hash<u64>(keys(table)[i], table._seed));
+
+            //changing seed has to rehash
+            calls_before = counted_hash_calls;
+            rehash(&table, jump_table_size(table), table._seed + 1);
+            TEST(counted_hash_calls == calls_before + size(table));
+            TEST(are_controls_consistent(table));
+            for(u64 i = 0; i < 1000; i++)
+                TEST(has(table, i) == (i % 2 == 1));
+
+            //iterating multiple entries of the same key hashes only once
+            for(u64 i = 0; i < 5; i++)
+                multi::add_another(&table, 1, 1000 + i);
+
+            calls_before = counted_hash_calls;
+            isize found_count = 0;
+            for(Hash_Found found = find(table, 1); found.entry_index != -1; found = multi::find_next(table, 1, found))
+                found_count ++;
+            TEST(found_count == 6);
+            TEST(counted_hash_calls == calls_before + 1);
+
+            store_hashes(&table, false);
+            TEST(stores_hashes(table) == false && table._hashes == nullptr);
+            for(u64 i = 1; i < 1000; i += 2)
+                TEST(get(table, i, 0) == i);
+        }
+        TEST(default_allocator()->get_stats().bytes_allocated == memory_before);
+    }
+
     void test_hash_table_stress(bool print)
     {
         using Val = Tracker<i32>;
@@ -376,6 +521,7 @@ namespace tests
             DO_REMOVE = 1,
             DO_MARK_REMOVED = 2,
             DO_MULTIADD = 4,
+            DO_STORE_HASHES = 8,
         };
         
         const auto incr_count_table = [&](Count_Table* count_table, Key const& key){
@@ -408,6 +554,8 @@ namespace tests
 
                 Table table;
                 Count_Table count_table;
+                if(do_ops & DO_STORE_HASHES)
+                    store_hashes(&table);
                 i32 added_i = 0;
                 for(isize i = 0; i < block_size; i++)
                 {
@@ -532,6 +680,7 @@ namespace tests
                     }
 
                     TEST(is_invariant(table));
+                    TEST(are_controls_consistent(table));
                 }
                 if(print) println("    i: {}\t batch: {}\t final_size: {}", j, block_size, size(table));
             }
@@ -561,6 +710,10 @@ namespace tests
             test_batch(640, i, DO_MULTIADD | DO_MARK_REMOVED);
             test_batch(640, i, DO_MULTIADD | DO_REMOVE);
             test_batch(640, i, DO_MULTIADD | DO_REMOVE | DO_MARK_REMOVED);
+            
+            test_batch(10,  i, DO_REMOVE | DO_STORE_HASHES);
+            test_batch(160, i, DO_REMOVE | DO_MARK_REMOVED | DO_STORE_HASHES);
+            test_batch(640, i, DO_MULTIADD | DO_REMOVE | DO_MARK_REMOVED | DO_STORE_HASHES);
         }
     }
     
@@ -625,6 +778,12 @@ namespace tests
             if(print) println("  test_hash_table_remove() type: Hash_Table<u32, Trc>");
             if(print) println("  test_hash_table_remove() type: Hash_Table<Trc, u32, test_tracker_hash>");
             if(print) println("  test_hash_table_remove() type: Hash_Table<Trc, Trc, test_tracker_hash>");
+
+            test_hash_table_control();
+            if(print) println("  test_hash_table_control()");
+
+            test_hash_table_stored_hashes();
+            if(print) println("  test_hash_table_stored_hashes()");
             
             if(flags & Test_Flags::STRESS)
                 test_hash_table_stress(print);
@@ -1,5 +1,6 @@
 #pragma once
 #include <random>
+#include <thread>
 #include "_test.h"
 
 #include "memory.h"
@@ -8,6 +9,19 @@
 #include "allocator_linear.h"
 #include "allocator_stack.h"
 #include "allocator_stack_ring.h"
+#include "allocator_thread_cache.h"
+#include "allocator_pool.h"
+#include "allocator_virtual_arena.h"
+#include "allocator_page.h"
+#include "allocator_profiling.h"
+#include "allocator_buddy.h"
+#include "allocator_tlsf.h"
+#include "allocator_budget.h"
+#include "allocator_concurrent_arena.h"
+#include "allocator_frame.h"
+#include "allocator_concurrent_stack_ring.h"
+#include "allocator_tracing.h"
+#include "allocator_registry.h"
 
 namespace jot
 {
@@ -61,6 +75,7 @@ namespace tests
         TEST(stats.max_bytes_allocated >= stats.bytes_allocated);
 
         TEST(stats.bytes_used >= stats.bytes_allocated || stats.bytes_used == 0);
+        TEST(0 <= stats.bytes_huge_page_backed && stats.bytes_huge_page_backed <= stats.bytes_used);
     }
     
     static
@@ -141,6 +156,1403 @@ namespace tests
         }
     }
     
+    static
+    void test_stack()
+    {
+        Failing_Allocator failing;
+        alignas(64) uint8_t stack_storage[400];
+        Stack_Allocator stack = Stack_Allocator(stack_storage, 400, &failing);
+
+        Slice<uint8_t> first = allocate_slice(&stack, 10, 8, GET_LINE_INFO());
+        Slice<uint8_t> second = allocate_slice(&stack, 20, 8, GET_LINE_INFO());
+        TEST(first.data != nullptr && second.data != nullptr);
+
+        //only the last allocation can be resized
+        TEST(resize_slice(&stack, &first, 30, 8, GET_LINE_INFO()) == false);
+        TEST(resize_slice(&stack, &second, 100, 8, GET_LINE_INFO()));
+        TEST(stack.current_alloced == 110 && stack.max_alloced == 110);
+        TEST(resize_slice(&stack, &second, 400, 8, GET_LINE_INFO()) == false);
+        TEST(resize_slice(&stack, &second, 50, 8, GET_LINE_INFO()));
+        TEST(stack.current_alloced == 60 && stack.max_alloced == 110);
+
+        //the space after resized allocation is used by the next one
+        Slice<uint8_t> third = allocate_slice(&stack, 10, 8, GET_LINE_INFO());
+        TEST(third.data >= second.data + 50);
+        test_stats_plausibility(&stack);
+
+        TEST(deallocate_slice(&stack, third, 8, GET_LINE_INFO()));
+        TEST(deallocate_slice(&stack, second, 8, GET_LINE_INFO()));
+        TEST(deallocate_slice(&stack, first, 8, GET_LINE_INFO()));
+        TEST(stack.current_alloced == 0);
+    }
+    
+    static
+    void test_thread_caching()
+    {
+        //Allocations made on one thread and freed on another must get reused 
+        // and the stats must add up across threads
+        Thread_Caching_Allocator alloc;
+        test_stats_plausibility(&alloc);
+
+        const isize thread_count = 4;
+        const isize block_count = 2000;
+        void* blocks[thread_count][block_count] = {};
+
+        const auto allocate_all = [&](isize thread_i){
+            for(isize i = 0; i < block_count; i++)
+            {
+                isize size = (i * 37 + thread_i * 11) % 300 + 1;
+                blocks[thread_i][i] = alloc.allocate(size, 8, GET_LINE_INFO());
+                TEST(blocks[thread_i][i] != nullptr);
+                memset(blocks[thread_i][i], (int) thread_i, (size_t) size);
+            }
+        };
+        
+        //each thread frees the blocks of the next thread
+        const auto deallocate_other = [&](isize thread_i){
+            isize other_i = (thread_i + 1) % thread_count;
+            for(isize i = 0; i < block_count; i++)
+            {
+                isize size = (i * 37 + other_i * 11) % 300 + 1;
+                uint8_t* block = (uint8_t*) blocks[other_i][i];
+                TEST(block[0] == (uint8_t) other_i && block[size - 1] == (uint8_t) other_i);
+                TEST(alloc.deallocate(block, size, 8, GET_LINE_INFO()));
+            }
+        };
+
+        for(isize repeat = 0; repeat < 3; repeat++)
+        {
+            std::thread threads[thread_count];
+            for(isize i = 0; i < thread_count; i++)
+                threads[i] = std::thread(allocate_all, i);
+            for(isize i = 0; i < thread_count; i++)
+                threads[i].join();
+            
+            for(isize i = 0; i < thread_count; i++)
+                threads[i] = std::thread(deallocate_other, i);
+            for(isize i = 0; i < thread_count; i++)
+                threads[i].join();
+
+            test_stats_plausibility(&alloc);
+            TEST(alloc.get_stats().bytes_allocated == 0);
+        }
+
+        //caches of exited threads are adopted so the memory gets reused instead of growing
+        isize used_before = alloc.get_stats().bytes_used;
+        std::thread adopting(allocate_all, 0);
+        adopting.join();
+        TEST(alloc.get_stats().bytes_used == used_before);
+
+        //spans come in whole regions which is all the memory small allocations use
+        TEST(used_before > 0 && used_before % Thread_Caching_Allocator::SPAN_REGION_SIZE == 0);
+        
+        std::thread freeing(deallocate_other, thread_count - 1);
+        freeing.join();
+        TEST(alloc.get_stats().bytes_allocated == 0);
+        
+        //large and overaligned allocations bypass the caches
+        void* large = alloc.allocate(memory_constants::MEBI_BYTE, 8, GET_LINE_INFO());
+        void* overaligned = alloc.allocate(64, 256, GET_LINE_INFO());
+        TEST(large != nullptr && overaligned != nullptr);
+        TEST(align_forward(overaligned, 256) == overaligned);
+        TEST(alloc.deallocate(large, memory_constants::MEBI_BYTE, 8, GET_LINE_INFO()));
+        TEST(alloc.deallocate(overaligned, 64, 256, GET_LINE_INFO()));
+        test_stats_plausibility(&alloc);
+    }
+    
+    static
+    void test_malloc_relocate()
+    {
+        Malloc_Allocator alloc;
+        
+        //small allocations
+        uint8_t* small = (uint8_t*) alloc.allocate(100, 8, GET_LINE_INFO());
+        memset(small, 7, 100);
+        small = (uint8_t*) alloc.relocate(small, 100, 10000, 8, GET_LINE_INFO());
+        TEST(small != nullptr && small[0] == 7 && small[99] == 7);
+        TEST(alloc.get_stats().bytes_allocated == 10000);
+        
+        //crossing into big allocations 
+        uint8_t* big = (uint8_t*) alloc.relocate(small, 10000, Malloc_Allocator::MMAP_THRESHOLD * 4, 8, GET_LINE_INFO());
+        TEST(big != nullptr && big[99] == 7);
+        
+        isize big_size = Malloc_Allocator::MMAP_THRESHOLD * 4;
+        memset(big, 9, (size_t) big_size);
+        for(isize i = 0; i < 6; i++)
+        {
+            big = (uint8_t*) alloc.relocate(big, big_size, big_size * 2, 8, GET_LINE_INFO());
+            TEST(big != nullptr && big[0] == 9 && big[big_size - 1] == 9);
+            memset(big + big_size, 9, (size_t) big_size);
+            big_size *= 2;
+        }
+
+        //shrinking in place always succeeds for mapped allocations
+        if(alloc.get_stats().supports_resize)
+        {
+            TEST(alloc.resize(big, big_size, big_size / 2, 8, GET_LINE_INFO()));
+            big_size /= 2;
+        }
+
+        TEST(alloc.get_stats().bytes_allocated == big_size);
+        TEST(alloc.deallocate(big, big_size, 8, GET_LINE_INFO()));
+        TEST(alloc.get_stats().bytes_allocated == 0);
+
+        //overaligned 
+        uint8_t* aligned = (uint8_t*) alloc.allocate(100, 64, GET_LINE_INFO());
+        memset(aligned, 3, 100);
+        aligned = (uint8_t*) alloc.relocate(aligned, 100, 5000, 64, GET_LINE_INFO());
+        TEST(aligned != nullptr && align_forward(aligned, 64) == aligned && aligned[99] == 3);
+        TEST(alloc.deallocate(aligned, 5000, 64, GET_LINE_INFO()));
+
+        //strings grow trough relocate
+        String_Builder builder(&alloc);
+        for(isize i = 0; i < 4 * memory_constants::MEBI_BYTE; i++)
+            push(&builder, (char) ('a' + i % 26));
+
+        TEST(builder[0] == 'a' && builder[26] == 'a' && last(builder) == (char) ('a' + (size(builder) - 1) % 26));
+        TEST(data(builder)[size(builder)] == '\0');
+    }
+
+    static
+    void test_arena_mark()
+    {
+        Arena_Allocator arena(default_allocator(), 256);
+
+        //mark of empty arena behaves like reset
+        Arena_Mark empty = mark(&arena);
+        void* first = arena.allocate(100, 8, GET_LINE_INFO());
+        TEST(first != nullptr);
+        rewind(&arena, empty);
+        TEST(arena.get_stats().bytes_allocated == 0);
+        TEST(arena.allocate(100, 8, GET_LINE_INFO()) == first);
+
+        Arena_Mark before = mark(&arena);
+        isize blocks_before = arena.used_blocks;
+        void* a = arena.allocate(50, 8, GET_LINE_INFO());
+        for(isize i = 0; i < 20; i++)
+            TEST(arena.allocate(1000, 8, GET_LINE_INFO()) != nullptr);
+
+        isize blocks_after = arena.used_blocks;
+        TEST(blocks_after > blocks_before);
+        
+        //rewinding frees everything after the mark but keeps the blocks
+        rewind(&arena, before);
+        TEST(arena.get_stats().bytes_allocated == 100);
+        TEST(arena.allocate(50, 8, GET_LINE_INFO()) == a);
+        for(isize i = 0; i < 20; i++)
+            TEST(arena.allocate(1000, 8, GET_LINE_INFO()) != nullptr);
+        TEST(arena.used_blocks == blocks_after);
+        TEST(arena.is_invariant());
+
+        //scratch scopes nest and restore the scratch allocator
+        Allocator* scratch_before = scratch_allocator();
+        isize scratch_alloced = memory_globals::scratch_arena()->get_stats().bytes_allocated;
+        {
+            Scratch_Scope outer;
+            TEST(scratch_allocator() == memory_globals::scratch_arena());
+            void* outer_alloc = scratch_allocator()->allocate(64, 8, GET_LINE_INFO());
+            {
+                Scratch_Scope inner;
+                Array<isize> temp(scratch_allocator());
+                for(isize i = 0; i < 10000; i++)
+                    push(&temp, i);
+            }
+
+            TEST(scratch_allocator()->allocate(64, 8, GET_LINE_INFO()) == (uint8_t*) outer_alloc + 64);
+        }
+        TEST(scratch_allocator() == scratch_before);
+        TEST(memory_globals::scratch_arena()->get_stats().bytes_allocated == scratch_alloced);
+    }
+
+    static
+    void test_arena_block_reuse()
+    {
+        //Constant chunk size so that every block has the same size unless the allocation is bigger
+        Arena_Allocator arena(default_allocator(), 1024, [](isize size) { return size; });
+        const isize sizes[] = {100, 900, 3000, 500, 10000, 800, 40000, 200};
+
+        for(isize i = 0; i < 200; i++)
+            TEST(arena.allocate(sizes[i % 8], 8, GET_LINE_INFO()) != nullptr);
+
+        isize blocks = arena.used_blocks;
+        isize bytes_used = arena.get_stats().bytes_used;
+        TEST(blocks > 100);
+
+        //After reset the same sequence is served entirely from the spare blocks
+        for(isize repeat = 0; repeat < 3; repeat++)
+        {
+            arena.reset();
+            for(isize i = 0; i < 200; i++)
+                TEST(arena.allocate(sizes[i % 8], 8, GET_LINE_INFO()) != nullptr);
+
+            TEST(arena.is_invariant());
+        }
+
+        TEST(arena.used_blocks == blocks);
+        TEST(arena.get_stats().bytes_used == bytes_used);
+        TEST(arena.max_blocks_scanned <= 2);
+        TEST(arena.blocks_scanned <= 2 * arena.overflow_count);
+
+        //External blocks are indexed the same way
+        alignas(16) static uint8_t buffer[128 * 1024];
+        arena.add_external_block(buffer, sizeof(buffer));
+        arena.reset();
+        uint8_t* big = (uint8_t*) arena.allocate(100000, 16, GET_LINE_INFO());
+        TEST(buffer <= big && big + 100000 <= buffer + sizeof(buffer));
+        TEST(arena.is_invariant());
+        arena.reset();
+    }
+
+    static
+    void test_release_extra_memory()
+    {
+        isize page = virtual_page_size();
+
+        //Arena gives back all blocks but the one in use
+        {
+            Arena_Allocator arena(default_allocator(), 1024, [](isize size) { return size; });
+            for(isize i = 0; i < 100; i++)
+                TEST(arena.allocate(1000, 8, GET_LINE_INFO()) != nullptr);
+
+            isize used_before = arena.get_stats().bytes_used;
+            arena.reset();
+            isize released = arena.release_extra_memory();
+            TEST(released > 0);
+            TEST(arena.used_blocks == 1);
+            TEST(arena.get_stats().bytes_used == used_before - released);
+            TEST(arena.is_invariant());
+
+            for(isize i = 0; i < 100; i++)
+                memset(arena.allocate(1000, 8, GET_LINE_INFO()), 1, 1000);
+        }
+
+        //Virtual arena decommits past the last allocation
+        {
+            Virtual_Arena arena(64 * memory_constants::MEBI_BYTE, 0);
+            void* small = arena.allocate(100, 8, GET_LINE_INFO());
+            void* big = arena.allocate(4 * memory_constants::MEBI_BYTE, 8, GET_LINE_INFO());
+            memset(big, 1, 4 * memory_constants::MEBI_BYTE);
+            arena.deallocate(big, 4 * memory_constants::MEBI_BYTE, 8, GET_LINE_INFO());
+
+            TEST(arena.release_extra_memory() >= 4 * memory_constants::MEBI_BYTE - page);
+            TEST(arena.release_extra_memory() == 0);
+            memset(small, 1, 100);
+            memset(arena.allocate(2 * page, 8, GET_LINE_INFO()), 1, (size_t) (2 * page));
+            arena.reset();
+        }
+
+        //Stack ring discards the unused part of the buffer which stays usable
+        {
+            isize buffer_size = 64 * page;
+            Page_Backing backing = Page_Backing::NORMAL;
+            void* buffer = virtual_allocate_pages(buffer_size, page, Page_Backing::NORMAL, &backing);
+            Stack_Ring_Allocator ring(buffer, buffer_size);
+            void* a = ring.allocate(1000, 8, GET_LINE_INFO());
+            memset(a, 2, 1000);
+
+            TEST(ring.release_extra_memory() >= buffer_size - 2*page);
+            for(isize i = 0; i < 1000; i++)
+                TEST(((uint8_t*) a)[i] == 2);
+
+            void* b = ring.allocate(8 * page, 8, GET_LINE_INFO());
+            memset(b, 3, (size_t) (8 * page));
+            ring.deallocate(b, 8 * page, 8, GET_LINE_INFO());
+            ring.deallocate(a, 1000, 8, GET_LINE_INFO());
+            virtual_free_pages(buffer, buffer_size, backing);
+        }
+
+        //Malloc can release its cache but cannot say how much
+        {
+            Malloc_Allocator malloc_alloc;
+            void* a = malloc_alloc.allocate(100, 8, GET_LINE_INFO());
+            TEST(malloc_alloc.release_extra_memory() == 0);
+            memset(a, 1, 100);
+            malloc_alloc.deallocate(a, 100, 8, GET_LINE_INFO());
+        }
+    }
+
+    static
+    void test_pool()
+    {
+        Pool_Allocator pool;
+        test_stats_plausibility(&pool);
+
+        isize class_48 = pool.size_class_of(40);
+        TEST(pool.get_class_stats(class_48).block_size == 48);
+        TEST(pool.size_class_of(48) == class_48);
+        TEST(pool.size_class_of(49) == class_48 + 1);
+
+        //blocks get reused in any order without touching parent
+        void* blocks[64] = {};
+        for(isize i = 0; i < 64; i++)
+            blocks[i] = pool.allocate(40, 8, GET_LINE_INFO());
+
+        for(isize i = 0; i < 64; i += 2)
+            TEST(pool.deallocate(blocks[i], 40, 8, GET_LINE_INFO()));
+            
+        isize used_before = pool.get_stats().bytes_used;
+        for(isize i = 0; i < 64; i += 2)
+        {
+            blocks[i] = pool.allocate(33, 16, GET_LINE_INFO());
+            TEST(blocks[i] != nullptr && align_forward(blocks[i], 16) == blocks[i]);
+        }
+
+        TEST(pool.get_stats().bytes_used == used_before);
+        Pool_Class_Stats class_stats = pool.get_class_stats(class_48);
+        TEST(class_stats.blocks_used == 64);
+        TEST(class_stats.max_blocks_used == 64);
+        TEST(class_stats.allocation_count == 96);
+        TEST(class_stats.slab_count == 1);
+
+        //resize within block size succeeds
+        TEST(pool.resize(blocks[1], 40, 48, 8, GET_LINE_INFO()));
+        TEST(pool.resize(blocks[1], 48, 49, 8, GET_LINE_INFO()) == false);
+        TEST(pool.deallocate(blocks[1], 48, 8, GET_LINE_INFO()));
+        blocks[1] = pool.allocate(40, 8, GET_LINE_INFO());
+
+        for(isize i = 0; i < 64; i++)
+            TEST(pool.deallocate(blocks[i], i % 2 ? 40 : 33, 8, GET_LINE_INFO()));
+
+        TEST(pool.get_class_stats(class_48).blocks_used == 0);
+        TEST(pool.get_stats().bytes_allocated == 0);
+        
+        //big allocations are passed to parent
+        void* big = pool.allocate(memory_constants::MEBI_BYTE, 8, GET_LINE_INFO());
+        TEST(big != nullptr);
+        TEST(pool.get_stats().bytes_allocated == memory_constants::MEBI_BYTE);
+        TEST(pool.deallocate(big, memory_constants::MEBI_BYTE, 8, GET_LINE_INFO()));
+        test_stats_plausibility(&pool);
+
+        pool.reset();
+        TEST(pool.get_stats().bytes_used == used_before);
+    }
+
+    static
+    void test_virtual_arena()
+    {
+        Virtual_Arena arena(memory_constants::GIBI_BYTE, memory_constants::MEBI_BYTE);
+        TEST(arena.is_reserved());
+        test_stats_plausibility(&arena);
+
+        //Growing array never relocates because its the last allocation
+        {
+            Array<uint64_t> array(&arena);
+            push(&array, (uint64_t) 0);
+            const uint64_t* first_data = data(array);
+
+            isize item_count = 8 * memory_constants::MEBI_BYTE;
+            for(isize i = 1; i < item_count; i++)
+            {
+                push(&array, (uint64_t) i);
+                TEST(data(array) == first_data);
+            }
+
+            TEST(array[item_count - 1] == (uint64_t) item_count - 1);
+            TEST(arena.get_stats().bytes_used >= item_count * (isize) sizeof(uint64_t));
+            test_stats_plausibility(&arena);
+        }
+
+        TEST(arena.get_stats().bytes_allocated == 0);
+        
+        //reset decommits back to the retained size 
+        arena.reset();
+        TEST(arena.get_stats().bytes_used <= memory_constants::MEBI_BYTE);
+        TEST(arena.get_stats().max_bytes_used >= 64 * memory_constants::MEBI_BYTE);
+
+        void* a = arena.allocate(100, 8, GET_LINE_INFO());
+        void* b = arena.allocate(100, 64, GET_LINE_INFO());
+        TEST(a != nullptr && b != nullptr && align_forward(b, 64) == b);
+        TEST(arena.resize(a, 100, 200, 8, GET_LINE_INFO()) == false);
+        TEST(arena.resize(b, 100, 3 * memory_constants::MEBI_BYTE, 64, GET_LINE_INFO()));
+        memset(b, 0, (size_t) 3 * memory_constants::MEBI_BYTE);
+
+        //cannot grow past the reservation
+        TEST(arena.resize(b, 3 * memory_constants::MEBI_BYTE, 2 * memory_constants::GIBI_BYTE, 64, GET_LINE_INFO()) == false);
+        TEST(arena.allocate(2 * memory_constants::GIBI_BYTE, 8, GET_LINE_INFO()) == nullptr);
+
+        TEST(arena.deallocate(b, 3 * memory_constants::MEBI_BYTE, 64, GET_LINE_INFO()));
+        TEST(arena.deallocate(a, 100, 8, GET_LINE_INFO()));
+        test_stats_plausibility(&arena);
+    }
+
+    static
+    void test_page_allocator()
+    {
+        isize huge = memory_constants::HUGE_PAGE;
+        {
+            Page_Allocator pages;
+            test_stats_plausibility(&pages);
+
+            //small allocations get normal pages
+            void* small = pages.allocate(100, 8, GET_LINE_INFO());
+            TEST(small != nullptr && align_forward(small, memory_constants::PAGE) == small);
+            TEST(pages.get_stats().bytes_used == virtual_page_size());
+            TEST(pages.get_stats().bytes_huge_page_backed == 0);
+            TEST(pages.resize(small, 100, 200, 8, GET_LINE_INFO()));
+            memset(small, 0, 200);
+
+            //big allocations are huge page aligned and rounded
+            isize big_size = 3 * huge + 100;
+            uint8_t* big = (uint8_t*) pages.allocate(big_size, 8, GET_LINE_INFO());
+            TEST(big != nullptr && align_forward(big, huge) == big);
+            memset(big, 0, (size_t) big_size);
+            TEST(pages.get_stats().bytes_used == virtual_page_size() + 4 * huge);
+            if(is_transparent_huge_page_enabled())
+                TEST(pages.get_stats().bytes_huge_page_backed == 4 * huge);
+            test_stats_plausibility(&pages);
+
+            TEST(pages.resize(big, big_size, 4 * huge, 8, GET_LINE_INFO()));
+            TEST(pages.resize(big, 4 * huge, 4 * huge + 1, 8, GET_LINE_INFO()) == false);
+            TEST(pages.deallocate(big, 4 * huge, 8, GET_LINE_INFO()));
+            TEST(pages.deallocate(small, 200, 8, GET_LINE_INFO()));
+            
+            Allocator_Stats stats = pages.get_stats();
+            TEST(stats.bytes_used == 0 && stats.bytes_allocated == 0 && stats.bytes_huge_page_backed == 0);
+            TEST(stats.allocation_count == 2 && stats.deallocation_count == 2);
+        }
+
+        //normal backing never uses huge pages
+        {
+            Page_Allocator pages(Page_Backing::NORMAL);
+            void* big = pages.allocate(huge, 8, GET_LINE_INFO());
+            TEST(big != nullptr);
+            TEST(pages.get_stats().bytes_huge_page_backed == 0);
+            TEST(pages.deallocate(big, huge, 8, GET_LINE_INFO()));
+        }
+        
+        //arena blocks are huge page sized and aligned
+        {
+            Page_Allocator pages;
+            {
+                Arena_Allocator arena(&pages, memory_constants::PAGE, Arena_Allocator::default_arena_grow, true);
+                void* first = arena.allocate(100, 8, GET_LINE_INFO());
+                void* second = arena.allocate(huge, 8, GET_LINE_INFO());
+                TEST(first != nullptr && second != nullptr);
+                memset(second, 0, (size_t) huge);
+
+                TEST(arena.used_blocks == 2);
+                TEST(align_forward(arena.first_block, huge) == arena.first_block);
+                TEST(align_forward(arena.last_block, huge) == arena.last_block);
+                TEST(pages.get_stats().bytes_used == 3 * huge);
+                if(is_transparent_huge_page_enabled())
+                    TEST(arena.get_stats().bytes_huge_page_backed == 3 * huge);
+                test_stats_plausibility(&arena);
+                test_stats_plausibility(&pages);
+            }
+            TEST(pages.get_stats().bytes_used == 0);
+        }
+
+        //other parents are not asked for huge page alignment. Only the whole huge pages within blocks are advised
+        {
+            Malloc_Allocator malloc_parent;
+            Arena_Allocator arena(&malloc_parent, memory_constants::PAGE, Arena_Allocator::default_arena_grow, true);
+            void* first = arena.allocate(100, 8, GET_LINE_INFO());
+            TEST(first != nullptr);
+            TEST(arena.get_stats().bytes_used == huge);
+            TEST(arena.get_stats().bytes_huge_page_backed <= huge);
+            TEST(malloc_parent.get_stats().bytes_allocated == huge);
+            test_stats_plausibility(&arena);
+        }
+    }
+
+    static
+    void test_profiling()
+    {
+        Profiling_Allocator profiler;
+        Line_Info site_a = GET_LINE_INFO();
+        Line_Info site_b = GET_LINE_INFO();
+
+        void* a[10] = {};
+        for(isize i = 0; i < 10; i++)
+        {
+            a[i] = profiler.allocate(100, 8, site_a);
+            TEST(a[i] != nullptr);
+            memset(a[i], 0, 100);
+        }
+
+        void* b = profiler.allocate(1000, 64, site_b);
+        TEST(b != nullptr && align_forward(b, 64) == b);
+        
+        //deallocations are attributed to the allocating site
+        for(isize i = 0; i < 5; i++)
+            TEST(profiler.deallocate(a[i], 100, 8, GET_LINE_INFO()));
+
+        Profiling_Site stats_a = profiler.get_site(site_a);
+        TEST(stats_a.allocation_count == 10 && stats_a.deallocation_count == 5);
+        TEST(stats_a.bytes_live == 500 && stats_a.max_bytes_live == 1000 && stats_a.bytes_total == 1000);
+        
+        //malloc never resizes so every resize fails
+        TEST(profiler.resize(b, 1000, 2000, 64, GET_LINE_INFO()) == false);
+        Profiling_Site stats_b = profiler.get_site(site_b);
+        TEST(stats_b.bytes_live == 1000 && stats_b.resize_count == 1 && stats_b.resize_failure_count == 1);
+        TEST(profiler.get_site(GET_LINE_INFO()).allocation_count == 0);
+        test_stats_plausibility(&profiler);
+
+        Array<Profiling_Site> sites;
+        TEST(get_sorted_profiling_sites(profiler, &sites) == 2);
+        TEST(sites[0].line_info.line == site_b.line && sites[1].line_info.line == site_a.line);
+
+        String_Builder report;
+        format_profile_report_into(&report, profiler);
+        format_profile_pprof_into(&report, profiler);
+        TEST(size(report) > 0);
+
+        for(isize i = 5; i < 10; i++)
+            TEST(profiler.deallocate(a[i], 100, 8, GET_LINE_INFO()));
+        TEST(profiler.deallocate(b, 1000, 64, GET_LINE_INFO()));
+        TEST(profiler.get_stats().bytes_allocated == 0 && profiler.get_stats().bytes_used == 0);
+        TEST(profiler.get_stats().max_bytes_allocated == 2000);
+    }
+
+    static
+    void test_buddy()
+    {
+        isize kb = memory_constants::KIBI_BYTE;
+        Buddy_Allocator buddy(1024 * kb, 4 * kb);
+        TEST(buddy.largest_free_block() == 1024 * kb);
+
+        void* a = buddy.allocate(5 * kb, 8, GET_LINE_INFO());
+        void* b = buddy.allocate(4 * kb, 4 * kb, GET_LINE_INFO());
+        void* c = buddy.allocate(100 * kb, 8, GET_LINE_INFO());
+        TEST(a != nullptr && b != nullptr && c != nullptr);
+        TEST(align_forward(b, 4 * kb) == b);
+        memset(a, 1, 5 * kb);
+        memset(c, 1, 100 * kb);
+
+        //internal fragmentation is visible in stats
+        Allocator_Stats stats = buddy.get_stats();
+        TEST(stats.bytes_allocated == 109 * kb);
+        TEST(stats.bytes_used == (8 + 4 + 128) * kb);
+        test_stats_plausibility(&buddy);
+        
+        TEST(buddy.allocate(2048 * kb, 8, GET_LINE_INFO()) == nullptr);
+        TEST(buddy.allocate(16, 8 * kb, GET_LINE_INFO()) == nullptr);
+
+        //a occupies [0, 8K) and b [8K, 12K) so b can grow into its free buddy but no further
+        TEST(buddy.resize(b, 4 * kb, 8 * kb, 8, GET_LINE_INFO()));
+        TEST(buddy.resize(b, 8 * kb, 16 * kb, 8, GET_LINE_INFO()) == false);
+        TEST(buddy.resize(c, 100 * kb, 60 * kb, 8, GET_LINE_INFO()));
+        TEST(buddy.resize(c, 60 * kb, 128 * kb, 8, GET_LINE_INFO()));
+        
+        //out of order frees coalesce back to a single block
+        TEST(buddy.deallocate(a, 5 * kb, 8, GET_LINE_INFO()));
+        TEST(buddy.deallocate(c, 128 * kb, 8, GET_LINE_INFO()));
+        TEST(buddy.deallocate(b, 8 * kb, 8, GET_LINE_INFO()));
+        TEST(buddy.largest_free_block() == 1024 * kb);
+        TEST(buddy.get_stats().bytes_used == 0);
+
+        //fill completely with the smallest blocks then free every other and the rest
+        void* blocks[256] = {};
+        for(isize i = 0; i < 256; i++)
+            TEST((blocks[i] = buddy.allocate(4 * kb, 8, GET_LINE_INFO())) != nullptr);
+        
+        TEST(buddy.allocate(1, 1, GET_LINE_INFO()) == nullptr);
+        for(isize i = 0; i < 256; i += 2)
+            TEST(buddy.deallocate(blocks[i], 4 * kb, 8, GET_LINE_INFO()));
+        TEST(buddy.largest_free_block() == 4 * kb);
+        for(isize i = 1; i < 256; i += 2)
+            TEST(buddy.deallocate(blocks[i], 4 * kb, 8, GET_LINE_INFO()));
+        TEST(buddy.largest_free_block() == 1024 * kb);
+        test_stats_plausibility(&buddy);
+    }
+
+    static
+    void test_tlsf()
+    {
+        //size mapping
+        {
+            isize fl = 0, sl = 0;
+            Tlsf_Allocator::mapping_insert(48, &fl, &sl);
+            TEST(fl == 0 && sl == 3);
+            Tlsf_Allocator::mapping_insert(256, &fl, &sl);
+            TEST(fl == 1 && sl == 0);
+            Tlsf_Allocator::mapping_insert(1024 + 3*64, &fl, &sl);
+            TEST(fl == 3 && sl == 3);
+            Tlsf_Allocator::mapping_search(1024 + 1, &fl, &sl);
+            TEST(fl == 3 && sl == 1);
+        }
+
+        //fixed buffer without parent
+        {
+            alignas(16) static uint8_t buffer[64 * 1024];
+            Tlsf_Allocator tlsf(buffer, sizeof(buffer), nullptr);
+
+            void* a = tlsf.allocate(100, 8, GET_LINE_INFO());
+            void* b = tlsf.allocate(1000, 8, GET_LINE_INFO());
+            void* c = tlsf.allocate(300, 256, GET_LINE_INFO());
+            TEST(a != nullptr && b != nullptr && c != nullptr);
+            TEST(align_forward(c, 256) == c);
+            memset(a, 1, 100);
+            memset(b, 2, 1000);
+            memset(c, 3, 300);
+
+            //a is followed by used block so cannot grow but can shrink
+            TEST(tlsf.resize(a, 100, 5000, 8, GET_LINE_INFO()) == false);
+            TEST(tlsf.resize(a, 100, 16, 8, GET_LINE_INFO()));
+
+            //c is followed by the free rest of the buffer
+            TEST(tlsf.resize(c, 300, 20000, 256, GET_LINE_INFO()));
+            memset(c, 3, 20000);
+            TEST(tlsf.allocate(64 * 1024, 8, GET_LINE_INFO()) == nullptr);
+
+            //after freeing everything the whole buffer coalesces back
+            TEST(tlsf.deallocate(b, 1000, 8, GET_LINE_INFO()));
+            TEST(tlsf.deallocate(a, 16, 8, GET_LINE_INFO()));
+            TEST(tlsf.deallocate(c, 20000, 256, GET_LINE_INFO()));
+            TEST(tlsf.get_stats().bytes_allocated == 0);
+
+            void* all = tlsf.allocate(60 * 1024, 8, GET_LINE_INFO());
+            TEST(all != nullptr);
+            TEST(tlsf.deallocate(all, 60 * 1024, 8, GET_LINE_INFO()));
+            test_stats_plausibility(&tlsf);
+        }
+
+        //random pattern growing from parent
+        {
+            Tlsf_Allocator tlsf(nullptr, 0, default_allocator(), 64 * 1024);
+            std::mt19937 gen(42);
+            void* allocs[256] = {};
+            isize sizes[256] = {};
+            for(isize iter = 0; iter < 20000; iter++)
+            {
+                isize i = (isize) (gen() % 256);
+                if(allocs[i] == nullptr)
+                {
+                    sizes[i] = (isize) (gen() % 5000);
+                    allocs[i] = tlsf.allocate(sizes[i], 8, GET_LINE_INFO());
+                    TEST(allocs[i] != nullptr);
+                    memset(allocs[i], (int) i, (size_t) sizes[i]);
+                }
+                else
+                {
+                    uint8_t* bytes = (uint8_t*) allocs[i];
+                    TEST(sizes[i] == 0 || (bytes[0] == (uint8_t) i && bytes[sizes[i] - 1] == (uint8_t) i));
+                    TEST(tlsf.deallocate(allocs[i], sizes[i], 8, GET_LINE_INFO()));
+                    allocs[i] = nullptr;
+                }
+            }
+
+            for(isize i = 0; i < 256; i++)
+                TEST(tlsf.deallocate(allocs[i], sizes[i], 8, GET_LINE_INFO()));
+
+            TEST(tlsf.get_stats().bytes_allocated == 0);
+            test_stats_plausibility(&tlsf);
+        }
+
+        //allocations bigger than chunk_size get their own pool big enough for their class
+        {
+            isize chunk = 64 * 1024;
+            Tlsf_Allocator tlsf(nullptr, 0, default_allocator(), chunk);
+            isize sizes[] = {2 * chunk + 16, 3 * chunk + 100, 5 * chunk + 4000, 9 * chunk - 16};
+            void* allocs[4] = {};
+            for(isize i = 0; i < 4; i++)
+            {
+                isize used_before = tlsf.get_stats().bytes_used;
+                allocs[i] = tlsf.allocate(sizes[i], 8, GET_LINE_INFO());
+                TEST(allocs[i] != nullptr);
+                memset(allocs[i], (int) i, (size_t) sizes[i]);
+
+                //a single pool of at most the size rounded to the next class
+                isize added = tlsf.get_stats().bytes_used - used_before;
+                TEST(sizes[i] <= added && added <= sizes[i] + sizes[i] / Tlsf_Allocator::SL_COUNT + 256);
+            }
+
+            void* overaligned = tlsf.allocate(3 * chunk + 100, 4096, GET_LINE_INFO());
+            TEST(overaligned != nullptr && align_forward(overaligned, 4096) == overaligned);
+            TEST(tlsf.deallocate(overaligned, 3 * chunk + 100, 4096, GET_LINE_INFO()));
+
+            for(isize i = 0; i < 4; i++)
+            {
+                uint8_t* bytes = (uint8_t*) allocs[i];
+                TEST(bytes[0] == (uint8_t) i && bytes[sizes[i] - 1] == (uint8_t) i);
+                TEST(tlsf.deallocate(allocs[i], sizes[i], 8, GET_LINE_INFO()));
+            }
+
+            TEST(tlsf.get_stats().bytes_allocated == 0);
+            test_stats_plausibility(&tlsf);
+        }
+    }
+
+    static
+    void test_batch_single(Allocator* alloc, isize count, isize size, isize align)
+    {
+        isize alloced_before = alloc->get_stats().bytes_allocated;
+        void* ptrs[256] = {};
+        assert(count <= 256);
+
+        TEST(alloc->allocate_batch(count, size, align, ptrs, GET_LINE_INFO()));
+        for(isize i = 0; i < count; i++)
+        {
+            TEST(ptrs[i] != nullptr);
+            TEST(align_forward(ptrs[i], align) == ptrs[i]);
+            memset(ptrs[i], (int) i, (size_t) size);
+        }
+
+        //No allocation overlaps with any other
+        for(isize i = 0; i < count; i++)
+            for(isize j = 0; j < size; j++)
+                TEST(((uint8_t*) ptrs[i])[j] == (uint8_t) i);
+
+        TEST(alloc->get_stats().bytes_allocated == alloced_before + count*size);
+        TEST(alloc->deallocate_batch(count, size, align, ptrs, GET_LINE_INFO()));
+        TEST(alloc->get_stats().bytes_allocated == alloced_before);
+        test_stats_plausibility(alloc);
+    }
+
+    static
+    void test_allocate_batch()
+    {
+        {
+            Malloc_Allocator malloc_alloc;
+            Arena_Allocator arena;
+            Pool_Allocator pool;
+            Tlsf_Allocator tlsf;
+            
+            Allocator* allocs[] = {&malloc_alloc, &arena, &pool, &tlsf};
+            for(Allocator* alloc : allocs)
+            {
+                test_batch_single(alloc, 0, 16, 8);
+                test_batch_single(alloc, 1, 16, 8);
+                test_batch_single(alloc, 100, 24, 8);
+                test_batch_single(alloc, 256, 40, 32);
+                test_batch_single(alloc, 10, 8 * memory_constants::KIBI_BYTE, 16);
+            }
+        }
+
+        //Arena places the batch consecutively and frees it if it was the last allocation
+        {
+            Arena_Allocator arena;
+            void* ptrs[10] = {};
+            TEST(arena.allocate_batch(10, 20, 8, ptrs, GET_LINE_INFO()));
+            for(isize i = 1; i < 10; i++)
+                TEST((uint8_t*) ptrs[i] == (uint8_t*) ptrs[i - 1] + 24);
+
+            TEST(arena.deallocate_batch(10, 20, 8, ptrs, GET_LINE_INFO()));
+            void* again = arena.allocate(20, 8, GET_LINE_INFO());
+            TEST(again == ptrs[0]);
+            arena.deallocate(again, 20, 8, GET_LINE_INFO());
+        }
+
+        //Pool reuses the batch blocks
+        {
+            Pool_Allocator pool;
+            void* ptrs[64] = {};
+            void* reused[64] = {};
+            TEST(pool.allocate_batch(64, 32, 8, ptrs, GET_LINE_INFO()));
+            TEST(pool.deallocate_batch(64, 32, 8, ptrs, GET_LINE_INFO()));
+            TEST(pool.allocate_batch(64, 32, 8, reused, GET_LINE_INFO()));
+            for(isize i = 0; i < 64; i++)
+                TEST(reused[i] == ptrs[63 - i]);
+
+            TEST(pool.deallocate_batch(64, 32, 8, reused, GET_LINE_INFO()));
+            TEST(pool.get_class_stats(pool.size_class_of(32)).blocks_used == 0);
+        }
+
+        //Failed batches leave nothing allocated
+        {
+            Failing_Allocator failing;
+            Arena_Allocator arena(&failing);
+            Pool_Allocator pool(&failing);
+            Allocator* allocs[] = {&failing, &arena, &pool};
+            for(Allocator* alloc : allocs)
+            {
+                void* ptrs[8] = {};
+                TEST(alloc->allocate_batch(8, 16, 8, ptrs, GET_LINE_INFO()) == false);
+                for(isize i = 0; i < 8; i++)
+                    TEST(ptrs[i] == nullptr);
+
+                TEST(alloc->get_stats().bytes_allocated == 0);
+            }
+        }
+    }
+
+    static
+    void test_budget()
+    {
+        //cache of 1000 byte allocations which gets trimmed under pressure
+        struct Cache
+        {
+            Allocator* alloc = nullptr;
+            void* items[64] = {};
+            isize count = 0;
+            isize soft_calls = 0;
+            isize hard_calls = 0;
+        };
+
+        const Memory_Pressure_Fn evict = [](void* context, Memory_Pressure pressure, isize needed) {
+            Cache* cache = (Cache*) context;
+            if(pressure == Memory_Pressure::SOFT)
+            {
+                cache->soft_calls ++;
+                return;
+            }
+
+            cache->hard_calls ++;
+            for(isize freed = 0; freed < needed && cache->count > 0; freed += 1000)
+                cache->alloc->deallocate(cache->items[-- cache->count], 1000, 8, GET_LINE_INFO());
+        };
+
+        {
+            Budget_Allocator budget(10000, 8000);
+            Cache cache;
+            cache.alloc = &budget;
+            TEST(budget.add_pressure_callback(evict, &cache));
+
+            for(; cache.count < 7; cache.count++)
+                cache.items[cache.count] = budget.allocate(1000, 8, GET_LINE_INFO());
+            TEST(cache.soft_calls == 0 && cache.hard_calls == 0);
+
+            //crossing soft limit notifies once
+            for(; cache.count < 10; cache.count++)
+                cache.items[cache.count] = budget.allocate(1000, 8, GET_LINE_INFO());
+            TEST(cache.soft_calls == 1 && cache.hard_calls == 0);
+            TEST(budget.get_stats().bytes_allocated == 10000);
+
+            //above the hard limit the cache is evicted just enough and the allocation succeeds
+            void* big = budget.allocate(2500, 8, GET_LINE_INFO());
+            TEST(big != nullptr);
+            TEST(cache.hard_calls == 1 && cache.count == 7);
+            TEST(budget.get_stats().bytes_allocated == 9500);
+
+            //eviction dropped usage below soft limit so crossing it again notified again
+            TEST(cache.soft_calls == 2);
+            test_stats_plausibility(&budget);
+
+            //cannot be satisfied even after evicting everything
+            TEST(budget.allocate(20000, 8, GET_LINE_INFO()) == nullptr);
+            TEST(cache.count == 0 && budget.failed_count == 1);
+
+            //dropping below soft limit rearms the soft callbacks
+            TEST(budget.deallocate(big, 2500, 8, GET_LINE_INFO()));
+            for(; cache.count < 9; cache.count++)
+                cache.items[cache.count] = budget.allocate(1000, 8, GET_LINE_INFO());
+            TEST(cache.soft_calls == 3);
+
+            TEST(budget.remove_pressure_callback(evict, &cache));
+            TEST(budget.remove_pressure_callback(evict, &cache) == false);
+            TEST(budget.allocate(2000, 8, GET_LINE_INFO()) == nullptr);
+
+            while(cache.count > 0)
+                TEST(budget.deallocate(cache.items[-- cache.count], 1000, 8, GET_LINE_INFO()));
+            TEST(budget.get_stats().bytes_allocated == 0);
+        }
+
+        //failing parent is retried after the callbacks ran
+        {
+            Failing_Allocator failing;
+            Budget_Allocator budget(10000, 10000, &failing);
+            Cache cache;
+            cache.alloc = &budget;
+            TEST(budget.add_pressure_callback(evict, &cache));
+            TEST(budget.allocate(100, 8, GET_LINE_INFO()) == nullptr);
+            TEST(cache.hard_calls == 1 && budget.failed_count == 1);
+            TEST(budget.get_stats().bytes_allocated == 0);
+        }
+    }
+
+    static
+    void test_concurrent_arena()
+    {
+        //single threaded it behaves like an arena
+        {
+            Concurrent_Arena arena;
+            test_stats_plausibility(&arena);
+
+            uint8_t* a = (uint8_t*) arena.allocate(100, 256, GET_LINE_INFO());
+            uint8_t* b = (uint8_t*) arena.allocate(10, 8, GET_LINE_INFO());
+            TEST(a != nullptr && b != nullptr && align_forward(a, 256) == a);
+            TEST(arena.resize(b, 10, 200, 8, GET_LINE_INFO()));
+            TEST(arena.resize(a, 100, 200, 256, GET_LINE_INFO()) == false);
+            memset(b, 1, 200);
+
+            TEST(arena.deallocate(b, 200, 8, GET_LINE_INFO()));
+            uint8_t* c = (uint8_t*) arena.allocate(16, 8, GET_LINE_INFO());
+            TEST(c == b);
+
+            void* big = arena.allocate(100 * memory_constants::KIBI_BYTE, 8, GET_LINE_INFO());
+            TEST(big != nullptr);
+            memset(big, 2, 100 * memory_constants::KIBI_BYTE);
+            TEST(arena.block_count == 2);
+            test_stats_plausibility(&arena);
+
+            arena.reset();
+            TEST(arena.block_count == 1 && arena.get_stats().bytes_allocated == 0);
+            TEST(arena.allocate(100 * memory_constants::KIBI_BYTE, 8, GET_LINE_INFO()) == big);
+        }
+
+        //allocations from many threads never overlap
+        {
+            Thread_Caching_Allocator parent;
+            Concurrent_Arena arena(&parent, 1024);
+
+            const isize thread_count = 8;
+            const isize block_count = 5000;
+            uint8_t* blocks[thread_count][block_count] = {};
+
+            const auto allocate_all = [&](isize thread_i){
+                for(isize i = 0; i < block_count; i++)
+                {
+                    isize size = (i * 37 + thread_i * 11) % 300 + 1;
+                    isize align = (isize) 1 << (i % 7);
+                    blocks[thread_i][i] = (uint8_t*) arena.allocate(size, align, GET_LINE_INFO());
+                    TEST(blocks[thread_i][i] != nullptr && align_forward(blocks[thread_i][i], align) == blocks[thread_i][i]);
+                    memset(blocks[thread_i][i], (int) thread_i, (size_t) size);
+                }
+            };
+
+            for(isize repeat = 0; repeat < 3; repeat++)
+            {
+                std::thread threads[thread_count];
+                for(isize i = 0; i < thread_count; i++)
+                    threads[i] = std::thread(allocate_all, i);
+                for(isize i = 0; i < thread_count; i++)
+                    threads[i].join();
+
+                for(isize thread_i = 0; thread_i < thread_count; thread_i++)
+                    for(isize i = 0; i < block_count; i++)
+                    {
+                        isize size = (i * 37 + thread_i * 11) % 300 + 1;
+                        for(isize k = 0; k < size; k++)
+                            TEST(blocks[thread_i][i][k] == (uint8_t) thread_i);
+                    }
+
+                test_stats_plausibility(&arena);
+                arena.reset();
+                TEST(arena.block_count == 1);
+            }
+        }
+    }
+
+    static
+    void test_frame_allocator()
+    {
+        Frame_Allocator frame;
+        test_stats_plausibility(&frame);
+
+        //data lives for one more frame then its memory is reused
+        uint8_t* first = (uint8_t*) frame.allocate(1000, 8, GET_LINE_INFO());
+        memset(first, 1, 1000);
+        frame.advance_frame();
+
+        uint8_t* second = (uint8_t*) frame.allocate(1000, 8, GET_LINE_INFO());
+        memset(second, 2, 1000);
+        TEST(first[0] == 1 && first[999] == 1);
+        TEST(frame.get_stats().bytes_allocated == 2000);
+        frame.advance_frame();
+
+        TEST(frame.get_stats().bytes_allocated == 1000);
+        TEST(frame.allocate(1000, 8, GET_LINE_INFO()) == first);
+        TEST(second[0] == 2 && second[999] == 2);
+
+        //only the last allocation of the current frame can be freed
+        void* last = frame.allocate(100, 8, GET_LINE_INFO());
+        TEST(frame.deallocate(second, 1000, 8, GET_LINE_INFO()));
+        TEST(frame.deallocate(last, 100, 8, GET_LINE_INFO()));
+        TEST(frame.allocate(100, 8, GET_LINE_INFO()) == last);
+        test_stats_plausibility(&frame);
+
+        //in steady state all blocks get reused
+        for(isize i = 0; i < 4; i++)
+        {
+            for(isize j = 0; j < 300; j++)
+                TEST(frame.allocate(1000, 8, GET_LINE_INFO()) != nullptr);
+            frame.advance_frame();
+        }
+
+        Frame_Stats before = frame.get_frame_stats();
+        for(isize i = 0; i < 10; i++)
+        {
+            for(isize j = 0; j < 300; j++)
+                TEST(frame.allocate(1000, 8, GET_LINE_INFO()) != nullptr);
+            frame.advance_frame();
+        }
+
+        Frame_Stats after = frame.get_frame_stats();
+        TEST(after.frame_index == before.frame_index + 10);
+        TEST(after.blocks_added == before.blocks_added);
+        TEST(after.blocks_reused > before.blocks_reused);
+        TEST(frame.get_stats().blocks_added == after.blocks_added);
+        TEST(frame.get_stats().blocks_reused == after.blocks_reused);
+        TEST(after.bytes_allocated_last_frame == 300 * 1000);
+        TEST(frame.get_stats().max_bytes_allocated >= 600 * 1000);
+        test_stats_plausibility(&frame);
+
+        //Frame_Scope makes everything in scope frame allocated
+        {
+            isize count_before = frame.get_stats().allocation_count;
+            Frame_Scope scope(&frame);
+            TEST(default_allocator() == &frame);
+
+            Array<isize> array;
+            for(isize i = 0; i < 100; i++)
+                push(&array, i);
+            TEST(frame.get_stats().allocation_count > count_before);
+        }
+        TEST(default_allocator() != &frame);
+    }
+
+    static
+    void test_concurrent_stack_ring()
+    {
+        Failing_Allocator failing;
+
+        //single threaded it reclaims and wraps around like Stack_Ring_Allocator
+        {
+            alignas(256) uint8_t storage[256];
+            Concurrent_Stack_Ring_Allocator ring(storage, 256, &failing);
+            Slice<uint8_t> a1 = allocate_slice(&ring, 64, 8, GET_LINE_INFO());
+            Slice<uint8_t> a2 = allocate_slice(&ring, 64, 8, GET_LINE_INFO());
+            Slice<uint8_t> a3 = allocate_slice(&ring, 64, 8, GET_LINE_INFO());
+            TEST(a1.data != nullptr && a2.data != nullptr && a3.data != nullptr);
+            TEST(resize_slice(&ring, &a3, 96, 8, GET_LINE_INFO()));
+            TEST(resize_slice(&ring, &a3, 200, 8, GET_LINE_INFO()) == false);
+            test_stats_plausibility(&ring);
+
+            TEST(deallocate_slice(&ring, a1, 8, GET_LINE_INFO()));
+            TEST(deallocate_slice(&ring, a2, 8, GET_LINE_INFO()));
+
+            Slice<uint8_t> a4 = allocate_slice(&ring, 64, 8, GET_LINE_INFO());
+            Slice<uint8_t> a5 = allocate_slice(&ring, 64, 8, GET_LINE_INFO());
+            TEST(a4.data == a1.data && a5.data == a2.data);
+            TEST(ring.allocate(64, 8, GET_LINE_INFO()) == nullptr);
+
+            //a5 cannot grow into a3 which still lives past the wrap around
+            TEST(resize_slice(&ring, &a5, 70, 8, GET_LINE_INFO()) == false);
+
+            TEST(deallocate_slice(&ring, a3, 8, GET_LINE_INFO()));
+            TEST(deallocate_slice(&ring, a4, 8, GET_LINE_INFO()));
+            TEST(deallocate_slice(&ring, a5, 8, GET_LINE_INFO()));
+            TEST(ring.get_stats().bytes_allocated == 0);
+            test_stats_plausibility(&ring);
+        }
+
+        //one producer passes messages to consumers which free them
+        {
+            struct Message
+            {
+                uint8_t* data;
+                isize size;
+            };
+
+            constexpr isize queue_capacity = 64;
+            struct Queue
+            {
+                Message messages[queue_capacity];
+                std::atomic<isize> head;
+                std::atomic<isize> tail;
+            };
+
+            const isize consumer_count = 3;
+            const isize message_count = 30000;
+            Queue queues[consumer_count] = {};
+
+            Array<uint8_t> storage;
+            resize(&storage, 64 * memory_constants::KIBI_BYTE);
+            Concurrent_Stack_Ring_Allocator ring(data(&storage), size(storage), &failing);
+
+            const auto produce = [&]{
+                for(isize i = 0; i < message_count; i++)
+                {
+                    isize size = (i * 37) % 1000 + 1;
+                    uint8_t* message = nullptr;
+                    while((message = (uint8_t*) ring.allocate(size, 8, GET_LINE_INFO())) == nullptr)
+                        std::this_thread::yield();
+
+                    memset(message, (int) (i % 251), (size_t) size);
+
+                    Queue* queue = &queues[i % consumer_count];
+                    isize tail = queue->tail.load(std::memory_order_relaxed);
+                    while(tail - queue->head.load(std::memory_order_acquire) >= queue_capacity)
+                        std::this_thread::yield();
+
+                    queue->messages[tail % queue_capacity] = Message{message, size};
+                    queue->tail.store(tail + 1, std::memory_order_release);
+                }
+            };
+
+            const auto consume = [&](isize consumer_i){
+                Queue* queue = &queues[consumer_i];
+                for(isize i = consumer_i; i < message_count; i += consumer_count)
+                {
+                    isize head = queue->head.load(std::memory_order_relaxed);
+                    while(queue->tail.load(std::memory_order_acquire) == head)
+                        std::this_thread::yield();
+
+                    Message message = queue->messages[head % queue_capacity];
+                    queue->head.store(head + 1, std::memory_order_release);
+
+                    TEST(message.size == (i * 37) % 1000 + 1);
+                    TEST(message.data[0] == (uint8_t) (i % 251) && message.data[message.size - 1] == (uint8_t) (i % 251));
+                    TEST(ring.deallocate(message.data, message.size, 8, GET_LINE_INFO()));
+                }
+            };
+
+            std::thread producer(produce);
+            std::thread consumers[consumer_count];
+            for(isize i = 0; i < consumer_count; i++)
+                consumers[i] = std::thread(consume, i);
+
+            producer.join();
+            for(isize i = 0; i < consumer_count; i++)
+                consumers[i].join();
+
+            TEST(ring.get_stats().allocation_count == message_count);
+            TEST(ring.get_stats().bytes_allocated == 0);
+            test_stats_plausibility(&ring);
+        }
+    }
+
+    static
+    void test_tracing()
+    {
+        Arena_Allocator arena;
+        Tracing_Allocator tracing(&arena);
+        Line_Info site_a = GET_LINE_INFO();
+        Line_Info site_b = GET_LINE_INFO();
+
+        //records ids, sizes and sites
+        void* a = tracing.allocate(100, 8, site_a);
+        void* b = tracing.allocate(200, 64, site_b);
+        TEST(tracing.resize(b, 200, 300, 64, site_b));
+        TEST(tracing.deallocate(a, 100, 8, site_a));
+        TEST(tracing.deallocate(b, 300, 64, site_b));
+
+        Allocation_Trace const& trace = tracing.trace;
+        TEST(size(trace.events) == 5 && size(trace.sites) == 2 && trace.allocation_count == 2);
+        TEST(trace.events[0].kind == Trace_Event_Kind::ALLOCATE && trace.events[0].id == 0 && trace.events[0].size == 100);
+        TEST(trace.events[1].kind == Trace_Event_Kind::ALLOCATE && trace.events[1].id == 1 && trace.events[1].align_log2 == 6);
+        TEST(trace.events[2].kind == Trace_Event_Kind::RESIZE && trace.events[2].id == 1 && trace.events[2].old_size == 200 && trace.events[2].size == 300);
+        TEST(trace.events[3].kind == Trace_Event_Kind::DEALLOCATE && trace.events[3].id == 0 && trace.events[3].old_size == 100);
+        TEST(trace.events[4].kind == Trace_Event_Kind::DEALLOCATE && trace.events[4].id == 1);
+        TEST(trace.sites[trace.events[0].site].line == site_a.line);
+        TEST(trace.sites[trace.events[1].site].line == site_b.line);
+        TEST(trace.events[0].time_ns <= trace.events[4].time_ns);
+
+        //realistic mix of container usage
+        {
+            Array<isize> array(&tracing);
+            Array<Array<isize>> arrays(&tracing);
+            for(isize i = 0; i < 1000; i++)
+            {
+                push(&array, i);
+                if(i % 10 == 0)
+                    push(&arrays, Array<isize>(&tracing));
+                push(last(&arrays), i);
+            }
+        }
+        TEST(tracing.get_stats().bytes_allocated == 0);
+        
+        //round trips through serialization
+        Array<char> serialized;
+        serialize_trace_into(&serialized, &tracing);
+
+        Allocation_Trace loaded;
+        TEST(deserialize_trace(&loaded, slice(serialized)));
+        TEST(size(loaded.events) == size(trace.events) && size(loaded.sites) == size(trace.sites));
+        TEST(memcmp(data(loaded.events), data(trace.events), (size_t) size(trace.events) * sizeof(Trace_Event)) == 0);
+        for(isize i = 0; i < size(trace.sites); i++)
+        {
+            TEST(strcmp(loaded.sites[i].file, trace.sites[i].file) == 0);
+            TEST(strcmp(loaded.sites[i].func, trace.sites[i].func) == 0);
+            TEST(loaded.sites[i].line == trace.sites[i].line);
+        }
+
+        Slice<const char> truncated = {data(serialized), size(serialized) - 1};
+        Allocation_Trace corrupted;
+        TEST(deserialize_trace(&corrupted, truncated) == false);
+
+        //invalid data leaves the trace unchanged
+        {
+            using tracing_internal::Trace_Header;
+            using tracing_internal::Serialized_Site;
+            TEST(size(trace.sites) > 0);
+
+            //counts so big they would overflow when multiplied by the item size
+            Array<char> crafted = serialized;
+            Trace_Header* header = (Trace_Header*) (void*) data(&crafted);
+            header->event_count = INT64_MAX / 2;
+            header->site_count = INT64_MAX / 4;
+            TEST(deserialize_trace(&loaded, slice(crafted)) == false);
+
+            header->event_count = -1;
+            TEST(deserialize_trace(&loaded, slice(crafted)) == false);
+
+            //site string not terminated where the site says it ends
+            crafted = serialized;
+            isize strings_from = (isize) sizeof(Trace_Header) + size(trace.sites) * (isize) sizeof(Serialized_Site);
+            crafted[strings_from + (isize) strlen(trace.sites[0].file)] = 'x';
+            TEST(deserialize_trace(&loaded, slice(crafted)) == false);
+
+            //events that would make replay misbehave
+            TEST(size(trace.events) > 0);
+            isize events_from = size(serialized) - size(trace.events) * (isize) sizeof(Trace_Event);
+            crafted = serialized;
+            Trace_Event* event = (Trace_Event*) (void*) (data(&crafted) + events_from);
+            event->size = -1;
+            TEST(deserialize_trace(&loaded, slice(crafted)) == false);
+
+            event->size = 0;
+            event->old_size = -8;
+            TEST(deserialize_trace(&loaded, slice(crafted)) == false);
+
+            event->old_size = 0;
+            event->kind = (Trace_Event_Kind) 7;
+            TEST(deserialize_trace(&loaded, slice(crafted)) == false);
+
+            event->kind = Trace_Event_Kind::ALLOCATE;
+            TEST(deserialize_trace(&loaded, slice(crafted)));
+            TEST(deserialize_trace(&loaded, slice(serialized)));
+
+            TEST(size(loaded.events) == size(trace.events) && size(loaded.sites) == size(trace.sites));
+            TEST(strcmp(loaded.sites[0].file, trace.sites[0].file) == 0);
+        }
+
+        //replays on any allocator
+        {
+            alignas(64) static uint8_t ring_buffer[64 * 1024];
+            Malloc_Allocator malloc_alloc;
+            Arena_Allocator replay_arena;
+            Stack_Ring_Allocator stack_ring(ring_buffer, sizeof(ring_buffer));
+            Tlsf_Allocator tlsf;
+
+            Allocator* allocs[] = {&malloc_alloc, &replay_arena, &stack_ring, &tlsf};
+            for(Allocator* alloc : allocs)
+            {
+                Replay_Result result = replay_trace(loaded, alloc);
+                TEST(result.event_count == size(loaded.events));
+                TEST(result.failed_count == 0);
+                TEST(result.max_bytes_allocated == tracing.get_stats().max_bytes_allocated);
+                TEST(0 <= result.fragmentation && result.fragmentation < 1);
+                TEST(result.peak_resident_growth >= 0);
+                TEST(alloc->get_stats().bytes_allocated == 0 || alloc == &replay_arena);
+
+                String_Builder report;
+                format_replay_result_into(&report, alloc->get_stats().name, result);
+                TEST(size(report) > 0);
+            }
+        }
+
+        //records from multiple threads in a replayable order
+        {
+            Thread_Caching_Allocator parent;
+            Tracing_Allocator threaded(&parent);
+            const auto allocate_some = [&]{
+                void* blocks[100] = {};
+                for(isize repeat = 0; repeat < 10; repeat++)
+                {
+                    for(isize i = 0; i < 100; i++)
+                        blocks[i] = threaded.allocate(i + 1, 8, GET_LINE_INFO());
+                    for(isize i = 0; i < 100; i++)
+                        threaded.deallocate(blocks[i], i + 1, 8, GET_LINE_INFO());
+                }
+            };
+
+            std::thread threads[4];
+            for(std::thread& thread : threads)
+                thread = std::thread(allocate_some);
+            for(std::thread& thread : threads)
+                thread.join();
+
+            TEST(size(threaded.trace.events) == 4 * 2000);
+            Malloc_Allocator malloc_alloc;
+            Replay_Result result = replay_trace(threaded.trace, &malloc_alloc);
+            TEST(result.failed_count == 0 && malloc_alloc.get_stats().bytes_allocated == 0);
+        }
+    }
+
+    static
+    void test_allocator_registry()
+    {
+        Allocator_Registry registry;
+        Malloc_Allocator root;
+        Arena_Allocator renderer(&root);
+        Budget_Allocator budget(memory_constants::MEBI_BYTE, -1, &root);
+        Arena_Allocator nested(&budget);
+
+        Allocator_Snapshot snapshot;
+        take_allocator_snapshot(&snapshot, &registry);
+        TEST(size(snapshot.nodes) == 0);
+
+        {
+            Allocator_Registration renderer_registration(&renderer, "renderer", &registry);
+            Allocator_Registration nested_registration(&nested, "nested", &registry);
+
+            void* a = renderer.allocate(1000, 8, GET_LINE_INFO());
+            void* b = nested.allocate(500, 8, GET_LINE_INFO());
+
+            //parents that were not registered are discovered through the stats
+            take_allocator_snapshot(&snapshot, &registry);
+            TEST(size(snapshot.nodes) == 4);
+
+            Allocator_Node const& root_node = snapshot.nodes[0];
+            TEST(root_node.allocator == &root && root_node.parent == -1 && root_node.depth == 0);
+            TEST(root_node.is_registered == false && root_node.child_count == 2);
+
+            for(isize i = 1; i < 4; i++)
+            {
+                Allocator_Node const& node = snapshot.nodes[i];
+                TEST(node.parent >= 0 && node.parent < i);
+                TEST(node.depth == snapshot.nodes[node.parent].depth + 1);
+                TEST(node.stats.parent == snapshot.nodes[node.parent].allocator);
+                TEST(0 <= node.utilization && node.utilization <= 1);
+            }
+
+            isize renderer_i = -1;
+            isize nested_i = -1;
+            for(isize i = 0; i < 4; i++)
+            {
+                if(snapshot.nodes[i].allocator == &renderer) renderer_i = i;
+                if(snapshot.nodes[i].allocator == &nested) nested_i = i;
+            }
+
+            TEST(renderer_i != -1 && nested_i != -1);
+            TEST(snapshot.nodes[renderer_i].is_registered && strcmp(snapshot.nodes[renderer_i].label, "renderer") == 0);
+            TEST(snapshot.nodes[renderer_i].stats.bytes_allocated == 1000);
+            TEST(snapshot.nodes[nested_i].depth == 2 && snapshot.nodes[snapshot.nodes[nested_i].parent].allocator == &budget);
+            TEST(snapshot.nodes[nested_i].stats.bytes_allocated == 500);
+
+            String_Builder text;
+            format_allocator_snapshot_into(&text, snapshot);
+            push(&text, '\0');
+            TEST(strstr(data(text), "    Arena_Allocator 'nested'") != nullptr);
+            TEST(strstr(data(text), "  Arena_Allocator 'renderer'") != nullptr);
+
+            String_Builder json;
+            format_allocator_snapshot_json_into(&json, snapshot);
+            push(&json, '\0');
+            TEST(strstr(data(json), "{\"time_ns\":") == data(json));
+            TEST(strstr(data(json), "\"label\":\"renderer\"") != nullptr);
+            TEST(strstr(data(json), "\"bytes_allocated\":500") != nullptr);
+            TEST(strstr(data(json), "\"blocks_reused\":0") != nullptr);
+
+            isize depth = 0;
+            isize max_depth = 0;
+            for(isize i = 0; i < size(json) - 1; i++)
+            {
+                if(json[i] == '{' || json[i] == '[') depth ++;
+                if(json[i] == '}' || json[i] == ']') depth --;
+                TEST(depth >= 0);
+                max_depth = max(max_depth, depth);
+            }
+            TEST(depth == 0 && max_depth == 2 + 2*3);
+
+            renderer.deallocate(a, 1000, 8, GET_LINE_INFO());
+            nested.deallocate(b, 500, 8, GET_LINE_INFO());
+        }
+
+        //registrations end with their scope
+        TEST(unregister_allocator(&renderer, &registry) == false);
+        take_allocator_snapshot(&snapshot, &registry);
+        TEST(size(snapshot.nodes) == 0);
+
+        register_allocator(&root, nullptr, &registry);
+        register_allocator(&renderer, nullptr, &registry);
+        take_allocator_snapshot(&snapshot, &registry);
+        TEST(size(snapshot.nodes) == 2 && snapshot.nodes[0].is_registered && snapshot.nodes[0].child_count == 1);
+        TEST(unregister_allocator(&root, &registry));
+        TEST(unregister_allocator(&renderer, &registry));
+    }
+
     static
     void test_memory_stress(bool print)
     {
@@ -187,6 +1599,12 @@ namespace tests
         Stack_Allocator         stack      = Stack_Allocator(data(&stack_storage), size(stack_storage), def);
         Stack_Ring_Allocator    stack_ring = Stack_Ring_Allocator(data(&stack_ring_storage), size(stack_ring_storage), def);
         Arena_Allocator         arena      = Arena_Allocator(def);
+        Thread_Caching_Allocator thread_caching;
+        Pool_Allocator          pool       = Pool_Allocator(def);
+        Page_Allocator          pages;
+        Buddy_Allocator         buddy      = Buddy_Allocator(64 * memory_constants::MEBI_BYTE, 4 * memory_constants::KIBI_BYTE, def);
+        Tlsf_Allocator          tlsf       = Tlsf_Allocator(nullptr, 0, def);
+        Budget_Allocator        budget     = Budget_Allocator(1024 * memory_constants::MEBI_BYTE, -1, def);
 
         const auto set_up_test = [&](
             isize block_size_,
@@ -438,12 +1856,24 @@ namespace tests
             test_single(i, &arena);
             test_single(i, &stack_ring);
             test_single(i, &stack);
+            test_single(i, &thread_caching);
+            test_single(i, &pool);
+            test_single(i, &pages);
+            test_single(i, &buddy);
+            test_single(i, &tlsf);
+            test_single(i, &budget);
         
             set_up_test(200, {1, 10}, {0, 10}, TOUCH);
             test_single(i, &malloc);
             test_single(i, &arena);
             test_single(i, &stack_ring);
             test_single(i, &stack);
+            test_single(i, &thread_caching);
+            test_single(i, &pool);
+            test_single(i, &pages);
+            test_single(i, &buddy);
+            test_single(i, &tlsf);
+            test_single(i, &budget);
         }
     }
     
@@ -463,6 +1893,63 @@ namespace tests
         if(print) println("  test_stack_ring()");
         test_stack_ring();
         
+        if(print) println("  test_stack()");
+        test_stack();
+        
+        if(print) println("  test_malloc_relocate()");
+        test_malloc_relocate();
+        
+        if(print) println("  test_arena_mark()");
+        test_arena_mark();
+        
+        if(print) println("  test_arena_block_reuse()");
+        test_arena_block_reuse();
+        
+        if(print) println("  test_release_extra_memory()");
+        test_release_extra_memory();
+        
+        if(print) println("  test_pool()");
+        test_pool();
+        
+        if(print) println("  test_virtual_arena()");
+        test_virtual_arena();
+        
+        if(print) println("  test_page_allocator()");
+        test_page_allocator();
+        
+        if(print) println("  test_buddy()");
+        test_buddy();
+        
+        if(print) println("  test_tlsf()");
+        test_tlsf();
+        
+        if(print) println("  test_allocate_batch()");
+        test_allocate_batch();
+        
+        if(print) println("  test_budget()");
+        test_budget();
+        
+        if(print) println("  test_concurrent_arena()");
+        test_concurrent_arena();
+        
+        if(print) println("  test_frame_allocator()");
+        test_frame_allocator();
+        
+        if(print) println("  test_concurrent_stack_ring()");
+        test_concurrent_stack_ring();
+        
+        if(print) println("  test_tracing()");
+        test_tracing();
+        
+        if(print) println("  test_allocator_registry()");
+        test_allocator_registry();
+        
+        if(print) println("  test_profiling()");
+        test_profiling();
+        
+        if(print) println("  test_thread_caching()");
+        test_thread_caching();
+        
         if(flags & Test_Flags::STRESS)
             test_memory_stress(print);
 
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <random>
+#include "_test.h"
+#include "array.h"
+#include "segmented_array.h"
+
+namespace jot
+{
+namespace tests
+{
+    template <typename T>
+    static void test_segmented_array_push_pop(Static_Array<T, 10> const& values)
+    {
+        isize mem_before = default_allocator()->get_stats().bytes_allocated;
+        isize alive_before = trackers_alive();
+        {
+            Segmented_Array<T> arr;
+            TEST(size(arr) == 0);
+            TEST(capacity(arr) == 0);
+            TEST(segment_count(arr) == 0);
+
+            push(&arr, dup(values[0]));
+            push(&arr, dup(values[1]));
+            TEST(size(arr) == 2);
+            TEST(capacity(arr) == Segmented_Array<T>::FIRST_SEGMENT_SIZE);
+            TEST(arr[0] == values[0] && arr[1] == values[1]);
+
+            //pointers stay valid while growing
+            T* first = &arr[0];
+            T* second = &arr[1];
+            for(isize i = 2; i < 2000; i++)
+                push(&arr, dup(values[i % 10]));
+
+            TEST(size(arr) == 2000);
+            TEST(first == &arr[0] && second == &arr[1]);
+            TEST(*first == values[0] && *second == values[1]);
+            for(isize i = 0; i < 2000; i++)
+                TEST(arr[i] == values[i % 10]);
+
+            //segments cover all items in order
+            isize iterated = 0;
+            for(isize s = 0; s < segment_count(arr); s++)
+                for(T const& item : segment(arr, s))
+                {
+                    TEST(item == values[iterated % 10]);
+                    iterated ++;
+                }
+            TEST(iterated == 2000);
+
+            for(isize i = 2000; i-- > 500;)
+                TEST(pop(&arr) == values[i % 10]);
+
+            TEST(size(arr) == 500);
+            TEST(*last(&arr) == values[499 % 10]);
+            TEST(is_invariant(arr));
+
+            isize capacity_before = capacity(arr);
+            shrink_to_fit(&arr);
+            isize shrunk_capacity = capacity(arr);
+            TEST(shrunk_capacity < capacity_before && shrunk_capacity >= 500);
+
+            Segmented_Array<T> copied = arr;
+            TEST(size(copied) == 500);
+            for(isize i = 0; i < 500; i++)
+                TEST(copied[i] == arr[i]);
+
+            Segmented_Array<T> moved = (Segmented_Array<T>&&) copied;
+            TEST(size(moved) == 500 && size(copied) == 0);
+            TEST(moved[499] == values[9]);
+
+            clear(&arr);
+            TEST(size(arr) == 0 && capacity(arr) == shrunk_capacity);
+            TEST(is_invariant(arr) && is_invariant(moved) && is_invariant(copied));
+        }
+        TEST(trackers_alive() == alive_before);
+        TEST(default_allocator()->get_stats().bytes_allocated == mem_before);
+    }
+
+    static void test_segmented_array_indexing()
+    {
+        using Arr = Segmented_Array<i32>;
+        Arr arr;
+        TEST(to_segment_index(arr, 0).segment == 0 && to_segment_index(arr, 0).offset == 0);
+        TEST(to_segment_index(arr, 15).segment == 0 && to_segment_index(arr, 15).offset == 15);
+        TEST(to_segment_index(arr, 16).segment == 1 && to_segment_index(arr, 16).offset == 0);
+        TEST(to_segment_index(arr, 47).segment == 1 && to_segment_index(arr, 47).offset == 31);
+        TEST(to_segment_index(arr, 48).segment == 2 && to_segment_index(arr, 48).offset == 0);
+
+        //every index maps to a unique slot in order
+        Segment_Index prev = to_segment_index(arr, 0);
+        for(isize i = 1; i < 100000; i++)
+        {
+            Segment_Index curr = to_segment_index(arr, i);
+            bool next_in_segment = curr.segment == prev.segment && curr.offset == prev.offset + 1;
+            bool next_segment = curr.segment == prev.segment + 1 && curr.offset == 0
+                && prev.offset == (Arr::FIRST_SEGMENT_SIZE << prev.segment) - 1;
+            TEST(next_in_segment || next_segment);
+            prev = curr;
+        }
+
+        reserve(&arr, 100);
+        TEST(capacity(arr) >= 100 && size(arr) == 0);
+        TEST(segment_count(arr) == 3);
+        TEST(segment(arr, 2).size == 0);
+    }
+
+    static void test_segmented_array_stress(bool print)
+    {
+        if(print) println("  test_segmented_array_stress()");
+
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        isize mem_before = default_allocator()->get_stats().bytes_allocated;
+        {
+            Segmented_Array<i64> arr;
+            Array<i64> reference;
+            Array<i64*> pointers;
+            for(isize i = 0; i < 200000; i++)
+            {
+                u32 op = gen() % 8;
+                if(op == 0 && size(reference) > 0)
+                {
+                    TEST(pop(&arr) == pop(&reference));
+                    pop(&pointers);
+                }
+                else
+                {
+                    i64 val = (i64) gen();
+                    push(&pointers, push(&arr, val));
+                    push(&reference, val);
+                }
+            }
+
+            TEST(size(arr) == size(reference));
+            for(isize i = 0; i < size(reference); i++)
+            {
+                TEST(arr[i] == reference[i]);
+                TEST(pointers[i] == &arr[i]);
+            }
+        }
+        TEST(default_allocator()->get_stats().bytes_allocated == mem_before);
+    }
+
+    static void test_segmented_array(u32 flags)
+    {
+        bool print = !(flags & Test_Flags::SILENT);
+
+        Static_Array<i32, 10>          arr1 = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+        Static_Array<Test_String, 10>  arr2 = {"1", "2", "3", "4", "5", "6", "7", "8", "9", "10"};
+        Static_Array<Tracker<i32>, 10> arr3 = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+        if(print) println("\ntest_segmented_array()");
+        test_segmented_array_indexing();
+
+        if(print) println("  type: i32");
+        test_segmented_array_push_pop(arr1);
+
+        if(print) println("  type: Test_String");
+        test_segmented_array_push_pop(arr2);
+
+        if(print) println("  type: Tracker<i32>");
+        test_segmented_array_push_pop(arr3);
+
+        if(flags & Test_Flags::STRESS)
+            test_segmented_array_stress(print);
+    }
+}
+}
@@ -1,19 +1,33 @@
 #pragma once
 
 #include "memory.h"
+#include "intrin.h"
+#include "virtual_memory.h"
 #define INTRUSIVE_LIST_SINGLE
 #include "intrusive_list.h"
 
 namespace jot 
 {
     ///Allocate lineary from block. If the block is exhausted request more memory from its parent alocator.
+    /// If use_huge_pages is set the blocks are requested in multiples of HUGE_PAGE and the whole huge pages within 
+    /// them are advised to be backed by transparent huge pages. A Page_Allocator parent additionally aligns them 
+    /// so that the entire block gets advised. With other parents the unaligned head and tail stay normal pages.
     struct Arena_Allocator : Allocator
     {
+        //Blocks are kept in two places:
+        // 1) The list [first_block, last_block] in the order of use. Blocks up to current_block are used
+        //    and the ones after it were released by reset/rewind but not yet indexed.
+        // 2) Spare bins indexed by floor(log2(size)) with a bitmask of the nonempty bins.
+        //On overflow the released blocks are moved into the bins first (each once per release so that reset 
+        // and rewind stay O(1)). Then the head of the bin of the needed size is tried and if it does not fit
+        // the head of the first nonempty bigger bin is taken which always fits. 
+
         struct Block
         {
             Block* next;
             uint32_t size;
-            uint32_t was_alloced;
+            uint16_t was_alloced;
+            uint16_t huge_page_count; //number of HUGE_PAGE ranges advised within this block
         };
 
         using Grow_Fn = isize(*)(isize);
@@ -34,17 +48,31 @@ namespace jot
         isize bytes_used = 0;
         isize max_bytes_alloced = 0;
         isize max_bytes_used = 0;
+        isize bytes_huge = 0;
         
         isize used_blocks = 0; 
         isize max_used_blocks = 0;
+
+        static constexpr isize SPARE_BIN_COUNT = 32;
+        Block* spare_bins[SPARE_BIN_COUNT] = {nullptr};
+        uint32_t spare_bin_mask = 0;
+
+        //Number of times the current block was exhausted and the blocks looked at to find a new one.
+        // blocks_scanned / overflow_count is the average per overflow
+        isize overflow_count = 0;
+        isize blocks_scanned = 0;
+        isize max_blocks_scanned = 0;
+
+        bool use_huge_pages = false;
         
         static constexpr isize ARENA_BLOCK_ALIGN = 16;
 
         explicit Arena_Allocator(
             Allocator* parent = memory_globals::default_allocator(), 
             isize chunk_size = memory_constants::PAGE,
-            Grow_Fn chunk_grow = default_arena_grow) 
-            : parent(parent), chunk_grow(chunk_grow), chunk_size(chunk_size)
+            Grow_Fn chunk_grow = default_arena_grow,
+            bool use_huge_pages = false) 
+            : parent(parent), chunk_grow(chunk_grow), chunk_size(chunk_size), use_huge_pages(use_huge_pages)
         {
             assert(is_invariant());
         }
@@ -106,6 +134,60 @@ namespace jot
             return true;
         }
 
+        ///Places the whole batch consecutively into a single block
+        virtual
+        bool allocate_batch(isize count, isize size, isize align, void** out_ptrs, Line_Info) noexcept override
+        {
+            assert(count >= 0 && size >= 0 && is_power_of_two(align));
+            if(count == 0)
+                return true;
+
+            isize stride = (size + align - 1) / align * align;
+            isize total = stride * (count - 1) + size;
+            uint8_t* aligned = (uint8_t*) align_forward(available_from, align);
+            if(aligned + total > available_to)
+            {
+                if(find_or_add_block(total, align) == false)
+                {
+                    for(isize i = 0; i < count; i++)
+                        out_ptrs[i] = nullptr;
+
+                    return false;
+                }
+
+                aligned = (uint8_t*) align_forward(available_from, align);
+            }
+
+            for(isize i = 0; i < count; i++)
+                out_ptrs[i] = aligned + i*stride;
+
+            available_from = aligned + total;
+            last_allocation = (uint8_t*) out_ptrs[count - 1];
+
+            bytes_alloced += size * count;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            return true;
+        }
+
+        virtual
+        bool deallocate_batch(isize count, isize old_size, isize align, void** allocated_ptrs, Line_Info) noexcept override
+        {
+            assert(count >= 0 && is_power_of_two(align));
+            if(count == 0)
+                return true;
+
+            //Same as deallocate frees the space only when the whole batch was the last thing allocated
+            bytes_alloced -= old_size * count;
+            isize stride = (old_size + align - 1) / align * align;
+            uint8_t* first = (uint8_t*) allocated_ptrs[0];
+            uint8_t* last = (uint8_t*) allocated_ptrs[count - 1];
+            if(last == last_allocation && last + old_size == available_from && first + stride*(count - 1) == last)
+                available_from = first;
+
+            assert(bytes_alloced >= 0);
+            return true;
+        }
+
         virtual
         Allocator_Stats get_stats() const noexcept override
         {
@@ -118,6 +200,7 @@ namespace jot
             stats.max_bytes_allocated = max_bytes_alloced;
             stats.bytes_used = bytes_used;
             stats.max_bytes_used = max_bytes_used;
+            stats.bytes_huge_page_backed = bytes_huge;
             return stats;
         }
 
@@ -138,44 +221,87 @@ namespace jot
                 passed_bytes += total_block_size;
 
                 if(prev->was_alloced)
-                    parent->deallocate(prev, total_block_size, ARENA_BLOCK_ALIGN, GET_LINE_INFO());
+                    parent->deallocate(prev, total_block_size, block_align(), GET_LINE_INFO());
             }
 
             assert(prev == last_block && "must be a valid chain!");
+
+            for(isize i = 0; i < SPARE_BIN_COUNT; i++)
+            {
+                for(Block* block = spare_bins[i]; block != nullptr; )
+                {
+                    Block* next = block->next;
+                    isize total_block_size = block->size + (isize) sizeof(Block);
+                    passed_bytes += total_block_size;
+
+                    if(block->was_alloced)
+                        parent->deallocate(block, total_block_size, block_align(), GET_LINE_INFO());
+                    block = next;
+                }
+            }
+
             assert(passed_bytes >= bytes_used);
         }
 
         void add_external_block(void* buffer, isize buffer_size)
         {
-            if(buffer_size < sizeof(Block))
+            if(buffer_size <= (isize) sizeof(Block))
                 return;
 
-            Block block_data = {0};
+            Block block_data = {};
             block_data.was_alloced = false;
-            block_data.size = (uint32_t) buffer_size - sizeof(Block);
+            block_data.size = (uint32_t) (buffer_size - (isize) sizeof(Block));
 
             Block* block = (Block*) (void*) buffer;
             *block = block_data;
 
-            Block* before = nullptr;
-            
-            Block* curr = nullptr;
-            if(current_block != nullptr)
-                curr = current_block->next;
+            push_spare(block);
+            used_blocks ++;
+            max_used_blocks = max(max_used_blocks, used_blocks);
+        }
 
-            for(; curr; before = curr, curr = curr->next)
-            {
-                if(curr->size >= buffer_size)
-                    break;
-            }
+        ///Returns all spare blocks obtained from parent back to it and discards the pages of the unused 
+        /// rest of the current block. External blocks are kept.
+        virtual
+        isize release_extra_memory() noexcept override
+        {
+            assert(is_invariant());
+            index_released_blocks();
 
-            if(before != nullptr)
+            isize released = 0;
+            for(isize i = 0; i < SPARE_BIN_COUNT; i++)
             {
-                block->next = before->next;
-                before->next = block;
+                Block* kept = nullptr;
+                for(Block* block = spare_bins[i]; block != nullptr; )
+                {
+                    Block* next = block->next;
+                    if(block->was_alloced)
+                    {
+                        isize total_block_size = block->size + (isize) sizeof(Block);
+                        bytes_huge -= block->huge_page_count * memory_constants::HUGE_PAGE;
+                        parent->deallocate(block, total_block_size, block_align(), GET_LINE_INFO());
+                        released += total_block_size;
+                        bytes_used -= total_block_size;
+                        used_blocks --;
+                    }
+                    else
+                    {
+                        block->next = kept;
+                        kept = block;
+                    }
+                    block = next;
+                }
+
+                spare_bins[i] = kept;
+                if(kept == nullptr)
+                    spare_bin_mask &= ~((uint32_t) 1 << i);
             }
 
-            insert_node_sl(&first_block, &last_block, before, block);
+            if(current_block != nullptr && current_block->was_alloced)
+                released += virtual_discard(available_from, available_to - available_from);
+
+            assert(is_invariant());
+            return released;
         }
 
         void reset() 
@@ -195,31 +321,104 @@ namespace jot
             bytes_alloced = 0;
         }
 
-        bool find_or_add_block(isize size, isize align) noexcept
+        static bool block_fits(Block* block, isize size, isize align) noexcept
         {
-            assert(is_invariant());
+            uint8_t* block_data = data(block);
+            void* aligned = align_forward(block_data, align);
+            isize aligned_size = (isize) (block_data + block->size) - (isize) aligned;
+            return aligned_size >= size;
+        }
 
-            //Tries to find an open block that would fit size and align
-            Block* curr = nullptr;
-            if(current_block != nullptr)
-                curr = current_block->next;
+        static isize spare_bin_of(isize size) noexcept
+        {
+            assert(size > 0);
+            size_t log2 = 0;
+            intrin__find_last_set_64(&log2, (uint64_t) size);
+            return (isize) log2;
+        }
+
+        void push_spare(Block* block) noexcept
+        {
+            isize bin = spare_bin_of(block->size);
+            block->next = spare_bins[bin];
+            spare_bins[bin] = block;
+            spare_bin_mask |= (uint32_t) 1 << bin;
+        }
 
-            Block* before = current_block;
+        Block* pop_spare(isize bin) noexcept
+        {
+            Block* block = spare_bins[bin];
+            assert(block != nullptr);
+            spare_bins[bin] = block->next;
+            if(spare_bins[bin] == nullptr)
+                spare_bin_mask &= ~((uint32_t) 1 << bin);
+
+            block->next = nullptr;
+            return block;
+        }
+
+        ///Moves the blocks released by reset or rewind (those after current_block) into the spare bins
+        void index_released_blocks() noexcept
+        {
+            if(current_block == nullptr)
+            {
+                assert(first_block == nullptr);
+                return;
+            }
+
+            while(current_block->next != nullptr)
+            {
+                Block* released = current_block->next;
+                current_block->next = released->next;
+                push_spare(released);
+            }
+
+            last_block = current_block;
+        }
+
+        ///Returns a spare block fitting size and align or nullptr if there is none
+        Block* take_spare_block(isize size, isize align) noexcept
+        {
+            //The worst case alignment padding. Any block of at least needed bytes fits
+            isize needed = size + align - 1;
+            if(needed <= 0 || needed > (isize) UINT32_MAX)
+                return nullptr;
+
+            isize bin = spare_bin_of(needed);
+            isize scanned = 0;
             Block* obtained = nullptr;
 
-            for(; curr; before = curr, curr = curr->next)
+            //Blocks in the bin of needed might not fit. Only the head is tried so that this stays O(1)
+            if(spare_bins[bin] != nullptr)
             {
-                uint8_t* block_data = data(curr);
-                void* aligned = align_forward(block_data, align);
-                isize aligned_size = (isize) (block_data + curr->size) - (isize) aligned;
-                if(aligned_size >= size)
-                {
-                    obtained = extract_node_sl(&first_block, &last_block, before, curr);
-                    break;
-                }
+                scanned ++;
+                if(block_fits(spare_bins[bin], size, align))
+                    obtained = pop_spare(bin);
             }
-            
-            //If found extract it
+
+            //Any block from a bigger bin fits
+            uint32_t bigger_bins = spare_bin_mask & (uint32_t) ~(((uint64_t) 2 << bin) - 1);
+            size_t found = 0;
+            if(obtained == nullptr && intrin__find_first_set_32(&found, bigger_bins))
+            {
+                scanned ++;
+                obtained = pop_spare((isize) found);
+                assert(block_fits(obtained, size, align));
+            }
+
+            overflow_count ++;
+            blocks_scanned += scanned;
+            max_blocks_scanned = max(max_blocks_scanned, scanned);
+            return obtained;
+        }
+
+        bool find_or_add_block(isize size, isize align) noexcept
+        {
+            assert(is_invariant());
+            index_released_blocks();
+
+            //Tries to find a spare block that would fit size and align
+            Block* obtained = take_spare_block(size, align);
             if(obtained == nullptr)
             {
                 if(parent == nullptr)
@@ -230,13 +429,22 @@ namespace jot
                     effective_size += align;
 
                 isize required_size = max(effective_size, chunk_size);
-                obtained = (Block*) parent->allocate(required_size, ARENA_BLOCK_ALIGN, GET_LINE_INFO());
+                if(use_huge_pages)
+                    required_size = div_round_up(required_size, memory_constants::HUGE_PAGE) * memory_constants::HUGE_PAGE;
+
+                obtained = (Block*) parent->allocate(required_size, block_align(), GET_LINE_INFO());
                 if(obtained == nullptr)
                     return false;
 
                 *obtained = Block{};
                 obtained->was_alloced = true;
                 obtained->size = (uint32_t) required_size - sizeof(Block);
+                if(use_huge_pages)
+                {
+                    isize advised = virtual_advise_huge_pages(obtained, required_size);
+                    obtained->huge_page_count = (uint16_t) (advised / memory_constants::HUGE_PAGE);
+                    bytes_huge += advised;
+                }
 
                 used_blocks ++;
                 bytes_used += required_size;
@@ -249,7 +457,7 @@ namespace jot
             assert(obtained != nullptr);
             assert(obtained != current_block);
 
-            //Add it to the end and set statistics
+            //Add it to the end of the used blocks
             insert_node_sl(&first_block, &last_block, current_block, obtained);
             available_from = data(obtained);
             available_to = available_from + obtained->size;
@@ -271,22 +479,40 @@ namespace jot
                 last = current;
                 count ++;
             }
+
+            bool bins_inv = true;
+            for(isize i = 0; i < SPARE_BIN_COUNT; i++)
+            {
+                bins_inv = bins_inv && (spare_bins[i] == nullptr) == ((spare_bin_mask & ((uint32_t) 1 << i)) == 0);
+                for(Block* current = spare_bins[i]; current; current = current->next)
+                {
+                    bins_inv = bins_inv && spare_bin_of(current->size) == i;
+                    count ++;
+                }
+            }
             
             bool blocks_inv1 = last == last_block && count == used_blocks;
-            bool blocks_inv2 = (first_block == nullptr) == (used_blocks == 0) && used_blocks >= 0;
+            bool blocks_inv2 = (first_block == nullptr) == (current_block == nullptr) && used_blocks >= 0;
 
             bool block_size_inv = chunk_size > sizeof(Block);
 
-            bool stat_inv = bytes_used >= 0 && max_bytes_used >= 0;
+            bool stat_inv = bytes_used >= 0 && max_bytes_used >= 0 && 0 <= bytes_huge && bytes_huge <= bytes_used;
 
             bool total_inv = available_inv1 && available_inv2 
-                && blocks_inv1 && blocks_inv2
+                && blocks_inv1 && blocks_inv2 && bins_inv
                 && block_size_inv
                 && stat_inv;
 
             return total_inv;
         }
 
+        //Asking for HUGE_PAGE alignment would make parents such as Malloc_Allocator waste up to 
+        // HUGE_PAGE per block. Page_Allocator aligns the huge page sized blocks on its own.
+        isize block_align() const noexcept
+        {
+            return ARENA_BLOCK_ALIGN;
+        }
+
         static isize default_arena_grow(isize current)
         {
             if(current == 0)
@@ -311,6 +537,73 @@ namespace jot
         }
     };
 
+    ///Point in an Arena_Allocator to which it can later be rewound
+    struct Arena_Mark
+    {
+        Arena_Allocator::Block* block;
+        uint8_t* available_from;
+        isize bytes_alloced;
+    };
+
+    ///Records the current position of the arena
+    inline Arena_Mark mark(Arena_Allocator const* arena) noexcept
+    {
+        return Arena_Mark{arena->current_block, arena->available_from, arena->bytes_alloced};
+    }
+
+    ///Frees all allocations made after the mark was taken in O(1). Blocks obtained after the mark
+    /// stay in the arena for reuse. Marks taken after this one become invalid.
+    inline void rewind(Arena_Allocator* arena, Arena_Mark mark) noexcept
+    {
+        //Blocks are kept in the order of use: [first_block, current_block] are used and the ones 
+        // after current_block are free. Making the marked block current thus frees all blocks used after it.
+        if(mark.block == nullptr)
+        {
+            arena->reset();
+            return;
+        }
+
+        arena->current_block = mark.block;
+        arena->available_from = mark.available_from;
+        arena->available_to = Arena_Allocator::data(mark.block) + mark.block->size;
+        arena->last_allocation = nullptr;
+        arena->bytes_alloced = mark.bytes_alloced;
+        assert(arena->is_invariant());
+    }
+
+    namespace memory_globals
+    {
+        ///Arena used by Scratch_Scope. Each thread has its own.
+        /// Its blocks are kept for reuse and come from a separate Malloc_Allocator so they dont show up in the default allocator stats
+        inline Arena_Allocator* scratch_arena() noexcept
+        {
+            thread_local static Malloc_Allocator parent;
+            thread_local static Arena_Allocator arena(&parent, 64 * memory_constants::KIBI_BYTE);
+            return &arena;
+        }
+    
+        //Upon construction sets the SCRATCH_ALLOCATOR to the arena and marks it. 
+        //Upon destruction frees everything allocated in the scope at once and restores the SCRATCH_ALLOCATOR.
+        //Does safely compose
+        struct Scratch_Scope
+        {
+            Arena_Allocator* arena;
+            Arena_Mark arena_mark;
+            Allocator_Swap swap;
+
+            Scratch_Scope(Arena_Allocator* arena = scratch_arena()) 
+                : arena(arena), arena_mark(mark(arena)), swap(arena, scratch_allocator_ptr()) 
+            {}
+
+            ~Scratch_Scope()
+            {
+                rewind(arena, arena_mark);
+            }
+        };
+    }
+
+    using memory_globals::Scratch_Scope;
+
     struct Unbound_Stack_Allocator;
     struct Unbound_Tracking_Stack_Allocator;
     //this structure should get used in the following way:
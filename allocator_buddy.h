@@ -0,0 +1,323 @@
+#pragma once
+
+#include "memory.h"
+
+namespace jot
+{
+    ///Binary buddy allocator over a single region obtained from parent. Serves blocks of min_block_size * 2^k bytes
+    /// splitting bigger blocks on allocation and merging freed blocks with their buddies in O(log n).
+    /// Because every allocation is rounded up to a power of two the wasted space is bounded by 50% and reported
+    /// as the difference between bytes_used and bytes_allocated. Supports aligns up to min_block_size.
+    struct Buddy_Allocator : Allocator
+    {
+        //Block of order k has size min_block_size << k. The region is a single block of max_order.
+        //Free blocks of each order are kept in an intrusive doubly linked list so that a buddy can be
+        // unlinked in O(1) when merging. Whether a block is free is tracked in a bitmap with one bit per
+        // block of each order: the bits of order k start at bit_offset(k) and are indexed by the block index
+        // (offset from region start / block size).
+        //The order of allocated block is recomputed from the size passed to deallocate/resize so no headers are needed.
+
+        struct Free_Block
+        {
+            Free_Block* next;
+            Free_Block* prev;
+        };
+
+        static constexpr isize MAX_ORDERS = 48;
+
+        Allocator* parent = nullptr;
+        uint8_t* region = nullptr;
+        isize region_size = 0;
+        isize min_block_size = 0;
+        isize max_order = 0;
+
+        uint64_t* free_bits = nullptr;
+        isize free_bits_size = 0;
+        Free_Block* free_lists[MAX_ORDERS] = {nullptr};
+
+        isize bytes_alloced = 0;
+        isize max_bytes_alloced = 0;
+        isize bytes_used = 0;
+        isize max_bytes_used = 0;
+        isize allocation_count = 0;
+        isize deallocation_count = 0;
+        isize resize_count = 0;
+
+        explicit Buddy_Allocator(
+            isize region_size = 256 * memory_constants::MEBI_BYTE,
+            isize min_block_size = 4 * memory_constants::KIBI_BYTE,
+            Allocator* parent = memory_globals::default_allocator()) noexcept
+            : parent(parent), min_block_size(min_block_size)
+        {
+            assert(is_power_of_two(min_block_size) && min_block_size >= (isize) sizeof(Free_Block));
+            assert(region_size >= min_block_size);
+
+            while((min_block_size << max_order) < region_size && max_order + 1 < MAX_ORDERS)
+                max_order ++;
+
+            this->region_size = min_block_size << max_order;
+            free_bits_size = div_round_up(bit_offset(max_order + 1), 64) * (isize) sizeof(uint64_t);
+
+            region = (uint8_t*) parent->allocate(this->region_size, min_block_size, GET_LINE_INFO());
+            free_bits = (uint64_t*) parent->allocate(free_bits_size, alignof(uint64_t), GET_LINE_INFO());
+            if(region == nullptr || free_bits == nullptr)
+            {
+                release_region();
+                return;
+            }
+
+            memset(free_bits, 0, (size_t) free_bits_size);
+            push_free(max_order, 0);
+            assert(is_invariant());
+        }
+
+        Buddy_Allocator(Buddy_Allocator const&) = delete;
+        Buddy_Allocator& operator=(Buddy_Allocator const&) = delete;
+
+        isize block_size(isize order) const noexcept
+        {
+            return min_block_size << order;
+        }
+
+        ///Returns the smallest order whose blocks fit size (or -1 if none)
+        isize order_of(isize size) const noexcept
+        {
+            isize order = 0;
+            while(block_size(order) < size)
+            {
+                order ++;
+                if(order > max_order)
+                    return -1;
+            }
+
+            return order;
+        }
+
+        ///Index of the first bit of the given order. Order k has region_size / block_size(k) blocks
+        isize bit_offset(isize order) const noexcept
+        {
+            //sum of N >> j for j < order where N is the block count of order 0
+            isize blocks_at_zero = (isize) 1 << max_order;
+            return 2*blocks_at_zero - 2*(blocks_at_zero >> order);
+        }
+
+        bool is_free(isize order, isize index) const noexcept
+        {
+            isize bit = bit_offset(order) + index;
+            return (free_bits[bit / 64] >> (bit % 64)) & 1;
+        }
+
+        void set_free(isize order, isize index, bool free) noexcept
+        {
+            isize bit = bit_offset(order) + index;
+            uint64_t mask = (uint64_t) 1 << (bit % 64);
+            if(free)
+                free_bits[bit / 64] |= mask;
+            else
+                free_bits[bit / 64] &= ~mask;
+        }
+
+        uint8_t* block_address(isize order, isize index) const noexcept
+        {
+            return region + index * block_size(order);
+        }
+
+        isize block_index(isize order, void* address) const noexcept
+        {
+            return ((uint8_t*) address - region) / block_size(order);
+        }
+
+        void push_free(isize order, isize index) noexcept
+        {
+            Free_Block* block = (Free_Block*) (void*) block_address(order, index);
+            block->prev = nullptr;
+            block->next = free_lists[order];
+            if(block->next != nullptr)
+                block->next->prev = block;
+
+            free_lists[order] = block;
+            set_free(order, index, true);
+        }
+
+        void unlink_free(isize order, isize index) noexcept
+        {
+            Free_Block* block = (Free_Block*) (void*) block_address(order, index);
+            if(block->prev != nullptr)
+                block->prev->next = block->next;
+            else
+                free_lists[order] = block->next;
+
+            if(block->next != nullptr)
+                block->next->prev = block->prev;
+
+            set_free(order, index, false);
+        }
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info) noexcept override
+        {
+            assert(size >= 0 && is_power_of_two(align));
+            if(region == nullptr || align > min_block_size)
+                return nullptr;
+
+            isize order = order_of(size);
+            if(order == -1)
+                return nullptr;
+
+            //Find smallest free block that fits
+            isize found = order;
+            while(found <= max_order && free_lists[found] == nullptr)
+                found ++;
+
+            if(found > max_order)
+                return nullptr;
+
+            isize index = block_index(found, free_lists[found]);
+            unlink_free(found, index);
+
+            //Split it down giving away the upper halves
+            while(found > order)
+            {
+                found --;
+                index *= 2;
+                push_free(found, index + 1);
+            }
+
+            allocation_count ++;
+            add_stats(size, block_size(order));
+            return block_address(order, index);
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info) noexcept override
+        {
+            assert(old_size >= 0 && is_power_of_two(align));
+            (void) align;
+            if(allocated == nullptr)
+                return true;
+
+            assert(region <= allocated && allocated < region + region_size && "must be allocated from this allocator");
+            isize order = order_of(old_size);
+            isize index = block_index(order, allocated);
+            assert(is_free(order, index) == false && "double free");
+
+            //Merge with buddies as long as they are free
+            while(order < max_order && is_free(order, index ^ 1))
+            {
+                unlink_free(order, index ^ 1);
+                order ++;
+                index /= 2;
+            }
+
+            push_free(order, index);
+
+            deallocation_count ++;
+            add_stats(-old_size, -block_size(order_of(old_size)));
+            return true;
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info) noexcept override
+        {
+            assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
+            (void) align;
+            resize_count ++;
+
+            isize old_order = order_of(old_size);
+            isize new_order = order_of(new_size);
+            if(new_order == -1)
+                return false;
+
+            isize index = block_index(old_order, allocated);
+            if(new_order > old_order)
+            {
+                //Can grow only if we are the left buddy and all right buddies up to new_order are free
+                isize checked = index;
+                for(isize order = old_order; order < new_order; order++, checked /= 2)
+                {
+                    if(checked % 2 != 0 || is_free(order, checked + 1) == false)
+                        return false;
+                }
+
+                for(isize order = old_order; order < new_order; order++, index /= 2)
+                    unlink_free(order, index + 1);
+            }
+            else
+            {
+                //Give away the upper halves
+                for(isize order = old_order; order > new_order; order--)
+                {
+                    index *= 2;
+                    push_free(order - 1, index + 1);
+                }
+            }
+
+            add_stats(new_size - old_size, block_size(new_order) - block_size(old_order));
+            return true;
+        }
+
+        ///bytes_used - bytes_allocated is the internal fragmentation (space lost to rounding up to power of two)
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Buddy_Allocator";
+            stats.supports_resize = true;
+            stats.parent = parent;
+
+            stats.bytes_allocated = bytes_alloced;
+            stats.max_bytes_allocated = max_bytes_alloced;
+            stats.bytes_used = bytes_used;
+            stats.max_bytes_used = max_bytes_used;
+
+            stats.allocation_count = allocation_count;
+            stats.deallocation_count = deallocation_count;
+            stats.resize_count = resize_count;
+            return stats;
+        }
+
+        ///Returns the size of the biggest block that can currently be allocated
+        isize largest_free_block() const noexcept
+        {
+            for(isize order = max_order + 1; order-- > 0;)
+                if(free_lists[order] != nullptr)
+                    return block_size(order);
+
+            return 0;
+        }
+
+        void add_stats(isize alloced_delta, isize used_delta) noexcept
+        {
+            bytes_alloced += alloced_delta;
+            bytes_used += used_delta;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            max_bytes_used = max(max_bytes_used, bytes_used);
+            assert(bytes_alloced >= 0 && bytes_used >= 0);
+        }
+
+        bool is_invariant() const noexcept
+        {
+            bool region_inv = (region == nullptr) || (region_size == block_size(max_order));
+            bool stat_inv = bytes_alloced <= bytes_used && bytes_used <= region_size;
+            return region_inv && stat_inv;
+        }
+
+        void release_region() noexcept
+        {
+            if(region != nullptr)
+                parent->deallocate(region, region_size, min_block_size, GET_LINE_INFO());
+            if(free_bits != nullptr)
+                parent->deallocate(free_bits, free_bits_size, alignof(uint64_t), GET_LINE_INFO());
+
+            region = nullptr;
+            free_bits = nullptr;
+        }
+
+        virtual
+        ~Buddy_Allocator() noexcept override
+        {
+            assert(is_invariant());
+            release_region();
+        }
+    };
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "memory.h"
+
+namespace jot
+{
+    enum class Memory_Pressure : uint8_t
+    {
+        SOFT, //usage crossed the soft limit. Good time to trim caches
+        HARD, //an allocation would exceed the hard limit and fails unless enough memory is freed
+    };
+
+    ///Called by Budget_Allocator under memory pressure. Should free memory (evict caches, shrink containers,
+    /// reset arenas...). needed is the number of bytes that would have to be freed to get back under the limit.
+    /// Can freely allocate and deallocate using the budget allocator.
+    using Memory_Pressure_Fn = void(*)(void* context, Memory_Pressure pressure, isize needed);
+
+    ///Enforces a byte budget over parent allocator. When the usage crosses soft_limit or an allocation would
+    /// exceed hard_limit the registered pressure callbacks are invoked so that the program can free memory
+    /// before the allocation is retried. Only if that does not help the allocation fails (and the usual
+    /// out of memory handling follows).
+    struct Budget_Allocator : Allocator
+    {
+        //SOFT is edge triggered: the callbacks are called once when usage rises above soft_limit and again
+        // only after it fell back below it. HARD is called on every allocation that would not fit and the
+        // callbacks are called in order of registration until enough memory is freed.
+        //The same happens when parent fails to allocate even though the budget is not exhausted.
+        //
+        //Callbacks deallocating from this allocator are fine. Allocations made from within callbacks
+        // do not trigger further callbacks.
+
+        struct Pressure_Callback
+        {
+            Memory_Pressure_Fn fn;
+            void* context;
+        };
+
+        static constexpr isize MAX_CALLBACKS = 16;
+
+        Allocator* parent = nullptr;
+        isize soft_limit = 0;
+        isize hard_limit = 0;
+
+        Pressure_Callback callbacks[MAX_CALLBACKS] = {};
+        isize callback_count = 0;
+        bool is_in_callback = false;
+        bool is_above_soft = false;
+
+        isize bytes_alloced = 0;
+        isize max_bytes_alloced = 0;
+        isize allocation_count = 0;
+        isize deallocation_count = 0;
+        isize resize_count = 0;
+
+        isize soft_pressure_count = 0;
+        isize hard_pressure_count = 0;
+        isize failed_count = 0;
+
+        explicit Budget_Allocator(
+            isize hard_limit,
+            isize soft_limit = -1,
+            Allocator* parent = memory_globals::default_allocator()) noexcept
+            : parent(parent), soft_limit(soft_limit), hard_limit(hard_limit)
+        {
+            //by default the soft limit is at 3/4 of the hard limit
+            if(this->soft_limit < 0)
+                this->soft_limit = hard_limit / 4 * 3;
+
+            assert(0 <= this->soft_limit && this->soft_limit <= hard_limit);
+        }
+
+        Budget_Allocator(Budget_Allocator const&) = delete;
+        Budget_Allocator& operator=(Budget_Allocator const&) = delete;
+
+        ///Registers a callback. Returns false if there is no space for it
+        bool add_pressure_callback(Memory_Pressure_Fn fn, void* context = nullptr) noexcept
+        {
+            if(callback_count >= MAX_CALLBACKS)
+                return false;
+
+            callbacks[callback_count ++] = Pressure_Callback{fn, context};
+            return true;
+        }
+
+        ///Unregisters a previously registered callback. Returns false if it was not found
+        bool remove_pressure_callback(Memory_Pressure_Fn fn, void* context = nullptr) noexcept
+        {
+            for(isize i = 0; i < callback_count; i++)
+            {
+                if(callbacks[i].fn == fn && callbacks[i].context == context)
+                {
+                    for(isize j = i; j < callback_count - 1; j++)
+                        callbacks[j] = callbacks[j + 1];
+
+                    callback_count --;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        ///Calls the callbacks until additional bytes fit into the hard limit. Returns true if they do
+        bool relieve_pressure(isize additional) noexcept
+        {
+            if(is_in_callback)
+                return bytes_alloced + additional <= hard_limit;
+
+            hard_pressure_count ++;
+            is_in_callback = true;
+            for(isize i = 0; i < callback_count; i++)
+            {
+                if(bytes_alloced + additional <= hard_limit)
+                    break;
+
+                callbacks[i].fn(callbacks[i].context, Memory_Pressure::HARD, bytes_alloced + additional - hard_limit);
+            }
+            is_in_callback = false;
+
+            return bytes_alloced + additional <= hard_limit;
+        }
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info callee) noexcept override
+        {
+            assert(size >= 0 && is_power_of_two(align));
+            if(bytes_alloced + size > hard_limit && relieve_pressure(size) == false)
+            {
+                failed_count ++;
+                return nullptr;
+            }
+
+            void* out = parent->allocate(size, align, callee);
+            if(out == nullptr)
+            {
+                //Parent ran out before the budget did (ie. the budget is above the real limit).
+                // Make the callbacks free at least size bytes and try again
+                if(is_in_callback == false)
+                {
+                    relieve_pressure(hard_limit - bytes_alloced + size);
+                    parent->release_extra_memory();
+                    out = parent->allocate(size, align, callee);
+                }
+
+                if(out == nullptr)
+                {
+                    failed_count ++;
+                    return nullptr;
+                }
+            }
+
+            allocation_count ++;
+            add_bytes(size);
+            return out;
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override
+        {
+            assert(old_size >= 0 && is_power_of_two(align));
+            if(allocated == nullptr)
+                return true;
+
+            deallocation_count ++;
+            add_bytes(-old_size);
+            return parent->deallocate(allocated, old_size, align, callee);
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
+            resize_count ++;
+
+            isize growth = new_size - old_size;
+            if(growth > 0 && bytes_alloced + growth > hard_limit && relieve_pressure(growth) == false)
+            {
+                failed_count ++;
+                return false;
+            }
+
+            if(parent->resize(allocated, old_size, new_size, align, callee) == false)
+                return false;
+
+            add_bytes(growth);
+            return true;
+        }
+
+        virtual
+        isize release_extra_memory() noexcept override
+        {
+            return parent->release_extra_memory();
+        }
+
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Budget_Allocator";
+            stats.supports_resize = parent->get_stats().supports_resize;
+            stats.parent = parent;
+
+            stats.bytes_allocated = bytes_alloced;
+            stats.max_bytes_allocated = max_bytes_alloced;
+
+            stats.allocation_count = allocation_count;
+            stats.deallocation_count = deallocation_count;
+            stats.resize_count = resize_count;
+            return stats;
+        }
+
+        void add_bytes(isize delta) noexcept
+        {
+            bytes_alloced += delta;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            assert(bytes_alloced >= 0);
+
+            if(bytes_alloced <= soft_limit)
+            {
+                is_above_soft = false;
+                return;
+            }
+
+            if(is_above_soft || is_in_callback)
+                return;
+
+            is_above_soft = true;
+            soft_pressure_count ++;
+            is_in_callback = true;
+            for(isize i = 0; i < callback_count; i++)
+                callbacks[i].fn(callbacks[i].context, Memory_Pressure::SOFT, bytes_alloced - soft_limit);
+            is_in_callback = false;
+        }
+
+        virtual
+        ~Budget_Allocator() noexcept override {}
+    };
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <atomic>
+#include "memory.h"
+
+namespace jot
+{
+    ///Arena that can be allocated from by any number of threads at once. Allocation is a single atomic fetch add
+    /// on the current block and new blocks are installed lock free. Meant for parallel phases whose results
+    /// all live equally long - everything is released at once by reset().
+    struct Concurrent_Arena : Allocator
+    {
+        //Blocks form a singly linked list from current_block to the oldest one. Every block header is
+        // immutable once published except for its used counter.
+        //
+        //Allocation rounds the size up to BLOCK_ALIGN and reserves extra align - BLOCK_ALIGN bytes for bigger
+        // aligns so that a plain fetch add on used always reserves enough space. If the reservation does not
+        // fit the block, used is left past its size (so the block stays full for everyone) and a new block
+        // is allocated from parent and installed with compare exchange. The thread that loses the race gives
+        // its block back and continues in the winner's block.
+        //
+        //Deallocation and resize of the last allocation of the current block are done by compare exchange
+        // on used so they also work concurrently. Everything else is a no op. Because the padding of over 
+        // aligned allocations is not known afterwards, those are never rewound or grown.
+        //
+        //Parent must be thread safe. reset() and the destructor must not be called concurrently with anything.
+
+        struct Block
+        {
+            Block* next;
+            isize size;
+            isize chunk_size;
+            std::atomic<isize> used;
+        };
+
+        using Grow_Fn = isize(*)(isize);
+
+        static constexpr isize BLOCK_ALIGN = 16;
+        static constexpr isize BLOCK_HEADER_SIZE = 64;
+
+        Allocator* parent = nullptr;
+        Grow_Fn chunk_grow = nullptr;
+        isize chunk_size = 0;
+
+        std::atomic<Block*> current_block = nullptr;
+
+        std::atomic<isize> bytes_used = 0;
+        std::atomic<isize> max_bytes_used = 0;
+        std::atomic<isize> block_count = 0;
+        std::atomic<isize> lost_install_count = 0;
+        isize max_bytes_alloced = 0;
+
+        explicit Concurrent_Arena(
+            Allocator* parent = memory_globals::default_allocator(),
+            isize chunk_size = memory_constants::PAGE,
+            Grow_Fn chunk_grow = default_arena_grow) noexcept
+            : parent(parent), chunk_grow(chunk_grow), chunk_size(chunk_size)
+        {
+            static_assert(sizeof(Block) <= BLOCK_HEADER_SIZE);
+        }
+
+        Concurrent_Arena(Concurrent_Arena const&) = delete;
+        Concurrent_Arena& operator=(Concurrent_Arena const&) = delete;
+
+        static uint8_t* block_data(Block* block) noexcept
+        {
+            return (uint8_t*) (void*) block + BLOCK_HEADER_SIZE;
+        }
+
+        static isize reserved_size(isize size, isize align) noexcept
+        {
+            isize rounded = (size + BLOCK_ALIGN - 1) / BLOCK_ALIGN * BLOCK_ALIGN;
+            return align > BLOCK_ALIGN ? rounded + align - BLOCK_ALIGN : rounded;
+        }
+
+        static bool is_in_block(Block* block, void* ptr) noexcept
+        {
+            if(block == nullptr)
+                return false;
+
+            uint8_t* data = block_data(block);
+            return data <= ptr && ptr <= data + block->size;
+        }
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info) noexcept override
+        {
+            assert(size >= 0 && is_power_of_two(align));
+            isize reserved = reserved_size(size, align);
+
+            Block* block = current_block.load(std::memory_order_acquire);
+            while(true)
+            {
+                if(block != nullptr)
+                {
+                    isize offset = block->used.fetch_add(reserved, std::memory_order_relaxed);
+                    if(offset + reserved <= block->size)
+                        return align_forward(block_data(block) + offset, align);
+                }
+
+                block = install_block(block, reserved);
+                if(block == nullptr)
+                    return nullptr;
+            }
+        }
+
+        ///Installs a new block after seen_current with space for at least reserved bytes.
+        /// Returns the new current block (ours or of a thread that was faster) or nullptr on failure
+        Block* install_block(Block* seen_current, isize reserved) noexcept
+        {
+            isize grown = seen_current != nullptr ? chunk_grow(seen_current->chunk_size) : chunk_size;
+            isize size = max(grown, reserved);
+
+            Block* block = (Block*) parent->allocate(BLOCK_HEADER_SIZE + size, BLOCK_HEADER_SIZE, GET_LINE_INFO());
+            if(block == nullptr)
+                return nullptr;
+
+            block->next = seen_current;
+            block->size = size;
+            block->chunk_size = grown;
+            block->used.store(0, std::memory_order_relaxed);
+
+            Block* expected = seen_current;
+            if(current_block.compare_exchange_strong(expected, block, std::memory_order_acq_rel, std::memory_order_acquire) == false)
+            {
+                lost_install_count.fetch_add(1, std::memory_order_relaxed);
+                parent->deallocate(block, BLOCK_HEADER_SIZE + size, BLOCK_HEADER_SIZE, GET_LINE_INFO());
+                return expected;
+            }
+
+            block_count.fetch_add(1, std::memory_order_relaxed);
+            isize used_now = bytes_used.fetch_add(BLOCK_HEADER_SIZE + size, std::memory_order_relaxed) + BLOCK_HEADER_SIZE + size;
+            isize used_max = max_bytes_used.load(std::memory_order_relaxed);
+            while(used_now > used_max && max_bytes_used.compare_exchange_weak(used_max, used_now, std::memory_order_relaxed) == false);
+
+            return block;
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info) noexcept override
+        {
+            assert(old_size >= 0 && is_power_of_two(align));
+
+            Block* block = current_block.load(std::memory_order_acquire);
+            if(align > BLOCK_ALIGN || is_in_block(block, allocated) == false)
+                return true;
+
+            isize to = (uint8_t*) allocated - block_data(block) + reserved_size(old_size, align);
+            isize from = (uint8_t*) allocated - block_data(block);
+            block->used.compare_exchange_strong(to, from, std::memory_order_relaxed);
+            return true;
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info) noexcept override
+        {
+            assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
+
+            Block* block = current_block.load(std::memory_order_acquire);
+            if(align > BLOCK_ALIGN || is_in_block(block, allocated) == false)
+                return new_size <= old_size;
+
+            isize from = (uint8_t*) allocated - block_data(block);
+            isize old_to = from + reserved_size(old_size, align);
+            isize new_to = from + reserved_size(new_size, align);
+            if(new_to <= block->size && block->used.compare_exchange_strong(old_to, new_to, std::memory_order_relaxed))
+                return true;
+
+            return new_size <= old_size;
+        }
+
+        ///Releases all allocations. Keeps only the newest (biggest) block for reuse.
+        /// Must not be called concurrently with any other operation
+        void reset() noexcept
+        {
+            isize alloced = bytes_allocated();
+            max_bytes_alloced = max(max_bytes_alloced, alloced);
+
+            Block* block = current_block.load(std::memory_order_acquire);
+            if(block == nullptr)
+                return;
+
+            release_blocks(block->next);
+            block->next = nullptr;
+            block->used.store(0, std::memory_order_relaxed);
+            block_count.store(1, std::memory_order_relaxed);
+            bytes_used.store(BLOCK_HEADER_SIZE + block->size, std::memory_order_relaxed);
+        }
+
+        ///Sum of the used parts of all blocks (including the padding added because of align)
+        isize bytes_allocated() const noexcept
+        {
+            isize sum = 0;
+            for(Block* block = current_block.load(std::memory_order_acquire); block != nullptr; block = block->next)
+                sum += min(block->used.load(std::memory_order_relaxed), block->size);
+
+            return sum;
+        }
+
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Concurrent_Arena";
+            stats.supports_resize = true;
+            stats.parent = parent;
+
+            stats.bytes_allocated = bytes_allocated();
+            stats.max_bytes_allocated = max(max_bytes_alloced, stats.bytes_allocated);
+            stats.bytes_used = bytes_used.load(std::memory_order_relaxed);
+            stats.max_bytes_used = max(max_bytes_used.load(std::memory_order_relaxed), stats.bytes_used);
+            return stats;
+        }
+
+        void release_blocks(Block* first) noexcept
+        {
+            for(Block* block = first; block != nullptr; )
+            {
+                Block* next = block->next;
+                parent->deallocate(block, BLOCK_HEADER_SIZE + block->size, BLOCK_HEADER_SIZE, GET_LINE_INFO());
+                block = next;
+            }
+        }
+
+        static isize default_arena_grow(isize current) noexcept
+        {
+            isize new_size = current * 2;
+            if(new_size > memory_constants::GIBI_BYTE)
+                new_size = memory_constants::GIBI_BYTE;
+
+            return max(new_size, memory_constants::PAGE);
+        }
+
+        virtual
+        ~Concurrent_Arena() noexcept override
+        {
+            release_blocks(current_block.load(std::memory_order_acquire));
+        }
+    };
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <atomic>
+#include "allocator_stack_ring.h"
+
+namespace jot
+{
+    ///Stack_Ring_Allocator for passing variable sized messages between threads. A single producer thread
+    /// allocates (and resizes) while any number of threads deallocate concurrently. No locks are used.
+    struct Concurrent_Stack_Ring_Allocator : Allocator
+    {
+        //Uses the same 8 byte headers and the same wrap around as Stack_Ring_Allocator (see there). The only
+        // difference is who reclaims memory:
+        //
+        //Deallocation (from any thread) only atomically clears the USED_BIT of the slot header with release order.
+        // The header is never touched by anyone else after that so the producer can safely walk over it.
+        //All reclamation (popping freed slots from the back and the front on wrap around) is done lazily
+        // by the producer at the start of each allocation. Thus the producer is the only one ever moving
+        // the pointers and writing headers. It only ever writes headers of memory that is free or was just
+        // allocated by it and not yet handed out.
+        //
+        //Because freed slots are only reclaimed on the next allocation freeing in fifo order (the typical
+        // producer/consumer pattern) reclaims through the wrap around exactly as the single threaded version.
+        //
+        //Allocations that do not fit are passed to parent which must be thread safe.
+
+        struct Slot
+        {
+            uint32_t prev_offset;
+            std::atomic<uint32_t> size;
+        };
+
+        using Base = Stack_Ring_Allocator;
+        static constexpr uint32_t STUB_BIT = Base::STUB_BIT;
+        static constexpr uint32_t USED_BIT = Base::USED_BIT;
+        static constexpr isize SIZE_MULT = Base::SIZE_MULT;
+        static constexpr isize MAX_NOT_MULT_SIZE = Base::MAX_NOT_MULT_SIZE;
+        static constexpr isize MAX_BYTE_SIZE = Base::MAX_BYTE_SIZE;
+
+        static_assert(sizeof(Slot) == sizeof(Base::Slot) && alignof(Slot) <= alignof(Base::Slot), "must keep the header format");
+
+        uint8_t* buffer_from = nullptr;
+        uint8_t* buffer_to = nullptr;
+
+        //touched only by the producer
+        uint8_t* last_block_from = nullptr;
+        uint8_t* last_block_to = nullptr;
+        uint8_t* remainder_from = nullptr;
+
+        std::atomic<isize> current_alloced = 0;
+        std::atomic<isize> max_alloced = 0;
+        std::atomic<isize> allocation_count = 0;
+        std::atomic<isize> deallocation_count = 0;
+
+        Allocator* parent = nullptr;
+
+        explicit Concurrent_Stack_Ring_Allocator(void* buffer, isize buffer_size, Allocator* parent = default_allocator())
+            : parent(parent)
+        {
+            buffer_from = (uint8_t*) buffer;
+            buffer_to = buffer_from + buffer_size;
+
+            last_block_to = buffer_from;
+            remainder_from = buffer_to;
+            last_block_from = buffer_from;
+        }
+
+        Concurrent_Stack_Ring_Allocator(Concurrent_Stack_Ring_Allocator const&) = delete;
+        Concurrent_Stack_Ring_Allocator& operator=(Concurrent_Stack_Ring_Allocator const&) = delete;
+
+        static uint32_t load_size(Slot* slot) noexcept
+        {
+            return slot->size.load(std::memory_order_acquire);
+        }
+
+        ///Must only be called from the producer thread
+        virtual
+        void* allocate(isize size, isize align, Line_Info callee) noexcept override
+        {
+            deallocate_from_back();
+            return try_allocate(size, align, callee);
+        }
+
+        void* try_allocate(isize size, isize align, Line_Info callee, bool is_second_try = false) noexcept
+        {
+            assert(is_invariant());
+            assert(size >= 0 && align > 0);
+
+            if(align <= (isize) sizeof(Slot))
+                align = sizeof(Slot);
+
+            uint8_t* available_from = last_block_to + sizeof(Slot);
+            uint8_t* aligned_from = (uint8_t*) align_forward(available_from, align);
+            uint8_t* aligned_to = (uint8_t*) align_forward(aligned_from + size, sizeof(Slot));
+
+            if(aligned_to > remainder_from || size > MAX_BYTE_SIZE)
+                return handle_wrap_around_and_allocate(size, align, callee, is_second_try);
+
+            Slot* stub = (Slot*) (void*) last_block_to;
+            Slot* slot = ((Slot*) (void*) aligned_from) - 1;
+
+            isize slot_size = ptrdiff(aligned_to, aligned_from);
+            isize stub_size = ptrdiff(slot, stub) - (isize) sizeof(Slot);
+            isize slot_offset = ptrdiff(slot, last_block_from);
+
+            uint32_t reduced_slot_size = (uint32_t) (slot_size / SIZE_MULT);
+            uint32_t reduced_stub_size = (uint32_t) (stub_size / SIZE_MULT);
+            uint32_t reduced_slot_offset = (uint32_t) (slot_offset / SIZE_MULT);
+
+            //stub first so that it gets overwritten if it aliases the slot
+            stub->size.store(reduced_stub_size, std::memory_order_relaxed);
+            stub->prev_offset = STUB_BIT;
+
+            slot->size.store(reduced_slot_size | USED_BIT, std::memory_order_relaxed);
+            slot->prev_offset = reduced_slot_offset;
+
+            last_block_to = aligned_to;
+            last_block_from = aligned_from;
+
+            allocation_count.fetch_add(1, std::memory_order_relaxed);
+            isize alloced_now = current_alloced.fetch_add(reduced_slot_size, std::memory_order_relaxed) + reduced_slot_size;
+            if(max_alloced.load(std::memory_order_relaxed) < alloced_now)
+                max_alloced.store(alloced_now, std::memory_order_relaxed);
+
+            return aligned_from;
+        }
+
+        void* handle_wrap_around_and_allocate(isize size, isize align, Line_Info callee, bool is_second_try) noexcept
+        {
+            if(is_second_try || size > bytes_used() || size > MAX_NOT_MULT_SIZE)
+                return parent->allocate(size, align, callee);
+
+            if(remainder_from != buffer_to)
+            {
+                remainder_from = deallocate_from_front(remainder_from, buffer_to);
+            }
+            else
+            {
+                uint8_t* free_to = deallocate_from_front(buffer_from, last_block_to);
+                isize curr_availible_size = ptrdiff(buffer_to, last_block_to);
+                isize new_availible_size = ptrdiff(free_to, buffer_from);
+
+                if(new_availible_size <= curr_availible_size)
+                    return parent->allocate(size, align, callee);
+
+                //Fill the rest with stub (if there is space for it)
+                if(last_block_to < buffer_to)
+                {
+                    Slot* fill_rest = (Slot*) (void*) last_block_to;
+                    isize fill_size = ptrdiff(buffer_to, fill_rest + 1);
+                    fill_rest->size.store((uint32_t) (fill_size / SIZE_MULT), std::memory_order_relaxed);
+                    fill_rest->prev_offset = STUB_BIT;
+                }
+
+                last_block_to = buffer_from;
+                remainder_from = free_to;
+                last_block_from = buffer_from;
+            }
+
+            return try_allocate(size, align, callee, true);
+        }
+
+        uint8_t* deallocate_from_front(uint8_t* from, uint8_t* to) noexcept
+        {
+            if(from == to)
+                return from;
+
+            Slot* current_used_from = (Slot*) (void*) from;
+            while (true)
+            {
+                uint32_t first_size = load_size(current_used_from);
+                if(first_size & USED_BIT)
+                    break;
+
+                uint8_t* next_used_from = ((uint8_t*) current_used_from) + first_size * SIZE_MULT + sizeof(Slot);
+                current_used_from = (Slot*) (void*) next_used_from;
+
+                if(next_used_from >= to)
+                {
+                    current_used_from = (Slot*) (void*) to;
+                    break;
+                }
+            }
+
+            return (uint8_t*) current_used_from;
+        }
+
+        void deallocate_from_back() noexcept
+        {
+            if(last_block_from == buffer_from)
+                return;
+
+            while (true)
+            {
+                Slot* last_slot = ((Slot*) (void*) last_block_from) - 1;
+                assert((last_slot->prev_offset & STUB_BIT) == false && "must not be stub");
+
+                if(load_size(last_slot) & USED_BIT)
+                    return;
+
+                last_block_from = ((uint8_t*) last_slot) - last_slot->prev_offset * SIZE_MULT;
+                last_block_to = (uint8_t*) last_slot;
+
+                if(last_block_from <= buffer_from)
+                {
+                    last_block_from = buffer_from;
+                    last_block_to = buffer_from;
+                    return;
+                }
+            }
+        }
+
+        ///Can be called from any thread
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override
+        {
+            uint8_t* ptr = (uint8_t*) allocated;
+            if(ptr < buffer_from || buffer_to <= ptr)
+                return parent->deallocate(allocated, old_size, align, callee);
+
+            Slot* slot = ((Slot*) allocated) - 1;
+            uint32_t old = slot->size.fetch_and(~USED_BIT, std::memory_order_release);
+            assert((old & USED_BIT) && "double free");
+
+            deallocation_count.fetch_add(1, std::memory_order_relaxed);
+            current_alloced.fetch_sub(old & ~USED_BIT, std::memory_order_relaxed);
+            return true;
+        }
+
+        ///Must only be called from the producer thread and only for allocations not yet handed to other threads
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            assert(is_invariant());
+
+            uint8_t* ptr = (uint8_t*) allocated;
+            if(ptr < buffer_from || buffer_to <= ptr)
+                return parent->resize(allocated, old_size, new_size, align, callee);
+
+            Slot* slot = ((Slot*) allocated) - 1;
+            Slot* current_slot = slot;
+            isize new_reduced_size = 0;
+
+            //walk forward over free slots as in Stack_Ring_Allocator::resize
+            while (true)
+            {
+                uint32_t current_size = load_size(current_slot) & ~USED_BIT;
+                Slot* next_slot = (Slot*) (void*) ((uint8_t*) current_slot + current_size * SIZE_MULT) + 1;
+
+                if((uint8_t*) next_slot >= last_block_to)
+                {
+                    uint8_t* new_end_ptr = ptr + new_size;
+                    //remainder_from <= buffer_to and past it lies the not yet reclaimed data before wrap around
+                    if(new_end_ptr > remainder_from)
+                        return false;
+
+                    uint8_t* aligned_end = (uint8_t*) align_forward(new_end_ptr, sizeof(Slot));
+                    new_reduced_size = ptrdiff(aligned_end, ptr) / SIZE_MULT;
+                    last_block_to = aligned_end;
+                    break;
+                }
+
+                uint32_t next_size = load_size(next_slot);
+                bool is_used = next_size & USED_BIT;
+                bool is_stub = next_slot->prev_offset & STUB_BIT;
+
+                if(ptrdiff(next_slot, ptr) >= new_size && is_stub == false)
+                {
+                    new_reduced_size = ptrdiff(next_slot, ptr) / SIZE_MULT;
+                    next_slot->prev_offset = (uint32_t) new_reduced_size;
+                    break;
+                }
+
+                if(is_used)
+                    return false;
+
+                current_slot = next_slot;
+            }
+
+            uint32_t old_reduced_size = load_size(slot) & ~USED_BIT;
+            slot->size.store((uint32_t) new_reduced_size | USED_BIT, std::memory_order_relaxed);
+            current_alloced.fetch_add(new_reduced_size - (isize) old_reduced_size, std::memory_order_relaxed);
+            return true;
+        }
+
+        static isize ptrdiff(void* ptr1, void* ptr2) noexcept
+        {
+            return (isize) ptr1 - (isize) ptr2;
+        }
+
+        isize bytes_used() const noexcept
+        {
+            return buffer_to - buffer_from;
+        }
+
+        bool is_invariant() const noexcept
+        {
+            bool is_last_block_aligned = align_forward(last_block_to, sizeof(Slot)) == last_block_to;
+            bool last_pointers_make_range = last_block_to >= last_block_from;
+            bool last_pointers_within_buffer = buffer_from <= last_block_from && last_block_to <= buffer_to;
+
+            return is_last_block_aligned && last_pointers_make_range && last_pointers_within_buffer;
+        }
+
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Concurrent_Stack_Ring_Allocator";
+            stats.supports_resize = true;
+            stats.parent = parent;
+            stats.bytes_allocated = current_alloced.load(std::memory_order_relaxed) * SIZE_MULT;
+            stats.bytes_used = buffer_to - buffer_from;
+
+            stats.max_bytes_allocated = max(max_alloced.load(std::memory_order_relaxed) * SIZE_MULT, stats.bytes_allocated);
+            stats.max_bytes_used = stats.bytes_used;
+
+            stats.allocation_count = allocation_count.load(std::memory_order_relaxed);
+            stats.deallocation_count = deallocation_count.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+        virtual
+        ~Concurrent_Stack_Ring_Allocator() noexcept override {}
+    };
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "allocator_arena.h"
+
+namespace jot
+{
+    ///Statistics of the block reuse of Frame_Allocator
+    struct Frame_Stats
+    {
+        isize frame_index;
+        isize generation_count;
+
+        //Blocks obtained from parent versus blocks kept from older frames that got used again
+        isize blocks_added;
+        isize blocks_reused;
+
+        isize bytes_allocated_last_frame;
+        isize max_bytes_allocated_per_frame;
+    };
+
+    ///Allocator for data that must live for a fixed number of frames (ticks of the main loop). Keeps generation_count
+    /// arenas and allocates from the one of the current frame. advance_frame() moves to the next arena and frees
+    /// everything in it at once - that is the allocations made generation_count frames ago. With the default of two
+    /// generations the data survives exactly one advance_frame() (double buffering).
+    struct Frame_Allocator : Allocator
+    {
+        //Deallocation only frees the last allocation of the current frame (as Arena_Allocator). Everything else
+        // is freed by advance_frame(). The blocks of reset arenas are kept so that a steady state main loop
+        // does not touch parent at all.
+
+        static constexpr isize MAX_GENERATIONS = 4;
+
+        Arena_Allocator arenas[MAX_GENERATIONS];
+        isize generation_count = 0;
+        isize current = 0;
+        isize frame_index = 0;
+        Allocator* parent = nullptr;
+
+        isize bytes_alloced = 0;
+        isize max_bytes_alloced = 0;
+        isize allocation_count = 0;
+        isize deallocation_count = 0;
+        isize resize_count = 0;
+
+        isize blocks_at_frame_start = 0;
+        isize blocks_added = 0;
+        isize blocks_reused = 0;
+        isize bytes_alloced_last_frame = 0;
+        isize max_bytes_alloced_per_frame = 0;
+
+        explicit Frame_Allocator(
+            isize generation_count = 2,
+            Allocator* parent = memory_globals::default_allocator(),
+            isize chunk_size = 64 * memory_constants::KIBI_BYTE) noexcept
+            : generation_count(generation_count), parent(parent)
+        {
+            assert(1 <= generation_count && generation_count <= MAX_GENERATIONS);
+            for(isize i = 0; i < MAX_GENERATIONS; i++)
+            {
+                arenas[i].parent = parent;
+                arenas[i].chunk_size = chunk_size;
+            }
+        }
+
+        Frame_Allocator(Frame_Allocator const&) = delete;
+        Frame_Allocator& operator=(Frame_Allocator const&) = delete;
+
+        Arena_Allocator* current_arena() noexcept
+        {
+            return &arenas[current];
+        }
+
+        ///Ends the current frame and frees all allocations made generation_count frames ago
+        void advance_frame() noexcept
+        {
+            Arena_Allocator* ending = &arenas[current];
+            isize used_blocks = 0;
+            if(ending->current_block != nullptr)
+                for(Arena_Allocator::Block* block = ending->first_block; ; block = block->next)
+                {
+                    used_blocks ++;
+                    if(block == ending->current_block)
+                        break;
+                }
+
+            isize added = max(ending->used_blocks - blocks_at_frame_start, 0);
+            blocks_added += added;
+            blocks_reused += max(used_blocks - added, 0);
+            bytes_alloced_last_frame = ending->bytes_alloced;
+            max_bytes_alloced_per_frame = max(max_bytes_alloced_per_frame, ending->bytes_alloced);
+
+            current = (current + 1) % generation_count;
+            frame_index ++;
+
+            Arena_Allocator* oldest = &arenas[current];
+            bytes_alloced -= oldest->bytes_alloced;
+            oldest->reset();
+            blocks_at_frame_start = oldest->used_blocks;
+        }
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info callee) noexcept override
+        {
+            void* out = arenas[current].allocate(size, align, callee);
+            if(out == nullptr)
+                return nullptr;
+
+            allocation_count ++;
+            bytes_alloced += size;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            return out;
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override
+        {
+            deallocation_count ++;
+            if(allocated == nullptr || allocated != arenas[current].last_allocation)
+                return true;
+
+            bytes_alloced -= old_size;
+            return arenas[current].deallocate(allocated, old_size, align, callee);
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            resize_count ++;
+            if(arenas[current].resize(allocated, old_size, new_size, align, callee) == false)
+                return false;
+
+            bytes_alloced += new_size - old_size;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            return true;
+        }
+
+        virtual
+        isize release_extra_memory() noexcept override
+        {
+            isize released = 0;
+            for(isize i = 0; i < generation_count; i++)
+                released += arenas[i].release_extra_memory();
+
+            blocks_at_frame_start = arenas[current].used_blocks;
+            return released;
+        }
+
+        ///bytes_allocated are the bytes of all live generations
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Frame_Allocator";
+            stats.supports_resize = true;
+            stats.parent = parent;
+
+            stats.bytes_allocated = bytes_alloced;
+            stats.max_bytes_allocated = max_bytes_alloced;
+            for(isize i = 0; i < generation_count; i++)
+            {
+                Allocator_Stats arena_stats = arenas[i].get_stats();
+                stats.bytes_used += arena_stats.bytes_used;
+                stats.max_bytes_used += arena_stats.max_bytes_used;
+            }
+
+            stats.allocation_count = allocation_count;
+            stats.deallocation_count = deallocation_count;
+            stats.resize_count = resize_count;
+            stats.blocks_added = blocks_added;
+            stats.blocks_reused = blocks_reused;
+            return stats;
+        }
+
+        Frame_Stats get_frame_stats() const noexcept
+        {
+            Frame_Stats stats = {};
+            stats.frame_index = frame_index;
+            stats.generation_count = generation_count;
+            stats.blocks_added = blocks_added;
+            stats.blocks_reused = blocks_reused;
+            stats.bytes_allocated_last_frame = bytes_alloced_last_frame;
+            stats.max_bytes_allocated_per_frame = max_bytes_alloced_per_frame;
+            return stats;
+        }
+
+        virtual
+        ~Frame_Allocator() noexcept override {}
+    };
+
+    namespace memory_globals
+    {
+        ///Frame allocator of the calling thread. Its blocks come from a separate Malloc_Allocator
+        /// so they dont show up in the default allocator stats
+        inline Frame_Allocator* frame_allocator() noexcept
+        {
+            thread_local static Malloc_Allocator parent;
+            thread_local static Frame_Allocator frame(2, &parent);
+            return &frame;
+        }
+
+        //Upon construction sets the DEFAULT_ALLOCATOR to the frame allocator so that everything allocated
+        // in the scope lives until the frame allocator advances generation_count times.
+        //Upon destruction restores the DEFAULT_ALLOCATOR.
+        //Does safely compose
+        struct Frame_Scope
+        {
+            Allocator_Swap swap;
+
+            Frame_Scope(Frame_Allocator* frame = frame_allocator())
+                : swap(frame, default_allocator_ptr())
+            {}
+        };
+    }
+
+    using memory_globals::Frame_Scope;
+}
@@ -84,7 +84,18 @@ namespace jot
 
             last_block_to = ptr + new_size;
             current_alloced += new_size - old_size;
-            return false;
+            if(max_alloced < current_alloced)
+                max_alloced = current_alloced;
+
+            return true;
+        }
+
+        ///Frees all allocations at once making the whole buffer available again
+        void reset() noexcept
+        {
+            last_block_to = buffer_from;
+            last_block_from = buffer_from;
+            current_alloced = 0;
         }
         
         virtual
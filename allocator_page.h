@@ -0,0 +1,207 @@
+#pragma once
+
+#include "memory.h"
+#include "virtual_memory.h"
+
+namespace jot
+{
+    ///Allocates whole pages directly from the os. Can back big allocations with huge pages
+    /// to reduce TLB misses of large containers (use as parent of Arena_Allocator with use_huge_pages).
+    /// Falls back to normal pages if huge pages are not available.
+    struct Page_Allocator : Allocator
+    {
+        //Allocations of at least huge_page_threshold bytes (or aligned to HUGE_PAGE) are rounded up to
+        // HUGE_PAGE and requested with the preferred huge backing. Since the backing actually obtained
+        // can differ between calls (explicit huge page pool might get exhausted) we keep a small record
+        // of every huge allocation. These are rare and always at least 2 MiB big so a linear search is fine.
+        //
+        //Huge requests are mapped HUGE_PAGE aligned so that the whole mapping consists of huge pages. Huge bytes
+        // are counted once the mapping was obtained from hugetlb or advised while transparent huge pages are enabled.
+        // The kernel might still back parts of an advised range with normal pages.
+
+        struct Huge_Record
+        {
+            void* address;
+            isize size;
+            Page_Backing backing;
+        };
+
+        Page_Backing preferred_backing = Page_Backing::NORMAL;
+        isize huge_page_threshold = 0;
+
+        Huge_Record* huge_records = nullptr;
+        isize huge_record_count = 0;
+        isize huge_record_capacity = 0;
+
+        isize bytes_alloced = 0;
+        isize max_bytes_alloced = 0;
+        isize bytes_used = 0;
+        isize max_bytes_used = 0;
+        isize bytes_huge = 0;
+        isize allocation_count = 0;
+        isize deallocation_count = 0;
+        isize resize_count = 0;
+
+        explicit Page_Allocator(
+            Page_Backing preferred_backing = Page_Backing::TRANSPARENT_HUGE,
+            isize huge_page_threshold = memory_constants::HUGE_PAGE) noexcept
+            : preferred_backing(preferred_backing), huge_page_threshold(huge_page_threshold)
+        {}
+
+        Page_Allocator(Page_Allocator const&) = delete;
+        Page_Allocator& operator=(Page_Allocator const&) = delete;
+
+        bool is_huge_request(isize size, isize align) const noexcept
+        {
+            if(preferred_backing == Page_Backing::NORMAL)
+                return false;
+
+            return size >= huge_page_threshold || align >= memory_constants::HUGE_PAGE;
+        }
+
+        isize page_rounded_size(isize size, isize align) const noexcept
+        {
+            isize page = is_huge_request(size, align) ? memory_constants::HUGE_PAGE : virtual_page_size();
+            return div_round_up(max(size, (isize) 1), page) * page;
+        }
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info) noexcept override
+        {
+            assert(size >= 0 && is_power_of_two(align));
+            bool huge = is_huge_request(size, align);
+            isize rounded = page_rounded_size(size, align);
+            isize page_align = max(align, huge ? memory_constants::HUGE_PAGE : virtual_page_size());
+
+            if(huge && push_record_capacity() == false)
+                return nullptr;
+
+            Page_Backing obtained = Page_Backing::NORMAL;
+            void* out = virtual_allocate_pages(rounded, page_align, huge ? preferred_backing : Page_Backing::NORMAL, &obtained);
+            if(out == nullptr)
+                return nullptr;
+
+            if(huge)
+            {
+                huge_records[huge_record_count ++] = Huge_Record{out, rounded, obtained};
+                if(obtained != Page_Backing::NORMAL)
+                    bytes_huge += rounded;
+            }
+
+            allocation_count ++;
+            bytes_alloced += size;
+            bytes_used += rounded;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            max_bytes_used = max(max_bytes_used, bytes_used);
+            return out;
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info) noexcept override
+        {
+            assert(old_size >= 0 && is_power_of_two(align));
+            if(allocated == nullptr)
+                return true;
+
+            isize rounded = page_rounded_size(old_size, align);
+            Page_Backing backing = Page_Backing::NORMAL;
+            if(is_huge_request(old_size, align))
+            {
+                isize found = -1;
+                for(isize i = 0; i < huge_record_count; i++)
+                {
+                    if(huge_records[i].address == allocated)
+                    {
+                        found = i;
+                        break;
+                    }
+                }
+
+                assert(found != -1 && "must be allocated from this allocator");
+                if(found == -1)
+                    return false;
+
+                backing = huge_records[found].backing;
+                assert(huge_records[found].size == rounded);
+                huge_records[found] = huge_records[huge_record_count - 1];
+                huge_record_count --;
+
+                if(backing != Page_Backing::NORMAL)
+                    bytes_huge -= rounded;
+            }
+
+            deallocation_count ++;
+            bytes_alloced -= old_size;
+            bytes_used -= rounded;
+            assert(bytes_alloced >= 0 && bytes_used >= 0 && bytes_huge >= 0);
+            return virtual_free_pages(allocated, rounded, backing);
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info) noexcept override
+        {
+            assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
+            (void) allocated;
+            resize_count ++;
+
+            //Can only resize within the already mapped pages
+            if(is_huge_request(old_size, align) != is_huge_request(new_size, align))
+                return false;
+
+            if(page_rounded_size(old_size, align) != page_rounded_size(new_size, align))
+                return false;
+
+            bytes_alloced += new_size - old_size;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            return true;
+        }
+
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Page_Allocator";
+            stats.supports_resize = true;
+
+            stats.bytes_allocated = bytes_alloced;
+            stats.max_bytes_allocated = max_bytes_alloced;
+            stats.bytes_used = bytes_used;
+            stats.max_bytes_used = max_bytes_used;
+            stats.bytes_huge_page_backed = bytes_huge;
+
+            stats.allocation_count = allocation_count;
+            stats.deallocation_count = deallocation_count;
+            stats.resize_count = resize_count;
+            return stats;
+        }
+
+        bool push_record_capacity() noexcept
+        {
+            if(huge_record_count < huge_record_capacity)
+                return true;
+
+            isize new_capacity = max(huge_record_capacity * 2, (isize) 16);
+            Huge_Record* new_records = (Huge_Record*) aligned_malloc(new_capacity * (isize) sizeof(Huge_Record), alignof(Huge_Record));
+            if(new_records == nullptr)
+                return false;
+
+            if(huge_records != nullptr)
+            {
+                memcpy(new_records, huge_records, (size_t) huge_record_count * sizeof(Huge_Record));
+                aligned_free(huge_records, alignof(Huge_Record));
+            }
+
+            huge_records = new_records;
+            huge_record_capacity = new_capacity;
+            return true;
+        }
+
+        virtual
+        ~Page_Allocator() noexcept override
+        {
+            assert(huge_record_count == 0 && "all allocations must be deallocated");
+            if(huge_records != nullptr)
+                aligned_free(huge_records, alignof(Huge_Record));
+        }
+    };
+}
@@ -0,0 +1,423 @@
+#pragma once
+
+#include "memory.h"
+
+namespace jot
+{
+    ///Statistics of a single size class of Pool_Allocator
+    struct Pool_Class_Stats
+    {
+        isize block_size;
+        isize slab_count;
+
+        isize blocks_used;
+        isize max_blocks_used;
+        isize blocks_capacity;
+
+        isize allocation_count;
+        isize deallocation_count;
+    };
+
+    ///Allocates fixed size blocks from slabs obtained from parent allocator. Each size class keeps intrusive
+    /// free list so both allocation and deallocation are O(1) in any order and no per allocation headers are needed.
+    /// Allocations bigger than MAX_BLOCK_SIZE or aligned more than BLOCK_ALIGN are passed to parent.
+    struct Pool_Allocator : Allocator
+    {
+        //Each size class is served independently:
+        // 1) pop from its free list
+        // 2) or bump from the unused tail of the last slab
+        // 3) or allocate a new slab from parent and bump from it
+        //The freed blocks simply get pushed to the free list of their class. The class is computed from the size
+        // passed to deallocate so we never need to look at any header.
+        //
+        //Slabs are only ever returned to parent on destruction. Call reset to reuse all of them at once.
+
+        struct Free_Block
+        {
+            Free_Block* next;
+        };
+
+        struct Slab
+        {
+            Slab* next;
+            isize size;
+        };
+
+        struct Size_Class
+        {
+            Free_Block* free_list = nullptr;
+            uint8_t* unused_from = nullptr;
+            uint8_t* unused_to = nullptr;
+            Slab* slabs = nullptr;
+            Pool_Class_Stats stats = {};
+        };
+
+        static constexpr isize BLOCK_ALIGN = 16;
+        static constexpr isize MAX_BLOCK_SIZE = 4 * memory_constants::KIBI_BYTE;
+        static constexpr isize SIZE_CLASS_COUNT = 16;
+        static constexpr isize SLAB_HEADER_SIZE = (sizeof(Slab) + BLOCK_ALIGN - 1) / BLOCK_ALIGN * BLOCK_ALIGN;
+
+        Allocator* parent = nullptr;
+        isize slab_size = 0;
+
+        Size_Class classes[SIZE_CLASS_COUNT];
+        uint8_t class_lookup[MAX_BLOCK_SIZE / BLOCK_ALIGN + 1] = {0};
+
+        isize bytes_alloced = 0;
+        isize max_bytes_alloced = 0;
+        isize bytes_used = 0;
+        isize max_bytes_used = 0;
+        isize parent_alloced = 0;
+        isize resize_count = 0;
+
+        explicit Pool_Allocator(
+            Allocator* parent = memory_globals::default_allocator(),
+            isize slab_size = 64 * memory_constants::KIBI_BYTE) noexcept
+            : parent(parent), slab_size(slab_size)
+        {
+            assert(slab_size >= MAX_BLOCK_SIZE + SLAB_HEADER_SIZE && "slab must fit at least one block of every class");
+
+            isize size_class = 0;
+            for(isize i = 0; i < (isize) sizeof(class_lookup); i++)
+            {
+                while(class_size(size_class) < i * BLOCK_ALIGN)
+                    size_class ++;
+
+                class_lookup[i] = (uint8_t) size_class;
+            }
+
+            for(isize i = 0; i < SIZE_CLASS_COUNT; i++)
+                classes[i].stats.block_size = class_size(i);
+
+            assert(class_size(SIZE_CLASS_COUNT - 1) == MAX_BLOCK_SIZE);
+        }
+
+        Pool_Allocator(Pool_Allocator const&) = delete;
+        Pool_Allocator& operator=(Pool_Allocator const&) = delete;
+
+        ///Returns the size of blocks used for the given size class
+        static constexpr isize class_size(isize size_class) noexcept
+        {
+            //16, 32, then alternating x1.5 and x1.33 steps: 48, 64, 96, 128, 192 ... 4096
+            // (at most 33% wasted per allocation)
+            if(size_class < 2)
+                return (size_class + 1) * BLOCK_ALIGN;
+
+            isize base = (isize) 32 << ((size_class - 2) / 2);
+            if(size_class % 2 == 0)
+                return base + base / 2;
+            else
+                return base * 2;
+        }
+
+        static bool is_pooled(isize size, isize align) noexcept
+        {
+            return size <= MAX_BLOCK_SIZE && align <= BLOCK_ALIGN;
+        }
+
+        isize size_class_of(isize size) const noexcept
+        {
+            assert(0 <= size && size <= MAX_BLOCK_SIZE);
+            return class_lookup[(size + BLOCK_ALIGN - 1) / BLOCK_ALIGN];
+        }
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info callee) noexcept override
+        {
+            assert(size >= 0 && is_power_of_two(align));
+            if(is_pooled(size, align) == false)
+            {
+                void* out = parent->allocate(size, align, callee);
+                if(out != nullptr)
+                {
+                    parent_alloced += size;
+                    add_stats(size, size);
+                }
+                return out;
+            }
+
+            isize class_i = size_class_of(size);
+            Size_Class* size_class = &classes[class_i];
+            isize block_size = size_class->stats.block_size;
+
+            void* out = nullptr;
+            if(size_class->free_list != nullptr)
+            {
+                out = size_class->free_list;
+                size_class->free_list = size_class->free_list->next;
+            }
+            else
+            {
+                if(size_class->unused_from + block_size > size_class->unused_to)
+                {
+                    if(add_slab(size_class, callee) == false)
+                        return nullptr;
+                }
+
+                out = size_class->unused_from;
+                size_class->unused_from += block_size;
+            }
+
+            size_class->stats.allocation_count ++;
+            size_class->stats.blocks_used ++;
+            size_class->stats.max_blocks_used = max(size_class->stats.max_blocks_used, size_class->stats.blocks_used);
+
+            add_stats(size, 0);
+            return out;
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override
+        {
+            assert(old_size >= 0 && is_power_of_two(align));
+            if(allocated == nullptr)
+                return true;
+
+            if(is_pooled(old_size, align) == false)
+            {
+                parent_alloced -= old_size;
+                add_stats(-old_size, -old_size);
+                return parent->deallocate(allocated, old_size, align, callee);
+            }
+
+            Size_Class* size_class = &classes[size_class_of(old_size)];
+            Free_Block* block = (Free_Block*) allocated;
+            block->next = size_class->free_list;
+            size_class->free_list = block;
+
+            size_class->stats.deallocation_count ++;
+            size_class->stats.blocks_used --;
+            assert(size_class->stats.blocks_used >= 0);
+
+            add_stats(-old_size, 0);
+            return true;
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
+            resize_count ++;
+
+            bool old_pooled = is_pooled(old_size, align);
+            bool new_pooled = is_pooled(new_size, align);
+            if(old_pooled == false && new_pooled == false)
+            {
+                if(parent->resize(allocated, old_size, new_size, align, callee) == false)
+                    return false;
+
+                parent_alloced += new_size - old_size;
+                add_stats(new_size - old_size, new_size - old_size);
+                return true;
+            }
+
+            //Can only grow/shrink within the same block size
+            if(old_pooled == false || new_pooled == false || size_class_of(old_size) != size_class_of(new_size))
+                return false;
+
+            add_stats(new_size - old_size, 0);
+            return true;
+        }
+
+        ///Takes all blocks from the same size class updating the stats once
+        virtual
+        bool allocate_batch(isize count, isize size, isize align, void** out_ptrs, Line_Info callee) noexcept override
+        {
+            assert(count >= 0 && size >= 0 && is_power_of_two(align));
+            if(is_pooled(size, align) == false)
+            {
+                if(parent->allocate_batch(count, size, align, out_ptrs, callee) == false)
+                    return false;
+
+                parent_alloced += size * count;
+                add_stats(size * count, size * count);
+                return true;
+            }
+
+            Size_Class* size_class = &classes[size_class_of(size)];
+            isize block_size = size_class->stats.block_size;
+            for(isize i = 0; i < count; i++)
+            {
+                if(size_class->free_list != nullptr)
+                {
+                    out_ptrs[i] = size_class->free_list;
+                    size_class->free_list = size_class->free_list->next;
+                    continue;
+                }
+
+                if(size_class->unused_from + block_size > size_class->unused_to && add_slab(size_class, callee) == false)
+                {
+                    //Give back the blocks taken so far
+                    for(isize j = i; j-- > 0; )
+                    {
+                        Free_Block* block = (Free_Block*) out_ptrs[j];
+                        block->next = size_class->free_list;
+                        size_class->free_list = block;
+                    }
+
+                    for(isize j = 0; j < count; j++)
+                        out_ptrs[j] = nullptr;
+
+                    return false;
+                }
+
+                out_ptrs[i] = size_class->unused_from;
+                size_class->unused_from += block_size;
+            }
+
+            size_class->stats.allocation_count += count;
+            size_class->stats.blocks_used += count;
+            size_class->stats.max_blocks_used = max(size_class->stats.max_blocks_used, size_class->stats.blocks_used);
+
+            add_stats(size * count, 0);
+            return true;
+        }
+
+        virtual
+        bool deallocate_batch(isize count, isize old_size, isize align, void** allocated_ptrs, Line_Info callee) noexcept override
+        {
+            assert(count >= 0 && old_size >= 0 && is_power_of_two(align));
+            if(is_pooled(old_size, align) == false)
+            {
+                parent_alloced -= old_size * count;
+                add_stats(-old_size * count, -old_size * count);
+                return parent->deallocate_batch(count, old_size, align, allocated_ptrs, callee);
+            }
+
+            Size_Class* size_class = &classes[size_class_of(old_size)];
+            isize deallocated = 0;
+            for(isize i = 0; i < count; i++)
+            {
+                if(allocated_ptrs[i] == nullptr)
+                    continue;
+
+                Free_Block* block = (Free_Block*) allocated_ptrs[i];
+                block->next = size_class->free_list;
+                size_class->free_list = block;
+                deallocated ++;
+            }
+
+            size_class->stats.deallocation_count += deallocated;
+            size_class->stats.blocks_used -= deallocated;
+            assert(size_class->stats.blocks_used >= 0);
+
+            add_stats(-old_size * deallocated, 0);
+            return true;
+        }
+
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Pool_Allocator";
+            stats.supports_resize = true;
+            stats.parent = parent;
+
+            stats.bytes_allocated = bytes_alloced;
+            stats.max_bytes_allocated = max_bytes_alloced;
+            stats.bytes_used = bytes_used;
+            stats.max_bytes_used = max_bytes_used;
+            stats.resize_count = resize_count;
+
+            for(isize i = 0; i < SIZE_CLASS_COUNT; i++)
+            {
+                stats.allocation_count += classes[i].stats.allocation_count;
+                stats.deallocation_count += classes[i].stats.deallocation_count;
+            }
+
+            return stats;
+        }
+
+        ///Returns the statistics of a single size class
+        Pool_Class_Stats get_class_stats(isize size_class) const noexcept
+        {
+            assert(0 <= size_class && size_class < SIZE_CLASS_COUNT);
+            return classes[size_class].stats;
+        }
+
+        ///Marks all pooled blocks as free while keeping the slabs for reuse.
+        /// Allocations passed to parent are unaffected and must still be deallocated.
+        void reset() noexcept
+        {
+            for(isize i = 0; i < SIZE_CLASS_COUNT; i++)
+            {
+                Size_Class* size_class = &classes[i];
+                size_class->free_list = nullptr;
+                size_class->unused_from = nullptr;
+                size_class->unused_to = nullptr;
+                size_class->stats.blocks_used = 0;
+
+                //Chain all blocks of all slabs into the free list
+                // (except the last slab which gets bumped from again)
+                for(Slab* slab = size_class->slabs; slab != nullptr; slab = slab->next)
+                {
+                    uint8_t* slab_from = (uint8_t*) (void*) slab + SLAB_HEADER_SIZE;
+                    uint8_t* slab_to = (uint8_t*) (void*) slab + slab->size;
+                    if(slab == size_class->slabs)
+                    {
+                        size_class->unused_from = slab_from;
+                        size_class->unused_to = slab_to;
+                        continue;
+                    }
+
+                    isize block_size = size_class->stats.block_size;
+                    for(uint8_t* block = slab_from; block + block_size <= slab_to; block += block_size)
+                    {
+                        Free_Block* free_block = (Free_Block*) (void*) block;
+                        free_block->next = size_class->free_list;
+                        size_class->free_list = free_block;
+                    }
+                }
+            }
+
+            bytes_alloced = parent_alloced;
+        }
+
+        virtual
+        ~Pool_Allocator() noexcept override
+        {
+            for(isize i = 0; i < SIZE_CLASS_COUNT; i++)
+            {
+                for(Slab* slab = classes[i].slabs; slab != nullptr; )
+                {
+                    Slab* next = slab->next;
+                    parent->deallocate(slab, slab->size, BLOCK_ALIGN, GET_LINE_INFO());
+                    slab = next;
+                }
+            }
+        }
+
+        bool add_slab(Size_Class* size_class, Line_Info callee) noexcept
+        {
+            Slab* slab = (Slab*) parent->allocate(slab_size, BLOCK_ALIGN, callee);
+            if(slab == nullptr)
+                return false;
+
+            slab->size = slab_size;
+            slab->next = size_class->slabs;
+            size_class->slabs = slab;
+
+            uint8_t* slab_from = (uint8_t*) (void*) slab + SLAB_HEADER_SIZE;
+            uint8_t* slab_to = (uint8_t*) (void*) slab + slab_size;
+            isize block_size = size_class->stats.block_size;
+
+            size_class->unused_from = slab_from;
+            size_class->unused_to = slab_to;
+            size_class->stats.slab_count ++;
+            size_class->stats.blocks_capacity += (slab_to - slab_from) / block_size;
+
+            bytes_used += slab_size;
+            max_bytes_used = max(max_bytes_used, bytes_used);
+            return true;
+        }
+
+        void add_stats(isize alloced_delta, isize used_delta) noexcept
+        {
+            bytes_alloced += alloced_delta;
+            bytes_used += used_delta;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            max_bytes_used = max(max_bytes_used, bytes_used);
+            assert(bytes_alloced >= 0 && bytes_used >= 0);
+        }
+    };
+}
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include "memory.h"
+#include "hash.h"
+#include "array.h"
+#include "format.h"
+
+namespace jot
+{
+    ///Aggregated statistics of a single allocation call site
+    struct Profiling_Site
+    {
+        Line_Info line_info;
+
+        isize bytes_live;
+        isize max_bytes_live;
+        isize bytes_total;
+
+        isize allocation_count;
+        isize deallocation_count;
+        isize resize_count;
+        isize resize_failure_count;
+    };
+
+    ///Wraps parent allocator and aggregates statistics per call site (the Line_Info passed to allocate).
+    /// The call site table is lock free so the allocator can be used from multiple threads provided the parent can.
+    /// Use format_profile_report_into / format_profile_pprof_into to get the results.
+    struct Profiling_Allocator : Allocator
+    {
+        //Each allocation gets prefixed by a small header holding the index of its call site so that
+        // deallocations and resizes (which may come from an entirely different place) are attributed to
+        // the site that made the allocation.
+        //
+        //Sites are kept in open addressed table of fixed size. A slot is claimed by CAS-ing its hash
+        // from 0 and published by setting is_ready. Once the table is full new sites get aggregated into
+        // the single overflow slot at index SITE_CAPACITY.
+
+        struct Site_Slot
+        {
+            std::atomic<uint64_t> hash;
+            std::atomic<bool> is_ready;
+            Line_Info line_info;
+
+            std::atomic<isize> bytes_live;
+            std::atomic<isize> max_bytes_live;
+            std::atomic<isize> bytes_total;
+            std::atomic<isize> allocation_count;
+            std::atomic<isize> deallocation_count;
+            std::atomic<isize> resize_count;
+            std::atomic<isize> resize_failure_count;
+        };
+
+        struct Header
+        {
+            uint32_t site;
+            uint32_t _padding;
+        };
+
+        static constexpr isize SITE_CAPACITY = 4096;
+        static constexpr isize OVERFLOW_SITE = SITE_CAPACITY;
+
+        Allocator* parent = nullptr;
+        Site_Slot* slots = nullptr;
+
+        std::atomic<isize> bytes_alloced = 0;
+        std::atomic<isize> max_bytes_alloced = 0;
+        std::atomic<isize> bytes_used = 0;
+        std::atomic<isize> max_bytes_used = 0;
+        std::atomic<isize> allocation_count = 0;
+        std::atomic<isize> deallocation_count = 0;
+        std::atomic<isize> resize_count = 0;
+
+        explicit Profiling_Allocator(Allocator* parent = memory_globals::default_allocator()) noexcept
+            : parent(parent)
+        {
+            slots = (Site_Slot*) aligned_malloc((SITE_CAPACITY + 1) * (isize) sizeof(Site_Slot), alignof(Site_Slot));
+            assert(slots != nullptr);
+            for(isize i = 0; i <= SITE_CAPACITY; i++)
+                new (&slots[i]) Site_Slot();
+
+            slots[OVERFLOW_SITE].line_info = Line_Info{"<other sites>", "<other sites>", 0};
+            slots[OVERFLOW_SITE].hash = 1;
+            slots[OVERFLOW_SITE].is_ready = true;
+        }
+
+        Profiling_Allocator(Profiling_Allocator const&) = delete;
+        Profiling_Allocator& operator=(Profiling_Allocator const&) = delete;
+
+        static isize header_size(isize align) noexcept
+        {
+            return max(align, (isize) sizeof(Header));
+        }
+
+        static Header* header_of(void* allocated) noexcept
+        {
+            return (Header*) (void*) ((uint8_t*) allocated - sizeof(Header));
+        }
+
+        static bool is_same_site(Line_Info const& a, Line_Info const& b) noexcept
+        {
+            return a.line == b.line && a.file == b.file && a.func == b.func;
+        }
+
+        static uint64_t site_hash(Line_Info const& info) noexcept
+        {
+            uint64_t hash = hash64((uint64_t) info.file ^ hash64((uint64_t) info.func ^ hash64((uint64_t) info.line)));
+            return hash < 2 ? hash + 2 : hash; //0 is empty and 1 is the overflow slot
+        }
+
+        ///Returns the index of the slot of the given call site, adding it if not yet present
+        uint32_t find_or_add_site(Line_Info const& info) noexcept
+        {
+            uint64_t hash = site_hash(info);
+            uint64_t mask = (uint64_t) SITE_CAPACITY - 1;
+            for(uint64_t i = 0; i < (uint64_t) SITE_CAPACITY; i++)
+            {
+                uint64_t slot_i = (hash + i) & mask;
+                Site_Slot* slot = &slots[slot_i];
+                uint64_t slot_hash = slot->hash.load(std::memory_order_acquire);
+                if(slot_hash == 0)
+                {
+                    if(slot->hash.compare_exchange_strong(slot_hash, hash, std::memory_order_acq_rel))
+                    {
+                        slot->line_info = info;
+                        slot->is_ready.store(true, std::memory_order_release);
+                        return (uint32_t) slot_i;
+                    }
+                }
+
+                if(slot_hash != hash)
+                    continue;
+
+                //Someone else claimed this slot with our hash. Wait until they publish the line info
+                while(slot->is_ready.load(std::memory_order_acquire) == false)
+                    ;
+
+                if(is_same_site(slot->line_info, info))
+                    return (uint32_t) slot_i;
+            }
+
+            return (uint32_t) OVERFLOW_SITE;
+        }
+
+        static void atomic_max(std::atomic<isize>* max_value, isize value) noexcept
+        {
+            isize prev = max_value->load(std::memory_order_relaxed);
+            while(prev < value && max_value->compare_exchange_weak(prev, value, std::memory_order_relaxed) == false)
+                ;
+        }
+
+        void add_live(Site_Slot* slot, isize alloced_delta, isize used_delta) noexcept
+        {
+            isize live = slot->bytes_live.fetch_add(alloced_delta, std::memory_order_relaxed) + alloced_delta;
+            isize alloced = bytes_alloced.fetch_add(alloced_delta, std::memory_order_relaxed) + alloced_delta;
+            isize used = bytes_used.fetch_add(used_delta, std::memory_order_relaxed) + used_delta;
+            if(alloced_delta > 0)
+            {
+                slot->bytes_total.fetch_add(alloced_delta, std::memory_order_relaxed);
+                atomic_max(&slot->max_bytes_live, live);
+                atomic_max(&max_bytes_alloced, alloced);
+                atomic_max(&max_bytes_used, used);
+            }
+        }
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info callee) noexcept override
+        {
+            assert(size >= 0 && is_power_of_two(align));
+            isize header = header_size(align);
+            uint8_t* allocated = (uint8_t*) parent->allocate(size + header, max(align, (isize) alignof(Header)), callee);
+            if(allocated == nullptr)
+                return nullptr;
+
+            uint32_t site = find_or_add_site(callee);
+            uint8_t* out = allocated + header;
+            *header_of(out) = Header{site, 0};
+
+            Site_Slot* slot = &slots[site];
+            slot->allocation_count.fetch_add(1, std::memory_order_relaxed);
+            allocation_count.fetch_add(1, std::memory_order_relaxed);
+            add_live(slot, size, size + header);
+            return out;
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override
+        {
+            assert(old_size >= 0 && is_power_of_two(align));
+            if(allocated == nullptr)
+                return true;
+
+            isize header = header_size(align);
+            uint32_t site = header_of(allocated)->site;
+            assert(site <= OVERFLOW_SITE && "must be allocated from this allocator");
+
+            Site_Slot* slot = &slots[site];
+            slot->deallocation_count.fetch_add(1, std::memory_order_relaxed);
+            deallocation_count.fetch_add(1, std::memory_order_relaxed);
+            add_live(slot, -old_size, -old_size - header);
+
+            return parent->deallocate((uint8_t*) allocated - header, old_size + header, max(align, (isize) alignof(Header)), callee);
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
+            isize header = header_size(align);
+            uint32_t site = header_of(allocated)->site;
+            assert(site <= OVERFLOW_SITE && "must be allocated from this allocator");
+
+            //Resizes are attributed to the site that made the allocation
+            Site_Slot* slot = &slots[site];
+            slot->resize_count.fetch_add(1, std::memory_order_relaxed);
+            resize_count.fetch_add(1, std::memory_order_relaxed);
+
+            if(parent->resize((uint8_t*) allocated - header, old_size + header, new_size + header, max(align, (isize) alignof(Header)), callee) == false)
+            {
+                slot->resize_failure_count.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            add_live(slot, new_size - old_size, new_size - old_size);
+            return true;
+        }
+
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Profiling_Allocator";
+            stats.supports_resize = parent->get_stats().supports_resize;
+            stats.parent = parent;
+
+            stats.bytes_allocated = bytes_alloced.load(std::memory_order_relaxed);
+            stats.max_bytes_allocated = max_bytes_alloced.load(std::memory_order_relaxed);
+            stats.bytes_used = bytes_used.load(std::memory_order_relaxed);
+            stats.max_bytes_used = max_bytes_used.load(std::memory_order_relaxed);
+
+            stats.allocation_count = allocation_count.load(std::memory_order_relaxed);
+            stats.deallocation_count = deallocation_count.load(std::memory_order_relaxed);
+            stats.resize_count = resize_count.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+        ///Returns the number of slots that can be queried with get_site (some might be empty)
+        isize site_slot_count() const noexcept
+        {
+            return SITE_CAPACITY + 1;
+        }
+
+        ///Fills out the snapshot of the site in the given slot. Returns false if the slot is empty
+        bool get_site(isize slot_i, Profiling_Site* site) const noexcept
+        {
+            assert(0 <= slot_i && slot_i <= SITE_CAPACITY);
+            Site_Slot const* slot = &slots[slot_i];
+            if(slot->is_ready.load(std::memory_order_acquire) == false)
+                return false;
+
+            site->line_info = slot->line_info;
+            site->bytes_live = slot->bytes_live.load(std::memory_order_relaxed);
+            site->max_bytes_live = slot->max_bytes_live.load(std::memory_order_relaxed);
+            site->bytes_total = slot->bytes_total.load(std::memory_order_relaxed);
+            site->allocation_count = slot->allocation_count.load(std::memory_order_relaxed);
+            site->deallocation_count = slot->deallocation_count.load(std::memory_order_relaxed);
+            site->resize_count = slot->resize_count.load(std::memory_order_relaxed);
+            site->resize_failure_count = slot->resize_failure_count.load(std::memory_order_relaxed);
+            return site->allocation_count > 0;
+        }
+
+        ///Returns the statistics of the call site or all zeros if it made no allocations
+        Profiling_Site get_site(Line_Info const& info) const noexcept
+        {
+            Profiling_Site site = {};
+            site.line_info = info;
+
+            uint64_t hash = site_hash(info);
+            uint64_t mask = (uint64_t) SITE_CAPACITY - 1;
+            for(uint64_t i = 0; i < (uint64_t) SITE_CAPACITY; i++)
+            {
+                uint64_t slot_i = (hash + i) & mask;
+                uint64_t slot_hash = slots[slot_i].hash.load(std::memory_order_acquire);
+                if(slot_hash == 0)
+                    break;
+
+                if(slot_hash == hash && slots[slot_i].is_ready.load(std::memory_order_acquire) && is_same_site(slots[slot_i].line_info, info))
+                {
+                    get_site((isize) slot_i, &site);
+                    break;
+                }
+            }
+
+            return site;
+        }
+
+        virtual
+        ~Profiling_Allocator() noexcept override
+        {
+            for(isize i = 0; i <= SITE_CAPACITY; i++)
+                slots[i].~Site_Slot();
+
+            aligned_free(slots, alignof(Site_Slot));
+        }
+    };
+
+    ///Collects all used sites of the allocator sorted by bytes_live (then by max_bytes_live) descending
+    inline isize get_sorted_profiling_sites(Profiling_Allocator const& profiler, Array<Profiling_Site>* sites)
+    {
+        resize(sites, 0);
+        for(isize i = 0; i < profiler.site_slot_count(); i++)
+        {
+            Profiling_Site site = {};
+            if(profiler.get_site(i, &site))
+                push(sites, site);
+        }
+
+        const auto is_before = [](Profiling_Site const& a, Profiling_Site const& b){
+            if(a.bytes_live != b.bytes_live)
+                return a.bytes_live > b.bytes_live;
+            return a.max_bytes_live > b.max_bytes_live;
+        };
+
+        //insertion sort: there are only so many call sites and this is called rarely
+        for(isize i = 1; i < size(*sites); i++)
+        {
+            Profiling_Site inserted = (*sites)[i];
+            isize j = i;
+            for(; j > 0 && is_before(inserted, (*sites)[j - 1]); j--)
+                (*sites)[j] = (*sites)[j - 1];
+
+            (*sites)[j] = inserted;
+        }
+
+        return size(*sites);
+    }
+
+    ///Formats human readable table of call sites sorted by live bytes
+    inline void format_profile_report_into(String_Builder* into, Profiling_Allocator const& profiler, isize max_sites = ISIZE_MAX)
+    {
+        Array<Profiling_Site> sites;
+        get_sorted_profiling_sites(profiler, &sites);
+
+        Allocator_Stats stats = profiler.get_stats();
+        format_into(into, "live: ", stats.bytes_allocated, "B peak: ", stats.max_bytes_allocated, "B allocations: ", stats.allocation_count, " sites: ", size(sites), "\n");
+        format_into(into, "        live         peak        total   allocs  resizes  failed  site\n");
+        for(isize i = 0; i < size(sites) && i < max_sites; i++)
+        {
+            Profiling_Site const& site = sites[i];
+            format_into(into,
+                to_padded_format(site.bytes_live, 12, ' '), " ",
+                to_padded_format(site.max_bytes_live, 12, ' '), " ",
+                to_padded_format(site.bytes_total, 12, ' '), " ");
+            format_into(into,
+                to_padded_format(site.allocation_count, 8, ' '), " ",
+                to_padded_format(site.resize_count, 8, ' '), " ",
+                to_padded_format(site.resize_failure_count, 7, ' '), "  ");
+            format_into(into, site.line_info.file, ":", site.line_info.line, " ", site.line_info.func, "\n");
+        }
+    }
+
+    ///Formats the sites in the legacy (gperftools) heap profile format readable by pprof.
+    /// Since we dont have stack traces each site is given a fake address resolved by the embedded symbol section.
+    inline void format_profile_pprof_into(String_Builder* into, Profiling_Allocator const& profiler)
+    {
+        Array<Profiling_Site> sites;
+        get_sorted_profiling_sites(profiler, &sites);
+
+        format_into(into, "--- symbol\nbinary=jot_profiling_allocator\n");
+        for(isize i = 0; i < size(sites); i++)
+        {
+            Line_Info const& info = sites[i].line_info;
+            cformat_into(into, "0x%016llx ", (unsigned long long) (i + 1));
+            format_into(into, info.func, "@", info.file, ":", info.line, "\n");
+        }
+
+        isize live_objects = 0;
+        isize live_bytes = 0;
+        isize total_objects = 0;
+        isize total_bytes = 0;
+        for(isize i = 0; i < size(sites); i++)
+        {
+            live_objects += sites[i].allocation_count - sites[i].deallocation_count;
+            live_bytes += sites[i].bytes_live;
+            total_objects += sites[i].allocation_count;
+            total_bytes += sites[i].bytes_total;
+        }
+
+        format_into(into, "---\n--- heap\n");
+        format_into(into, "heap profile: ", live_objects, ": ", live_bytes, " [", total_objects, ": ", total_bytes, "] @ heap\n");
+        for(isize i = 0; i < size(sites); i++)
+        {
+            Profiling_Site const& site = sites[i];
+            format_into(into, site.allocation_count - site.deallocation_count, ": ", site.bytes_live,
+                " [", site.allocation_count, ": ", site.bytes_total, "] @ ");
+            cformat_into(into, "0x%016llx\n", (unsigned long long) (i + 1));
+        }
+    }
+}
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <mutex>
+#include "memory.h"
+#include "array.h"
+#include "format.h"
+#include "time.h"
+
+namespace jot
+{
+    struct Registered_Allocator
+    {
+        Allocator* allocator;
+        const char* label; //optional name of the instance. Can be nullptr
+    };
+
+    ///Set of live allocators the allocator hierarchy snapshots start from.
+    /// Use the global one through register_allocator or Allocator_Registration
+    struct Allocator_Registry
+    {
+        //Registrations are rare (usually once per long lived allocator) so a single lock is fine.
+        //The lock is also held for the whole snapshot so that an allocator cannot be unregistered
+        // and destroyed while its stats are being read.
+        std::mutex mutex;
+        Malloc_Allocator storage;
+        Array<Registered_Allocator> registered = Array<Registered_Allocator>(&storage);
+    };
+
+    ///Single allocator in the hierarchy snapshot
+    struct Allocator_Node
+    {
+        Allocator* allocator;
+        const char* label;
+        Allocator_Stats stats;
+
+        isize parent;      //index of the parent node or -1 for roots
+        isize depth;       //0 for roots
+        isize child_count;
+        double utilization; //bytes_allocated / bytes_used or 0 when not tracked
+        bool is_registered; //false for the parents that were reached only through stats.parent
+    };
+
+    ///Allocator hierarchy at a single point in time. Nodes are stored depth first so each node
+    /// is followed by all of its descendants. Reuse the same snapshot when polling to avoid allocations.
+    struct Allocator_Snapshot
+    {
+        Array<Allocator_Node> nodes;
+        Array<Allocator_Node> scratch;
+        Array<isize> remap;
+        int64_t time_ns = 0;
+    };
+
+    namespace memory_globals
+    {
+        ///The process wide registry
+        inline Allocator_Registry* allocator_registry() noexcept
+        {
+            static Allocator_Registry registry;
+            return &registry;
+        }
+    }
+
+    ///Adds allocator to the registry. The allocator must be unregistered before it is destroyed.
+    inline void register_allocator(Allocator* allocator, const char* label = nullptr, Allocator_Registry* registry = memory_globals::allocator_registry()) noexcept
+    {
+        std::lock_guard<std::mutex> lock(registry->mutex);
+        push(&registry->registered, Registered_Allocator{allocator, label});
+    }
+
+    ///Removes allocator from the registry. Waits for any snapshot currently being taken.
+    /// Returns false if the allocator was not registered.
+    inline bool unregister_allocator(Allocator* allocator, Allocator_Registry* registry = memory_globals::allocator_registry()) noexcept
+    {
+        std::lock_guard<std::mutex> lock(registry->mutex);
+        Array<Registered_Allocator>* registered = &registry->registered;
+        for(isize i = 0; i < size(*registered); i++)
+        {
+            if((*registered)[i].allocator == allocator)
+            {
+                swap(&(*registered)[i], last(registered));
+                pop(registered);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    ///Registers the allocator for the lifetime of this object
+    struct Allocator_Registration
+    {
+        Allocator* allocator = nullptr;
+        Allocator_Registry* registry = nullptr;
+
+        explicit Allocator_Registration(Allocator* allocator, const char* label = nullptr, Allocator_Registry* registry = memory_globals::allocator_registry()) noexcept
+            : allocator(allocator), registry(registry)
+        {
+            register_allocator(allocator, label, registry);
+        }
+
+        Allocator_Registration(Allocator_Registration const&) = delete;
+        Allocator_Registration& operator=(Allocator_Registration const&) = delete;
+
+        ~Allocator_Registration() noexcept
+        {
+            unregister_allocator(allocator, registry);
+        }
+    };
+
+    namespace registry_internal
+    {
+        //there are only so many allocators in a program so linear searches are fine
+        inline isize find_node(Array<Allocator_Node> const& nodes, Allocator* allocator) noexcept
+        {
+            for(isize i = 0; i < size(nodes); i++)
+                if(nodes[i].allocator == allocator)
+                    return i;
+
+            return -1;
+        }
+
+        inline void push_subtree(Allocator_Snapshot* snapshot, isize index, isize depth) noexcept
+        {
+            snapshot->remap[index] = size(snapshot->nodes);
+
+            Allocator_Node node = snapshot->scratch[index];
+            node.depth = depth;
+            push(&snapshot->nodes, node);
+
+            for(isize i = 0; i < size(snapshot->scratch); i++)
+                if(snapshot->scratch[i].parent == index)
+                    push_subtree(snapshot, i, depth + 1);
+        }
+
+        inline void format_json_string_into(String_Builder* into, const char* str) noexcept
+        {
+            push(into, '"');
+            for(const char* c = str; *c != '\0'; c++)
+            {
+                if(*c == '"' || *c == '\\')
+                {
+                    push(into, '\\');
+                    push(into, *c);
+                }
+                else if((uint8_t) *c < 0x20)
+                    cformat_into(into, "\\u%04x", (unsigned) (uint8_t) *c);
+                else
+                    push(into, *c);
+            }
+            push(into, '"');
+        }
+
+        inline isize format_json_node_into(String_Builder* into, Allocator_Snapshot const& snapshot, isize index) noexcept
+        {
+            Allocator_Node const& node = snapshot.nodes[index];
+            Allocator_Stats const& stats = node.stats;
+
+            format_into(into, "{\"name\":");
+            format_json_string_into(into, stats.name != nullptr ? stats.name : "");
+            if(node.label != nullptr)
+            {
+                format_into(into, ",\"label\":");
+                format_json_string_into(into, node.label);
+            }
+
+            cformat_into(into, ",\"address\":\"%p\"", (void*) node.allocator);
+            format_into(into, ",\"registered\":", node.is_registered ? "true" : "false");
+            format_into(into, ",\"bytes_allocated\":", stats.bytes_allocated, ",\"bytes_used\":", stats.bytes_used);
+            format_into(into, ",\"max_bytes_allocated\":", stats.max_bytes_allocated, ",\"max_bytes_used\":", stats.max_bytes_used);
+            format_into(into, ",\"allocation_count\":", stats.allocation_count, ",\"deallocation_count\":", stats.deallocation_count);
+            format_into(into, ",\"resize_count\":", stats.resize_count, ",\"utilization\":", CFormat_Float{node.utilization, "%.4f"});
+            format_into(into, ",\"blocks_added\":", stats.blocks_added, ",\"blocks_reused\":", stats.blocks_reused);
+            format_into(into, ",\"children\":[");
+
+            isize next = index + 1;
+            for(isize i = 0; i < node.child_count; i++)
+            {
+                if(i > 0)
+                    push(into, ',');
+                next = format_json_node_into(into, snapshot, next);
+            }
+
+            format_into(into, "]}");
+            return next;
+        }
+    }
+
+    ///Captures the stats of all registered allocators and of all of their (transitive) parents into snapshot.
+    ///Stats of allocators used from other threads are read while they may be changing. Thread safe allocators
+    /// report consistent values, the rest may be slightly off.
+    inline void take_allocator_snapshot(Allocator_Snapshot* snapshot, Allocator_Registry* registry = memory_globals::allocator_registry()) noexcept
+    {
+        using namespace registry_internal;
+        Array<Allocator_Node>* nodes = &snapshot->scratch;
+        clear(nodes);
+        clear(&snapshot->nodes);
+
+        std::lock_guard<std::mutex> lock(registry->mutex);
+        snapshot->time_ns = clock_ns();
+        for(isize i = 0; i < size(registry->registered); i++)
+        {
+            Registered_Allocator const& registered = registry->registered[i];
+            if(find_node(*nodes, registered.allocator) != -1)
+                continue;
+
+            Allocator_Node node = {};
+            node.allocator = registered.allocator;
+            node.label = registered.label;
+            node.is_registered = true;
+            push(nodes, node);
+        }
+
+        //Query the stats and discover the parents. Newly added parents are visited by the same loop.
+        for(isize i = 0; i < size(*nodes); i++)
+        {
+            Allocator_Stats stats = (*nodes)[i].allocator->get_stats();
+            (*nodes)[i].stats = stats;
+            if(stats.bytes_used > 0)
+                (*nodes)[i].utilization = (double) stats.bytes_allocated / (double) stats.bytes_used;
+
+            if(stats.parent != nullptr && find_node(*nodes, stats.parent) == -1)
+            {
+                Allocator_Node node = {};
+                node.allocator = stats.parent;
+                push(nodes, node);
+            }
+        }
+
+        for(isize i = 0; i < size(*nodes); i++)
+        {
+            Allocator_Node* node = &(*nodes)[i];
+            node->parent = node->stats.parent != nullptr ? find_node(*nodes, node->stats.parent) : -1;
+            //Allocators reporting themselves as their parent would make infinite tree
+            if(node->parent == i)
+                node->parent = -1;
+        }
+
+        //Break parent cycles (which should not exist but the stats are user provided)
+        for(isize i = 0; i < size(*nodes); i++)
+        {
+            isize steps = 0;
+            for(isize at = (*nodes)[i].parent; at != -1; at = (*nodes)[at].parent)
+            {
+                if(++steps > size(*nodes))
+                {
+                    (*nodes)[i].parent = -1;
+                    break;
+                }
+            }
+        }
+
+        //Order depth first
+        resize(&snapshot->remap, size(*nodes));
+        for(isize i = 0; i < size(*nodes); i++)
+            if((*nodes)[i].parent == -1)
+                push_subtree(snapshot, i, 0);
+
+        for(isize i = 0; i < size(snapshot->nodes); i++)
+        {
+            Allocator_Node* node = &snapshot->nodes[i];
+            if(node->parent != -1)
+            {
+                node->parent = snapshot->remap[node->parent];
+                snapshot->nodes[node->parent].child_count ++;
+            }
+        }
+    }
+
+    ///Formats the snapshot as indented human readable table
+    inline void format_allocator_snapshot_into(String_Builder* into, Allocator_Snapshot const& snapshot)
+    {
+        const isize NAME_COLUMN = 40;
+        format_into(into, "allocator                                  allocated         used     max alloc     max used   allocs deallocs   util\n");
+        for(isize i = 0; i < size(snapshot.nodes); i++)
+        {
+            Allocator_Node const& node = snapshot.nodes[i];
+            Allocator_Stats const& stats = node.stats;
+
+            isize name_from = size(*into);
+            for(isize j = 0; j < node.depth; j++)
+                format_into(into, "  ");
+
+            format_into(into, stats.name != nullptr ? stats.name : "?");
+            if(node.label != nullptr)
+                format_into(into, " '", node.label, "'");
+
+            for(isize j = size(*into) - name_from; j < NAME_COLUMN; j++)
+                push(into, ' ');
+
+            format_into(into, " ",
+                to_padded_format(stats.bytes_allocated, 12, ' '), " ",
+                to_padded_format(stats.bytes_used, 12, ' '), " ",
+                to_padded_format(stats.max_bytes_allocated, 12, ' '), " ",
+                to_padded_format(stats.max_bytes_used, 12, ' '), " ");
+            format_into(into,
+                to_padded_format(stats.allocation_count, 8, ' '), " ",
+                to_padded_format(stats.deallocation_count, 8, ' '), " ",
+                CFormat_Float{node.utilization * 100, "%5.1f%%"}, "\n");
+        }
+    }
+
+    ///Formats the snapshot as JSON object {"time_ns": ..., "allocators": [...]} with children nested in their parents
+    inline void format_allocator_snapshot_json_into(String_Builder* into, Allocator_Snapshot const& snapshot)
+    {
+        format_into(into, "{\"time_ns\":", snapshot.time_ns, ",\"allocators\":[");
+        isize index = 0;
+        for(bool first = true; index < size(snapshot.nodes); first = false)
+        {
+            if(first == false)
+                push(into, ',');
+            index = registry_internal::format_json_node_into(into, snapshot, index);
+        }
+        format_into(into, "]}");
+    }
+}
@@ -120,7 +120,10 @@ namespace jot
 
             last_block_to = ptr + new_size;
             current_alloced += new_size - old_size;
-            return false;
+            if(max_alloced < current_alloced)
+                max_alloced = current_alloced;
+
+            return true;
         }
         
         virtual
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "memory.h"
+#include "virtual_memory.h"
   
 namespace jot
 {
@@ -395,6 +396,15 @@ namespace jot
             return stats;
         }
 
+        ///Discards the pages of the currently unused part of the buffer. The buffer itself is not owned
+        /// and stays valid
+        virtual
+        isize release_extra_memory() noexcept override
+        {
+            assert(is_invariant());
+            return virtual_discard(last_block_to, remainder_from - last_block_to);
+        }
+
         virtual
         ~Stack_Ring_Allocator() noexcept override {}
     };
@@ -0,0 +1,754 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include "memory.h"
+#include "virtual_memory.h"
+
+namespace jot
+{
+    namespace thread_cache_internal
+    {
+        struct Cache;
+        struct Thread_Registry;
+    }
+
+    ///General purpose allocator usable from any number of threads at once. Memory allocated on one thread can be
+    /// deallocated (or resized) on any other thread.
+    struct Thread_Caching_Allocator : Allocator
+    {
+        //Small allocations are served from per thread caches. Each cache owns "spans" - SPAN_SIZE aligned chunks
+        // of memory split into blocks of a single size class. Because spans are aligned we can find the span
+        // (and through it the owning cache) of any block by simply aligning its address backwards. This means
+        // we dont need any per allocation header.
+        //
+        //Allocation pops a block from the first span in the list of partially filled spans of the size class.
+        // When there is none left it drains the blocks freed by other threads and only then asks the shared
+        // central heap for an empty span. The central heap is a lock protected list of empty spans. It is only
+        // touched once per span worth of allocations so the lock is practically never contended.
+        //
+        //Deallocation on the owning thread pushes the block to its span free list. Deallocation on any other
+        // thread pushes the block onto the owning cache's remote free queue (lock free multi producer stack)
+        // which gets drained by the owner once it runs out of blocks. Spans that become entirely free are kept
+        // in the cache up to MAX_CACHED_EMPTY_SPANS and the rest is given back to the central heap.
+        //
+        //Spans are carved out of SPAN_REGION_SIZE regions mapped directly from the os with SPAN_SIZE alignment.
+        // Obtaining each span from aligned_malloc would waste nearly a whole span on alignment padding.
+        //
+        //Allocations bigger than MAX_SMALL_SIZE or aligned to more than BLOCK_ALIGN go straight to aligned_malloc
+        // which is thread safe.
+        //
+        //When a thread exits its caches are marked as abandoned and get adopted (with all of their memory and
+        // pending remote frees) by the next thread that starts using the allocator. Before mapping a new region
+        // the empty spans of abandoned caches are given to the central heap so that the memory of exited threads
+        // gets reused even when their caches are not adopted.
+        //
+        //The allocator itself must outlive all of its allocations and must not be used while it is being destroyed.
+
+        struct Free_Block
+        {
+            Free_Block* next;
+        };
+
+        struct Span
+        {
+            thread_cache_internal::Cache* owner;
+            Span* prev; //links within the partial list of its size class
+            Span* next;
+            Span* next_region; //links the regions through their first span (for destruction)
+
+            Free_Block* free_list;
+            uint8_t* unused_from; //never yet allocated tail of the span
+            uint8_t* unused_to;
+
+            int32_t size_class;
+            int32_t used_count;
+            bool is_listed;
+        };
+
+        static constexpr isize BLOCK_ALIGN = 16;
+        static constexpr isize SPAN_SIZE = 64 * memory_constants::KIBI_BYTE;
+        static constexpr isize SPAN_REGION_SIZE = 16 * SPAN_SIZE;
+        static constexpr isize SPAN_HEADER_SIZE = (sizeof(Span) + BLOCK_ALIGN - 1) / BLOCK_ALIGN * BLOCK_ALIGN;
+        static constexpr isize MAX_SMALL_SIZE = 8 * memory_constants::KIBI_BYTE;
+        static constexpr isize SIZE_CLASS_COUNT = 32;
+        static constexpr isize MAX_CACHED_EMPTY_SPANS = 4;
+
+        std::atomic<thread_cache_internal::Cache*> first_cache = nullptr;
+        uint64_t id = 0;
+        Thread_Caching_Allocator* next_live = nullptr;
+
+        std::mutex central_mutex;
+        Span* central_spans = nullptr;
+        Span* regions = nullptr;
+        uint8_t* region_from = nullptr; //not yet used part of the last region
+        uint8_t* region_to = nullptr;
+        isize central_span_count = 0;
+        isize allocated_span_count = 0;
+
+        std::atomic<isize> bytes_used = 0;
+        std::atomic<isize> max_bytes_used = 0;
+
+        uint8_t class_lookup[MAX_SMALL_SIZE / BLOCK_ALIGN + 1] = {0};
+
+        Thread_Caching_Allocator() noexcept;
+        Thread_Caching_Allocator(Thread_Caching_Allocator const&) = delete;
+        Thread_Caching_Allocator& operator=(Thread_Caching_Allocator const&) = delete;
+
+        virtual void* allocate(isize size, isize align, Line_Info callee) noexcept override;
+        virtual bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override;
+        virtual bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override;
+        virtual Allocator_Stats get_stats() const noexcept override;
+        virtual ~Thread_Caching_Allocator() noexcept override;
+
+        ///Returns the size of blocks used for the given size class
+        static constexpr isize class_size(isize size_class) noexcept
+        {
+            //16 B steps up to 128 B then 4 steps per power of two up to MAX_SMALL_SIZE
+            // (at most 25% wasted per allocation)
+            if(size_class < 8)
+                return (size_class + 1) * BLOCK_ALIGN;
+
+            isize group = (size_class - 8) / 4;
+            isize step = (size_class - 8) % 4;
+            isize base = (isize) 128 << group;
+            return base + base / 4 * (step + 1);
+        }
+
+        static bool is_small(isize size, isize align) noexcept
+        {
+            return size <= MAX_SMALL_SIZE && align <= BLOCK_ALIGN;
+        }
+
+        isize size_class_of(isize size) const noexcept
+        {
+            assert(0 <= size && size <= MAX_SMALL_SIZE);
+            return class_lookup[(size + BLOCK_ALIGN - 1) / BLOCK_ALIGN];
+        }
+
+        static Span* span_of(void* block) noexcept
+        {
+            return (Span*) align_backward(block, SPAN_SIZE);
+        }
+
+        thread_cache_internal::Cache* get_cache() noexcept;
+        thread_cache_internal::Cache* adopt_or_create_cache() noexcept;
+
+        void* allocate_small(thread_cache_internal::Cache* cache, isize size_class) noexcept;
+        void deallocate_local(thread_cache_internal::Cache* cache, Span* span, Free_Block* block) noexcept;
+        bool drain_remote_frees(thread_cache_internal::Cache* cache) noexcept;
+
+        Span* obtain_span(thread_cache_internal::Cache* cache, isize size_class) noexcept;
+        Span* take_central_span(bool map_new) noexcept;
+        void reclaim_abandoned_spans() noexcept;
+        void release_span(thread_cache_internal::Cache* cache, Span* span) noexcept;
+        void link_span(thread_cache_internal::Cache* cache, Span* span) noexcept;
+        void unlink_span(thread_cache_internal::Cache* cache, Span* span) noexcept;
+        void add_used(isize bytes) noexcept;
+    };
+}
+
+namespace jot
+{
+    namespace thread_cache_internal
+    {
+        using Span = Thread_Caching_Allocator::Span;
+        using Free_Block = Thread_Caching_Allocator::Free_Block;
+
+        ///Per thread state of a single Thread_Caching_Allocator. All non atomic fields are only ever touched
+        /// by the owning thread. The atomic stats are only written by the owning thread as well but read by all.
+        struct Cache
+        {
+            Thread_Caching_Allocator* allocator;
+            Cache* next_cache;
+
+            std::atomic<bool> is_abandoned;
+            std::atomic<Free_Block*> remote_frees;
+
+            Span* partial[Thread_Caching_Allocator::SIZE_CLASS_COUNT];
+            Span* empty_spans;
+            isize empty_span_count;
+
+            std::atomic<isize> bytes_allocated;
+            std::atomic<isize> max_bytes_allocated;
+            std::atomic<isize> allocation_count;
+            std::atomic<isize> deallocation_count;
+            std::atomic<isize> resize_count;
+        };
+
+        //single writer counters dont need atomic read modify write which keeps them cheap
+        inline void add_relaxed(std::atomic<isize>* counter, isize value) noexcept
+        {
+            counter->store(counter->load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        inline void add_allocated(Cache* cache, isize bytes) noexcept
+        {
+            add_relaxed(&cache->bytes_allocated, bytes);
+            isize now = cache->bytes_allocated.load(std::memory_order_relaxed);
+            if(now > cache->max_bytes_allocated.load(std::memory_order_relaxed))
+                cache->max_bytes_allocated.store(now, std::memory_order_relaxed);
+        }
+
+        struct Registry_Entry
+        {
+            uint64_t allocator_id;
+            Cache* cache;
+            Registry_Entry* next;
+        };
+
+        inline std::mutex* live_mutex() noexcept
+        {
+            static std::mutex mutex;
+            return &mutex;
+        }
+
+        inline Thread_Caching_Allocator** live_allocators() noexcept
+        {
+            static Thread_Caching_Allocator* first = nullptr;
+            return &first;
+        }
+
+        inline uint64_t next_allocator_id() noexcept
+        {
+            static std::atomic<uint64_t> counter = 0;
+            return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        ///Maps allocators to caches of the current thread. On thread exit abandons all caches of still
+        /// living allocators so that they can be adopted by other threads.
+        struct Thread_Registry
+        {
+            uint64_t last_id = 0;
+            Cache* last_cache = nullptr;
+            Registry_Entry* first = nullptr;
+
+            ~Thread_Registry() noexcept
+            {
+                std::lock_guard<std::mutex> lock(*live_mutex());
+                for(Registry_Entry* entry = first; entry != nullptr; )
+                {
+                    for(Thread_Caching_Allocator* alloc = *live_allocators(); alloc; alloc = alloc->next_live)
+                    {
+                        if(alloc->id == entry->allocator_id)
+                        {
+                            entry->cache->is_abandoned.store(true, std::memory_order_release);
+                            break;
+                        }
+                    }
+
+                    Registry_Entry* next = entry->next;
+                    JOT_FREE(entry);
+                    entry = next;
+                }
+            }
+        };
+
+        inline Thread_Registry* thread_registry() noexcept
+        {
+            thread_local static Thread_Registry registry;
+            return &registry;
+        }
+    }
+
+    inline Thread_Caching_Allocator::Thread_Caching_Allocator() noexcept
+    {
+        isize size_class = 0;
+        for(isize i = 0; i < (isize) sizeof(class_lookup); i++)
+        {
+            while(class_size(size_class) < i * BLOCK_ALIGN)
+                size_class ++;
+
+            class_lookup[i] = (uint8_t) size_class;
+        }
+
+        assert(class_size(SIZE_CLASS_COUNT - 1) == MAX_SMALL_SIZE);
+        assert(SPAN_SIZE - SPAN_HEADER_SIZE >= MAX_SMALL_SIZE);
+
+        id = thread_cache_internal::next_allocator_id();
+        std::lock_guard<std::mutex> lock(*thread_cache_internal::live_mutex());
+        next_live = *thread_cache_internal::live_allocators();
+        *thread_cache_internal::live_allocators() = this;
+    }
+
+    inline Thread_Caching_Allocator::~Thread_Caching_Allocator() noexcept
+    {
+        using namespace thread_cache_internal;
+        {
+            std::lock_guard<std::mutex> lock(*live_mutex());
+            Thread_Caching_Allocator** prev = live_allocators();
+            for(; *prev != nullptr; prev = &(*prev)->next_live)
+            {
+                if(*prev == this)
+                {
+                    *prev = next_live;
+                    break;
+                }
+            }
+        }
+
+        for(Span* region = regions; region != nullptr; )
+        {
+            Span* next = region->next_region;
+            virtual_free_pages(region, SPAN_REGION_SIZE, Page_Backing::NORMAL);
+            region = next;
+        }
+
+        for(Cache* cache = first_cache.load(); cache != nullptr; )
+        {
+            Cache* next = cache->next_cache;
+            cache->~Cache();
+            aligned_free(cache, alignof(Cache));
+            cache = next;
+        }
+    }
+
+    inline thread_cache_internal::Cache* Thread_Caching_Allocator::get_cache() noexcept
+    {
+        using namespace thread_cache_internal;
+        Thread_Registry* registry = thread_registry();
+        if(registry->last_id == id)
+            return registry->last_cache;
+
+        Registry_Entry* found = nullptr;
+        for(Registry_Entry* entry = registry->first; entry != nullptr; entry = entry->next)
+        {
+            if(entry->allocator_id == id)
+            {
+                found = entry;
+                break;
+            }
+        }
+
+        if(found == nullptr)
+        {
+            found = (Registry_Entry*) JOT_MALLOC(sizeof(Registry_Entry));
+            if(found == nullptr)
+                return nullptr;
+
+            found->cache = adopt_or_create_cache();
+            if(found->cache == nullptr)
+            {
+                JOT_FREE(found);
+                return nullptr;
+            }
+
+            found->allocator_id = id;
+            found->next = registry->first;
+            registry->first = found;
+        }
+
+        registry->last_id = id;
+        registry->last_cache = found->cache;
+        return found->cache;
+    }
+
+    inline thread_cache_internal::Cache* Thread_Caching_Allocator::adopt_or_create_cache() noexcept
+    {
+        using namespace thread_cache_internal;
+        for(Cache* cache = first_cache.load(std::memory_order_acquire); cache != nullptr; cache = cache->next_cache)
+        {
+            bool expected = true;
+            if(cache->is_abandoned.load(std::memory_order_relaxed)
+                && cache->is_abandoned.compare_exchange_strong(expected, false, std::memory_order_acquire))
+                return cache;
+        }
+
+        Cache* cache = (Cache*) aligned_malloc(sizeof(Cache), alignof(Cache));
+        if(cache == nullptr)
+            return nullptr;
+
+        new(cache) Cache();
+        cache->allocator = this;
+        cache->is_abandoned.store(false, std::memory_order_relaxed);
+        cache->remote_frees.store(nullptr, std::memory_order_relaxed);
+        for(isize i = 0; i < SIZE_CLASS_COUNT; i++)
+            cache->partial[i] = nullptr;
+
+        cache->empty_spans = nullptr;
+        cache->empty_span_count = 0;
+        cache->bytes_allocated.store(0, std::memory_order_relaxed);
+        cache->max_bytes_allocated.store(0, std::memory_order_relaxed);
+        cache->allocation_count.store(0, std::memory_order_relaxed);
+        cache->deallocation_count.store(0, std::memory_order_relaxed);
+        cache->resize_count.store(0, std::memory_order_relaxed);
+
+        Cache* head = first_cache.load(std::memory_order_relaxed);
+        do {
+            cache->next_cache = head;
+        } while(first_cache.compare_exchange_weak(head, cache, std::memory_order_release, std::memory_order_relaxed) == false);
+
+        return cache;
+    }
+
+    inline void Thread_Caching_Allocator::add_used(isize bytes) noexcept
+    {
+        isize now = bytes_used.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        isize max = max_bytes_used.load(std::memory_order_relaxed);
+        while(now > max && max_bytes_used.compare_exchange_weak(max, now, std::memory_order_relaxed) == false);
+    }
+
+    inline void Thread_Caching_Allocator::link_span(thread_cache_internal::Cache* cache, Span* span) noexcept
+    {
+        //We link as second so that the current (first) span stays the same
+        // and we keep allocating from a single hot span
+        assert(span->is_listed == false);
+        Span** head = &cache->partial[span->size_class];
+        span->is_listed = true;
+        span->prev = nullptr;
+        if(*head == nullptr)
+        {
+            span->next = nullptr;
+            *head = span;
+            return;
+        }
+
+        span->prev = *head;
+        span->next = (*head)->next;
+        if(span->next != nullptr)
+            span->next->prev = span;
+        (*head)->next = span;
+    }
+
+    inline void Thread_Caching_Allocator::unlink_span(thread_cache_internal::Cache* cache, Span* span) noexcept
+    {
+        assert(span->is_listed);
+        if(span->prev != nullptr)
+            span->prev->next = span->next;
+        else
+            cache->partial[span->size_class] = span->next;
+
+        if(span->next != nullptr)
+            span->next->prev = span->prev;
+
+        span->prev = nullptr;
+        span->next = nullptr;
+        span->is_listed = false;
+    }
+
+    inline Thread_Caching_Allocator::Span* Thread_Caching_Allocator::obtain_span(thread_cache_internal::Cache* cache, isize size_class) noexcept
+    {
+        Span* span = cache->empty_spans;
+        if(span != nullptr)
+        {
+            cache->empty_spans = span->next;
+            cache->empty_span_count --;
+        }
+        else
+        {
+            span = take_central_span(false);
+            if(span == nullptr)
+            {
+                reclaim_abandoned_spans();
+                span = take_central_span(true);
+            }
+
+            if(span == nullptr)
+                return nullptr;
+        }
+
+        uint8_t* span_data = (uint8_t*) (void*) span;
+        span->owner = cache;
+        span->prev = nullptr;
+        span->next = nullptr;
+        span->free_list = nullptr;
+        span->unused_from = span_data + SPAN_HEADER_SIZE;
+        span->unused_to = span_data + SPAN_SIZE;
+        span->size_class = (int32_t) size_class;
+        span->used_count = 0;
+        span->is_listed = false;
+        return span;
+    }
+
+    inline Thread_Caching_Allocator::Span* Thread_Caching_Allocator::take_central_span(bool map_new) noexcept
+    {
+        std::lock_guard<std::mutex> lock(central_mutex);
+        Span* span = central_spans;
+        if(span != nullptr)
+        {
+            central_spans = span->next;
+            central_span_count --;
+            return span;
+        }
+
+        if(map_new == false)
+            return nullptr;
+
+        if(region_from == region_to)
+        {
+            Page_Backing obtained = Page_Backing::NORMAL;
+            Span* region = (Span*) virtual_allocate_pages(SPAN_REGION_SIZE, SPAN_SIZE, Page_Backing::NORMAL, &obtained);
+            if(region == nullptr)
+                return nullptr;
+
+            region->next_region = regions;
+            regions = region;
+            region_from = (uint8_t*) (void*) region;
+            region_to = region_from + SPAN_REGION_SIZE;
+            add_used(SPAN_REGION_SIZE);
+        }
+
+        //next_region is set only on the first span of each region and is never touched afterwards
+        span = (Span*) (void*) region_from;
+        region_from += SPAN_SIZE;
+        allocated_span_count ++;
+        return span;
+    }
+
+    inline void Thread_Caching_Allocator::reclaim_abandoned_spans() noexcept
+    {
+        using namespace thread_cache_internal;
+        for(Cache* cache = first_cache.load(std::memory_order_acquire); cache != nullptr; cache = cache->next_cache)
+        {
+            //claim the cache so that it cannot be adopted while we touch it
+            bool expected = true;
+            if(cache->is_abandoned.load(std::memory_order_relaxed) == false
+                || cache->is_abandoned.compare_exchange_strong(expected, false, std::memory_order_acquire) == false)
+                continue;
+
+            drain_remote_frees(cache);
+
+            //the owner is gone so even the current spans of size classes can be taken
+            for(isize i = 0; i < SIZE_CLASS_COUNT; i++)
+            {
+                for(Span* span = cache->partial[i]; span != nullptr; )
+                {
+                    Span* next = span->next;
+                    if(span->used_count == 0)
+                    {
+                        unlink_span(cache, span);
+                        span->next = cache->empty_spans;
+                        cache->empty_spans = span;
+                        cache->empty_span_count ++;
+                    }
+                    span = next;
+                }
+            }
+
+            if(cache->empty_spans != nullptr)
+            {
+                std::lock_guard<std::mutex> lock(central_mutex);
+                while(cache->empty_spans != nullptr)
+                {
+                    Span* span = cache->empty_spans;
+                    cache->empty_spans = span->next;
+                    span->owner = nullptr;
+                    span->next = central_spans;
+                    central_spans = span;
+                    central_span_count ++;
+                }
+                cache->empty_span_count = 0;
+            }
+
+            cache->is_abandoned.store(true, std::memory_order_release);
+        }
+    }
+
+    inline void Thread_Caching_Allocator::release_span(thread_cache_internal::Cache* cache, Span* span) noexcept
+    {
+        assert(span->used_count == 0);
+        if(span->is_listed)
+            unlink_span(cache, span);
+
+        if(cache->empty_span_count < MAX_CACHED_EMPTY_SPANS)
+        {
+            span->next = cache->empty_spans;
+            cache->empty_spans = span;
+            cache->empty_span_count ++;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(central_mutex);
+        span->owner = nullptr;
+        span->next = central_spans;
+        central_spans = span;
+        central_span_count ++;
+    }
+
+    inline void* Thread_Caching_Allocator::allocate_small(thread_cache_internal::Cache* cache, isize size_class) noexcept
+    {
+        isize block_size = class_size(size_class);
+        while(true)
+        {
+            Span* span = cache->partial[size_class];
+            if(span == nullptr)
+            {
+                if(drain_remote_frees(cache))
+                    continue;
+
+                span = obtain_span(cache, size_class);
+                if(span == nullptr)
+                    return nullptr;
+
+                link_span(cache, span);
+            }
+
+            if(span->free_list != nullptr)
+            {
+                Free_Block* block = span->free_list;
+                span->free_list = block->next;
+                span->used_count ++;
+                return block;
+            }
+
+            if(span->unused_from + block_size <= span->unused_to)
+            {
+                void* block = span->unused_from;
+                span->unused_from += block_size;
+                span->used_count ++;
+                return block;
+            }
+
+            //span is full - it gets relinked once something gets freed
+            unlink_span(cache, span);
+        }
+    }
+
+    inline void Thread_Caching_Allocator::deallocate_local(thread_cache_internal::Cache* cache, Span* span, Free_Block* block) noexcept
+    {
+        assert(span->owner == cache);
+        block->next = span->free_list;
+        span->free_list = block;
+        span->used_count --;
+        assert(span->used_count >= 0);
+
+        if(span->is_listed == false)
+            link_span(cache, span);
+
+        //we keep the current span even if empty to not thrash on alloc free loops
+        if(span->used_count == 0 && cache->partial[span->size_class] != span)
+            release_span(cache, span);
+    }
+
+    inline bool Thread_Caching_Allocator::drain_remote_frees(thread_cache_internal::Cache* cache) noexcept
+    {
+        if(cache->remote_frees.load(std::memory_order_relaxed) == nullptr)
+            return false;
+
+        Free_Block* block = cache->remote_frees.exchange(nullptr, std::memory_order_acquire);
+        bool drained_any = block != nullptr;
+        while(block != nullptr)
+        {
+            Free_Block* next = block->next;
+            deallocate_local(cache, span_of(block), block);
+            block = next;
+        }
+
+        return drained_any;
+    }
+
+    inline void* Thread_Caching_Allocator::allocate(isize size, isize align, Line_Info) noexcept
+    {
+        using namespace thread_cache_internal;
+        assert(size >= 0 && is_power_of_two(align));
+        Cache* cache = get_cache();
+        if(cache == nullptr)
+            return nullptr;
+
+        void* out = nullptr;
+        if(is_small(size, align))
+            out = allocate_small(cache, size_class_of(size));
+        else
+        {
+            out = aligned_malloc(size, align);
+            if(out != nullptr)
+                add_used(size);
+        }
+
+        if(out == nullptr)
+            return nullptr;
+
+        add_allocated(cache, size);
+        add_relaxed(&cache->allocation_count, 1);
+        return out;
+    }
+
+    inline bool Thread_Caching_Allocator::deallocate(void* allocated, isize old_size, isize align, Line_Info) noexcept
+    {
+        using namespace thread_cache_internal;
+        assert(old_size >= 0 && is_power_of_two(align));
+        if(allocated == nullptr)
+            return true;
+
+        Cache* cache = get_cache();
+        if(is_small(old_size, align))
+        {
+            Span* span = span_of(allocated);
+            Free_Block* block = (Free_Block*) allocated;
+            assert(span->size_class == size_class_of(old_size) && "size must match the allocated size class");
+
+            if(span->owner == cache)
+                deallocate_local(cache, span, block);
+            else
+            {
+                Cache* owner = span->owner;
+                Free_Block* head = owner->remote_frees.load(std::memory_order_relaxed);
+                do {
+                    block->next = head;
+                } while(owner->remote_frees.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed) == false);
+            }
+        }
+        else
+        {
+            aligned_free(allocated, align);
+            bytes_used.fetch_sub(old_size, std::memory_order_relaxed);
+        }
+
+        //if we failed to create cache we still free but cannot track the stats
+        if(cache != nullptr)
+        {
+            add_relaxed(&cache->bytes_allocated, -old_size);
+            add_relaxed(&cache->deallocation_count, 1);
+        }
+        return true;
+    }
+
+    inline bool Thread_Caching_Allocator::resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info) noexcept
+    {
+        using namespace thread_cache_internal;
+        assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
+        Cache* cache = get_cache();
+        if(cache == nullptr)
+            return false;
+
+        add_relaxed(&cache->resize_count, 1);
+        if(is_small(old_size, align) == false || is_small(new_size, align) == false)
+            return false;
+
+        //The block can grow up to the size of its size class
+        if(size_class_of(old_size) != size_class_of(new_size))
+            return false;
+
+        assert(span_of(allocated)->size_class == size_class_of(old_size));
+        add_allocated(cache, new_size - old_size);
+        return true;
+    }
+
+    inline Allocator_Stats Thread_Caching_Allocator::get_stats() const noexcept
+    {
+        using namespace thread_cache_internal;
+        Allocator_Stats stats = {};
+        stats.name = "Thread_Caching_Allocator";
+        stats.supports_resize = true;
+
+        //Per thread counters can be individually negative (freed on other thread) but sum up correctly.
+        // The sum of per thread maximums is an upper bound of the real maximum
+        for(Cache* cache = first_cache.load(std::memory_order_acquire); cache != nullptr; cache = cache->next_cache)
+        {
+            stats.bytes_allocated += cache->bytes_allocated.load(std::memory_order_relaxed);
+            stats.max_bytes_allocated += cache->max_bytes_allocated.load(std::memory_order_relaxed);
+            stats.allocation_count += cache->allocation_count.load(std::memory_order_relaxed);
+            stats.deallocation_count += cache->deallocation_count.load(std::memory_order_relaxed);
+            stats.resize_count += cache->resize_count.load(std::memory_order_relaxed);
+        }
+
+        stats.bytes_used = bytes_used.load(std::memory_order_relaxed);
+        stats.max_bytes_used = max_bytes_used.load(std::memory_order_relaxed);
+        if(stats.max_bytes_used < stats.bytes_used)
+            stats.max_bytes_used = stats.bytes_used;
+        if(stats.max_bytes_allocated < stats.bytes_allocated)
+            stats.max_bytes_allocated = stats.bytes_allocated;
+
+        return stats;
+    }
+}
@@ -0,0 +1,438 @@
+#pragma once
+
+#include "memory.h"
+#include "intrin.h"
+
+namespace jot
+{
+    ///Two-Level Segregated Fit allocator. Allocate, deallocate and resize are all O(1) in the worst case
+    /// which makes it suitable for latency sensitive code. Allocates from caller supplied buffer and
+    /// optionally grows by requesting chunk_size big pools from parent (pass nullptr to disable).
+    struct Tlsf_Allocator : Allocator
+    {
+        //Every block is prefixed by Block header (the first two fields) and adjacent blocks are always coalesced.
+        // Free blocks additionally store free list links in their payload. Free blocks are binned by size into
+        // FL_COUNT first level classes (powers of two) each split into SL_COUNT linear second level classes.
+        // A bitmap of non empty first level classes and one bitmap of non empty second level classes per first
+        // level let us find a big enough free block with two find first set instructions.
+        //
+        //  size:  [0, 256)     [256, 512)     [512, 1024)   ...
+        //  fl:     0            1              2
+        //  sl:     16 B steps   16 B steps     32 B steps
+        //
+        //Each pool ends with a zero sized used sentinel block so that the next physical block always exists.
+
+        struct Block
+        {
+            Block* prev_physical;
+            usize size_and_flags;
+
+            //only valid when the block is free
+            Block* next_free;
+            Block* prev_free;
+        };
+
+        struct Pool
+        {
+            Pool* next;
+            isize size;
+        };
+
+        static constexpr isize ALIGN_LOG2 = 4;
+        static constexpr isize ALIGN = (isize) 1 << ALIGN_LOG2;
+        static constexpr isize SL_LOG2 = 4;
+        static constexpr isize SL_COUNT = (isize) 1 << SL_LOG2;
+        static constexpr isize FL_SHIFT = SL_LOG2 + ALIGN_LOG2;
+        static constexpr isize FL_MAX_LOG2 = sizeof(void*) == 8 ? 40 : 30;
+        static constexpr isize FL_COUNT = FL_MAX_LOG2 - FL_SHIFT + 1;
+        static constexpr isize SMALL_BLOCK = (isize) 1 << FL_SHIFT;
+
+        static constexpr isize HEADER = 2 * sizeof(void*) <= ALIGN ? ALIGN : 2 * sizeof(void*);
+        static constexpr isize MIN_PAYLOAD = ALIGN;
+        static constexpr isize MAX_PAYLOAD = ((isize) 1 << FL_MAX_LOG2) - ALIGN;
+        static constexpr isize POOL_HEADER = (isize) sizeof(Pool) <= ALIGN ? ALIGN : (isize) sizeof(Pool);
+
+        static constexpr usize FREE_BIT = 1;
+        static constexpr usize PREV_FREE_BIT = 2;
+        static constexpr usize FLAG_MASK = 3;
+
+        Allocator* parent = nullptr;
+        Pool* parent_pools = nullptr;
+        isize chunk_size = 0;
+
+        uint64_t fl_bitmap = 0;
+        uint32_t sl_bitmaps[FL_COUNT] = {0};
+        Block* free_lists[FL_COUNT][SL_COUNT] = {{nullptr}};
+
+        isize bytes_alloced = 0;
+        isize max_bytes_alloced = 0;
+        isize bytes_used = 0;
+        isize max_bytes_used = 0;
+        isize allocation_count = 0;
+        isize deallocation_count = 0;
+        isize resize_count = 0;
+
+        explicit Tlsf_Allocator(
+            void* buffer = nullptr, isize buffer_size = 0,
+            Allocator* parent = memory_globals::default_allocator(),
+            isize chunk_size = memory_constants::MEBI_BYTE) noexcept
+            : parent(parent), chunk_size(chunk_size)
+        {
+            if(buffer != nullptr)
+                add_pool(buffer, buffer_size);
+        }
+
+        Tlsf_Allocator(Tlsf_Allocator const&) = delete;
+        Tlsf_Allocator& operator=(Tlsf_Allocator const&) = delete;
+
+        static isize block_size(Block const* block) noexcept        { return (isize) (block->size_and_flags & ~FLAG_MASK); }
+        static bool is_free(Block const* block) noexcept            { return (block->size_and_flags & FREE_BIT) != 0; }
+        static bool is_prev_free(Block const* block) noexcept       { return (block->size_and_flags & PREV_FREE_BIT) != 0; }
+        static uint8_t* payload(Block* block) noexcept              { return (uint8_t*) (void*) block + HEADER; }
+        static Block* block_of(void* payload) noexcept              { return (Block*) (void*) ((uint8_t*) payload - HEADER); }
+        static Block* next_physical(Block* block) noexcept          { return (Block*) (void*) (payload(block) + block_size(block)); }
+
+        static void set_size(Block* block, isize size) noexcept
+        {
+            block->size_and_flags = (usize) size | (block->size_and_flags & FLAG_MASK);
+        }
+
+        static void set_flag(Block* block, usize flag, bool to) noexcept
+        {
+            if(to)
+                block->size_and_flags |= flag;
+            else
+                block->size_and_flags &= ~flag;
+        }
+
+        static void mapping_insert(isize size, isize* fl, isize* sl) noexcept
+        {
+            if(size < SMALL_BLOCK)
+            {
+                *fl = 0;
+                *sl = size / (SMALL_BLOCK / SL_COUNT);
+                return;
+            }
+
+            size_t log2 = 0;
+            intrin__find_last_set_64(&log2, (uint64_t) size);
+            *sl = (isize) ((usize) size >> (log2 - SL_LOG2)) ^ SL_COUNT;
+            *fl = (isize) log2 - FL_SHIFT + 1;
+        }
+
+        ///Rounds up the size to the next class boundary so that any block in its class is big enough
+        static isize search_size(isize size) noexcept
+        {
+            if(size >= SMALL_BLOCK)
+            {
+                size_t log2 = 0;
+                intrin__find_last_set_64(&log2, (uint64_t) size);
+                size += ((isize) 1 << (log2 - SL_LOG2)) - 1;
+            }
+
+            return size;
+        }
+
+        static void mapping_search(isize size, isize* fl, isize* sl) noexcept
+        {
+            mapping_insert(search_size(size), fl, sl);
+        }
+
+        void insert_free(Block* block) noexcept
+        {
+            isize fl = 0, sl = 0;
+            mapping_insert(block_size(block), &fl, &sl);
+            assert(fl < FL_COUNT);
+
+            Block* head = free_lists[fl][sl];
+            block->next_free = head;
+            block->prev_free = nullptr;
+            if(head != nullptr)
+                head->prev_free = block;
+
+            free_lists[fl][sl] = block;
+            fl_bitmap |= (uint64_t) 1 << fl;
+            sl_bitmaps[fl] |= (uint32_t) 1 << sl;
+            set_flag(block, FREE_BIT, true);
+            set_flag(next_physical(block), PREV_FREE_BIT, true);
+        }
+
+        void remove_free(Block* block) noexcept
+        {
+            isize fl = 0, sl = 0;
+            mapping_insert(block_size(block), &fl, &sl);
+
+            if(block->prev_free != nullptr)
+                block->prev_free->next_free = block->next_free;
+            else
+                free_lists[fl][sl] = block->next_free;
+
+            if(block->next_free != nullptr)
+                block->next_free->prev_free = block->prev_free;
+
+            if(free_lists[fl][sl] == nullptr)
+            {
+                sl_bitmaps[fl] &= ~((uint32_t) 1 << sl);
+                if(sl_bitmaps[fl] == 0)
+                    fl_bitmap &= ~((uint64_t) 1 << fl);
+            }
+
+            set_flag(block, FREE_BIT, false);
+            set_flag(next_physical(block), PREV_FREE_BIT, false);
+        }
+
+        ///Finds and removes free block of at least size bytes. Returns nullptr if there is none
+        Block* take_free(isize size) noexcept
+        {
+            isize fl = 0, sl = 0;
+            mapping_search(size, &fl, &sl);
+            if(fl >= FL_COUNT)
+                return nullptr;
+
+            uint32_t sl_map = sl_bitmaps[fl] & (~(uint32_t) 0 << sl);
+            if(sl_map == 0)
+            {
+                uint64_t fl_map = fl + 1 < 64 ? fl_bitmap & (~(uint64_t) 0 << (fl + 1)) : 0;
+                size_t found_fl = 0;
+                if(intrin__find_first_set_64(&found_fl, fl_map) == false)
+                    return nullptr;
+
+                fl = (isize) found_fl;
+                sl_map = sl_bitmaps[fl];
+            }
+
+            size_t found_sl = 0;
+            intrin__find_first_set_32(&found_sl, sl_map);
+            Block* block = free_lists[fl][found_sl];
+            assert(block != nullptr && block_size(block) >= size);
+            remove_free(block);
+            return block;
+        }
+
+        ///Splits off the part of used block past size and gives it back as free block (merged with its next block if free)
+        void trim_used(Block* block, isize size) noexcept
+        {
+            if(block_size(block) < size + HEADER + MIN_PAYLOAD)
+                return;
+
+            Block* rest = (Block*) (void*) (payload(block) + size);
+            rest->size_and_flags = 0;
+            set_size(rest, block_size(block) - size - HEADER);
+            rest->prev_physical = block;
+            set_size(block, size);
+
+            Block* next = next_physical(rest);
+            next->prev_physical = rest;
+            if(is_free(next))
+            {
+                remove_free(next);
+                set_size(rest, block_size(rest) + HEADER + block_size(next));
+                next_physical(rest)->prev_physical = rest;
+            }
+
+            insert_free(rest);
+        }
+
+        static isize payload_size(isize size) noexcept
+        {
+            if(size < MIN_PAYLOAD)
+                size = MIN_PAYLOAD;
+
+            return (size + ALIGN - 1) & ~(ALIGN - 1);
+        }
+
+        ///Adds memory to be allocated from. The memory must outlive the allocator
+        bool add_pool(void* memory, isize memory_size) noexcept
+        {
+            uint8_t* from = (uint8_t*) align_forward(memory, ALIGN);
+            isize usable = memory_size - (from - (uint8_t*) memory);
+            isize size = (usable - 2*HEADER) & ~(ALIGN - 1);
+            if(size < MIN_PAYLOAD)
+                return false;
+
+            if(size > MAX_PAYLOAD)
+                size = MAX_PAYLOAD;
+
+            Block* block = (Block*) (void*) from;
+            block->prev_physical = nullptr;
+            block->size_and_flags = 0;
+            set_size(block, size);
+
+            Block* sentinel = next_physical(block);
+            sentinel->prev_physical = block;
+            sentinel->size_and_flags = 0;
+
+            insert_free(block);
+            bytes_used += size + 2*HEADER;
+            max_bytes_used = max(max_bytes_used, bytes_used);
+            return true;
+        }
+
+        bool add_parent_pool(isize needed_payload, Line_Info callee) noexcept
+        {
+            if(parent == nullptr)
+                return false;
+
+            //the block must be big enough to land in the class take_free searches
+            isize pool_size = max(chunk_size, search_size(needed_payload) + POOL_HEADER + 3*HEADER + ALIGN);
+            Pool* pool = (Pool*) parent->allocate(pool_size, ALIGN, callee);
+            if(pool == nullptr)
+                return false;
+
+            pool->size = pool_size;
+            pool->next = parent_pools;
+            parent_pools = pool;
+
+            return add_pool((uint8_t*) (void*) pool + POOL_HEADER, pool_size - POOL_HEADER);
+        }
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info callee) noexcept override
+        {
+            assert(size >= 0 && is_power_of_two(align));
+            isize needed = payload_size(size);
+            if(needed > MAX_PAYLOAD)
+                return nullptr;
+
+            //overaligned allocations need extra space so that the leading gap can become a free block
+            isize searched = needed;
+            if(align > ALIGN)
+                searched = needed + align + HEADER + MIN_PAYLOAD;
+
+            Block* block = take_free(searched);
+            if(block == nullptr)
+            {
+                if(add_parent_pool(searched, callee) == false)
+                    return nullptr;
+
+                block = take_free(searched);
+                if(block == nullptr)
+                    return nullptr;
+            }
+
+            if(align > ALIGN)
+            {
+                uint8_t* from = payload(block);
+                uint8_t* aligned = (uint8_t*) align_forward(from, align);
+                if(aligned != from && aligned - from < HEADER + MIN_PAYLOAD)
+                    aligned = (uint8_t*) align_forward(from + HEADER + MIN_PAYLOAD, align);
+
+                if(aligned != from)
+                {
+                    isize gap = aligned - from;
+                    Block* moved = block_of(aligned);
+                    moved->size_and_flags = 0;
+                    set_size(moved, block_size(block) - gap);
+                    moved->prev_physical = block;
+                    next_physical(moved)->prev_physical = moved;
+
+                    set_size(block, gap - HEADER);
+                    insert_free(block);
+                    set_flag(next_physical(moved), PREV_FREE_BIT, false);
+                    block = moved;
+                }
+            }
+
+            trim_used(block, needed);
+
+            allocation_count ++;
+            bytes_alloced += size;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            return payload(block);
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info) noexcept override
+        {
+            assert(old_size >= 0 && is_power_of_two(align));
+            (void) align;
+            if(allocated == nullptr)
+                return true;
+
+            Block* block = block_of(allocated);
+            assert(is_free(block) == false && "double free");
+            assert(block_size(block) >= old_size && "must be allocated from this allocator");
+
+            if(is_prev_free(block))
+            {
+                Block* prev = block->prev_physical;
+                remove_free(prev);
+                set_size(prev, block_size(prev) + HEADER + block_size(block));
+                next_physical(prev)->prev_physical = prev;
+                block = prev;
+            }
+
+            Block* next = next_physical(block);
+            if(is_free(next))
+            {
+                remove_free(next);
+                set_size(block, block_size(block) + HEADER + block_size(next));
+                next_physical(block)->prev_physical = block;
+            }
+
+            insert_free(block);
+
+            deallocation_count ++;
+            bytes_alloced -= old_size;
+            assert(bytes_alloced >= 0);
+            return true;
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info) noexcept override
+        {
+            assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
+            (void) align;
+            resize_count ++;
+
+            Block* block = block_of(allocated);
+            isize needed = payload_size(new_size);
+            if(needed > block_size(block))
+            {
+                Block* next = next_physical(block);
+                if(is_free(next) == false || block_size(block) + HEADER + block_size(next) < needed)
+                    return false;
+
+                remove_free(next);
+                set_size(block, block_size(block) + HEADER + block_size(next));
+                next_physical(block)->prev_physical = block;
+            }
+
+            trim_used(block, needed);
+
+            bytes_alloced += new_size - old_size;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            return true;
+        }
+
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Tlsf_Allocator";
+            stats.supports_resize = true;
+            stats.parent = parent;
+
+            stats.bytes_allocated = bytes_alloced;
+            stats.max_bytes_allocated = max_bytes_alloced;
+            stats.bytes_used = bytes_used;
+            stats.max_bytes_used = max_bytes_used;
+
+            stats.allocation_count = allocation_count;
+            stats.deallocation_count = deallocation_count;
+            stats.resize_count = resize_count;
+            return stats;
+        }
+
+        virtual
+        ~Tlsf_Allocator() noexcept override
+        {
+            for(Pool* pool = parent_pools; pool != nullptr; )
+            {
+                Pool* next = pool->next;
+                parent->deallocate(pool, pool->size, ALIGN, GET_LINE_INFO());
+                pool = next;
+            }
+        }
+    };
+}
@@ -0,0 +1,526 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string.h>
+#include "memory.h"
+#include "array.h"
+#include "hash_table.h"
+#include "string_hash.h"
+#include "format.h"
+#include "time.h"
+#include "virtual_memory.h"
+
+namespace jot
+{
+    enum class Trace_Event_Kind : uint8_t
+    {
+        ALLOCATE,
+        DEALLOCATE,
+        RESIZE, //only successful resizes are recorded. Failed ones are followed by allocate and deallocate
+    };
+
+    ///Single recorded allocator call. Allocations are identified by dense ids (in order of allocation)
+    /// instead of addresses so that the trace can be replayed on any allocator
+    struct Trace_Event
+    {
+        Trace_Event_Kind kind;
+        uint8_t align_log2;
+        uint16_t thread;
+        uint32_t site; //index into Allocation_Trace::sites
+        uint64_t id;
+        int64_t time_ns; //since the start of recording
+        int64_t size; //new size for ALLOCATE and RESIZE
+        int64_t old_size; //for DEALLOCATE and RESIZE
+    };
+
+    struct Allocation_Trace
+    {
+        Array<Trace_Event> events;
+        Array<Line_Info> sites;
+        isize allocation_count = 0; //the number of distinct ids in events
+
+        //Storage for file and function names of sites of deserialized traces
+        Array<char> strings;
+    };
+
+    namespace tracing_internal
+    {
+        inline uint16_t thread_index() noexcept
+        {
+            static std::atomic<uint16_t> next_index = 0;
+            thread_local static uint16_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+            return index;
+        }
+
+        inline uint64_t site_hash(Line_Info const& info) noexcept
+        {
+            return hash64((uint64_t) info.file ^ hash64((uint64_t) info.func ^ hash64((uint64_t) info.line)));
+        }
+
+        inline uint8_t log2_of(isize align) noexcept
+        {
+            uint8_t log2 = 0;
+            while(((isize) 1 << log2) < align)
+                log2 ++;
+
+            return log2;
+        }
+    }
+
+    ///Wraps parent allocator and records every allocate, deallocate and successful resize into trace.
+    /// Can be used from multiple threads provided the parent can. The recorded trace can be
+    /// serialized with serialize_trace_into and replayed on any allocator with replay_trace.
+    struct Tracing_Allocator : Allocator
+    {
+        //Events are appended under a single lock. This makes the recording order a valid order to replay in:
+        // deallocations are recorded before they reach parent and allocations after they return from it so
+        // an address is never seen allocated twice without a deallocation between.
+        //Live addresses are mapped to their ids by a hash table. Deallocations and resizes of addresses
+        // that were not allocated while tracing are passed through and not recorded.
+        //
+        //The trace storage uses the allocator given at construction. It must not be this allocator.
+
+        using Id_Table = Hash_Table<uint64_t, uint64_t, int_hash<uint64_t>>;
+        using Site_Table = Hash_Table<uint64_t, uint32_t, int_hash<uint64_t>>;
+
+        Allocator* parent = nullptr;
+        Allocation_Trace trace;
+
+        std::mutex mutex;
+        Id_Table live_ids;
+        Site_Table site_indices;
+        int64_t start_ns = 0;
+        bool is_recording = true;
+
+        isize bytes_alloced = 0;
+        isize max_bytes_alloced = 0;
+
+        explicit Tracing_Allocator(
+            Allocator* parent = memory_globals::default_allocator(),
+            Allocator* trace_storage = memory_globals::default_allocator()) noexcept
+            : parent(parent), live_ids(trace_storage), site_indices(trace_storage)
+        {
+            trace.events = Array<Trace_Event>(trace_storage);
+            trace.sites = Array<Line_Info>(trace_storage);
+            trace.strings = Array<char>(trace_storage);
+            start_ns = clock_ns();
+        }
+
+        Tracing_Allocator(Tracing_Allocator const&) = delete;
+        Tracing_Allocator& operator=(Tracing_Allocator const&) = delete;
+
+        uint32_t find_or_add_site(Line_Info const& info) noexcept
+        {
+            uint64_t hash = tracing_internal::site_hash(info);
+            uint32_t index = get(site_indices, hash, UINT32_MAX);
+            if(index != UINT32_MAX)
+            {
+                Line_Info const& found = trace.sites[index];
+                if(found.line == info.line && found.file == info.file && found.func == info.func)
+                    return index;
+            }
+
+            //on the (practically impossible) hash collision the site simply gets duplicated
+            index = (uint32_t) size(trace.sites);
+            push(&trace.sites, info);
+            set(&site_indices, hash, index);
+            return index;
+        }
+
+        void record(Trace_Event_Kind kind, uint64_t id, isize size, isize old_size, isize align, Line_Info const& callee) noexcept
+        {
+            Trace_Event event = {};
+            event.kind = kind;
+            event.align_log2 = tracing_internal::log2_of(align);
+            event.thread = tracing_internal::thread_index();
+            event.site = find_or_add_site(callee);
+            event.id = id;
+            event.time_ns = clock_ns() - start_ns;
+            event.size = size;
+            event.old_size = old_size;
+            push(&trace.events, event);
+
+            bytes_alloced += size - old_size;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+        }
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info callee) noexcept override
+        {
+            void* allocated = parent->allocate(size, align, callee);
+            if(allocated == nullptr || is_recording == false)
+                return allocated;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            uint64_t id = (uint64_t) trace.allocation_count ++;
+            set(&live_ids, (uint64_t) allocated, id);
+            record(Trace_Event_Kind::ALLOCATE, id, size, 0, align, callee);
+            return allocated;
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override
+        {
+            if(allocated != nullptr)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                Hash_Found found = find(live_ids, (uint64_t) allocated);
+                if(found.entry_index != -1)
+                {
+                    uint64_t id = values(live_ids)[found.entry_index];
+                    remove(&live_ids, found);
+                    record(Trace_Event_Kind::DEALLOCATE, id, 0, old_size, align, callee);
+                }
+            }
+
+            return parent->deallocate(allocated, old_size, align, callee);
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            if(parent->resize(allocated, old_size, new_size, align, callee) == false)
+                return false;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            Hash_Found found = find(live_ids, (uint64_t) allocated);
+            if(found.entry_index != -1)
+                record(Trace_Event_Kind::RESIZE, values(live_ids)[found.entry_index], new_size, old_size, align, callee);
+
+            return true;
+        }
+
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = parent->get_stats();
+            stats.name = "Tracing_Allocator";
+            stats.parent = parent;
+            stats.bytes_allocated = bytes_alloced;
+            stats.max_bytes_allocated = max_bytes_alloced;
+            return stats;
+        }
+
+        virtual
+        ~Tracing_Allocator() noexcept override {}
+    };
+
+    ///Results of replaying a trace on an allocator
+    struct Replay_Result
+    {
+        isize event_count;
+        isize failed_count; //allocations that returned nullptr (and their deallocations that were skipped)
+        isize relocated_count; //resizes that could not be done in place and were emulated by allocate + copy + deallocate
+
+        double seconds;
+        double events_per_second;
+
+        //peak of the requested bytes and of the memory the allocator used to satisfy them
+        isize max_bytes_allocated;
+        isize max_bytes_used;
+        double fragmentation; //1 - max_bytes_allocated / max_bytes_used or 0 if the allocator does not report bytes_used
+
+        //Highest increase of the resident size of the process during the replay over the resident size before it.
+        // Sampled every 1024 events (not timed) so short peaks might be missed
+        isize peak_resident_growth;
+    };
+
+    ///Replays the trace on alloc single threaded in the recorded order. When touch is set each allocation
+    /// is written to which makes the timing closer to real usage (and the resident size meaningful).
+    /// All allocations still live at the end of the trace are deallocated afterwards (not timed).
+    /// Traces can be replayed on several allocators in one process and the results compared.
+    inline Replay_Result replay_trace(Allocation_Trace const& trace, Allocator* alloc, bool touch = true)
+    {
+        Replay_Result result = {};
+        Array<void*> live;
+        resize(&live, trace.allocation_count);
+
+        Array<isize> live_sizes;
+        resize(&live_sizes, trace.allocation_count);
+
+        Array<uint8_t> live_align_log2s;
+        resize(&live_align_log2s, trace.allocation_count);
+
+        isize bytes_allocated = 0;
+        Allocator_Stats before = alloc->get_stats();
+
+        //The peak resident size of the process never goes down so it would carry over from the previous replays.
+        // We instead sample the current resident size.
+        const isize RESIDENT_SAMPLE_EVERY = 1024;
+        isize resident_before = process_resident_size();
+        isize resident_peak = resident_before;
+        int64_t sampling_ns = 0;
+
+        int64_t start = clock_ns();
+        for(isize i = 0; i < size(trace.events); i++)
+        {
+            if(i % RESIDENT_SAMPLE_EVERY == RESIDENT_SAMPLE_EVERY - 1)
+            {
+                int64_t sample_start = clock_ns();
+                resident_peak = max(resident_peak, process_resident_size());
+                sampling_ns += clock_ns() - sample_start;
+            }
+
+            Trace_Event const& event = trace.events[i];
+            isize align = (isize) 1 << event.align_log2;
+            isize id = (isize) event.id;
+            assert(0 <= id && id < trace.allocation_count && "corrupted trace");
+
+            switch(event.kind)
+            {
+                case Trace_Event_Kind::ALLOCATE: {
+                    void* allocated = alloc->allocate(event.size, align, GET_LINE_INFO());
+                    if(allocated == nullptr)
+                    {
+                        result.failed_count ++;
+                        break;
+                    }
+
+                    if(touch)
+                        memset(allocated, 0x55, (size_t) event.size);
+
+                    live[id] = allocated;
+                    live_sizes[id] = event.size;
+                    live_align_log2s[id] = event.align_log2;
+                    bytes_allocated += event.size;
+                    break;
+                }
+
+                case Trace_Event_Kind::DEALLOCATE: {
+                    if(live[id] == nullptr)
+                        break;
+
+                    alloc->deallocate(live[id], live_sizes[id], align, GET_LINE_INFO());
+                    bytes_allocated -= live_sizes[id];
+                    live[id] = nullptr;
+                    break;
+                }
+
+                case Trace_Event_Kind::RESIZE: {
+                    if(live[id] == nullptr)
+                        break;
+
+                    isize old_size = live_sizes[id];
+                    if(alloc->resize(live[id], old_size, event.size, align, GET_LINE_INFO()) == false)
+                    {
+                        void* relocated = alloc->allocate(event.size, align, GET_LINE_INFO());
+                        if(relocated == nullptr)
+                        {
+                            result.failed_count ++;
+                            break;
+                        }
+
+                        memcpy(relocated, live[id], (size_t) min(old_size, (isize) event.size));
+                        alloc->deallocate(live[id], old_size, align, GET_LINE_INFO());
+                        live[id] = relocated;
+                        result.relocated_count ++;
+                    }
+
+                    if(touch && event.size > old_size)
+                        memset((uint8_t*) live[id] + old_size, 0x55, (size_t) (event.size - old_size));
+
+                    live_sizes[id] = event.size;
+                    bytes_allocated += event.size - old_size;
+                    break;
+                }
+            }
+
+            result.max_bytes_allocated = max(result.max_bytes_allocated, bytes_allocated);
+        }
+        int64_t end = clock_ns();
+        resident_peak = max(resident_peak, process_resident_size());
+
+        Allocator_Stats after = alloc->get_stats();
+        result.event_count = size(trace.events);
+        result.seconds = (double) (end - start - sampling_ns) / 1.0e9;
+        result.events_per_second = result.seconds > 0 ? (double) result.event_count / result.seconds : 0;
+        result.max_bytes_used = after.max_bytes_used - before.bytes_used;
+        if(result.max_bytes_used > 0 && result.max_bytes_used >= result.max_bytes_allocated)
+            result.fragmentation = 1.0 - (double) result.max_bytes_allocated / (double) result.max_bytes_used;
+        else
+            result.max_bytes_used = 0;
+
+        result.peak_resident_growth = resident_peak - resident_before;
+
+        for(isize id = 0; id < size(live); id++)
+            if(live[id] != nullptr)
+                alloc->deallocate(live[id], live_sizes[id], (isize) 1 << live_align_log2s[id], GET_LINE_INFO());
+
+        return result;
+    }
+
+    ///Formats a single line summary of replay result
+    inline void format_replay_result_into(String_Builder* into, const char* allocator_name, Replay_Result const& result)
+    {
+        format_into(into, allocator_name, ": ", result.event_count, " events in ", result.seconds, "s (",
+            result.events_per_second / 1.0e6, " M/s)");
+        format_into(into, " peak: ", result.max_bytes_allocated, "B used: ", result.max_bytes_used, "B");
+        format_into(into, " fragmentation: ", result.fragmentation * 100, "% failed: ", result.failed_count,
+            " relocated: ", result.relocated_count, " peak rss growth: ", result.peak_resident_growth, "B\n");
+    }
+
+    namespace tracing_internal
+    {
+        static constexpr uint64_t TRACE_MAGIC = 0x4543415254544f4a; //"JOTTRACE" in little endian
+        static constexpr uint32_t TRACE_VERSION = 1;
+
+        struct Trace_Header
+        {
+            uint64_t magic;
+            uint32_t version;
+            uint32_t event_size;
+            int64_t event_count;
+            int64_t site_count;
+            int64_t string_bytes;
+            int64_t allocation_count;
+        };
+
+        struct Serialized_Site
+        {
+            int64_t line;
+            int32_t file_size;
+            int32_t func_size;
+        };
+
+        inline void push_bytes(Array<char>* into, const void* data, isize size)
+        {
+            push_multiple(into, Slice<const char>{(const char*) data, size});
+        }
+
+        inline bool pop_bytes(Slice<const char>* from, void* data, isize size) noexcept
+        {
+            if(from->size < size)
+                return false;
+
+            memcpy(data, from->data, (size_t) size);
+            from->data += size;
+            from->size -= size;
+            return true;
+        }
+
+        inline isize cstring_size(const char* str) noexcept
+        {
+            return str != nullptr ? (isize) strlen(str) : 0;
+        }
+    }
+
+    ///Appends binary representation of the trace to into. The format is: header, sites, site strings, events.
+    /// The sites are stored by value so the trace can be loaded by a different process.
+    inline void serialize_trace_into(Array<char>* into, Allocation_Trace const& trace)
+    {
+        using namespace tracing_internal;
+        isize string_bytes = 0;
+        for(isize i = 0; i < size(trace.sites); i++)
+            string_bytes += cstring_size(trace.sites[i].file) + cstring_size(trace.sites[i].func) + 2;
+
+        Trace_Header header = {};
+        header.magic = TRACE_MAGIC;
+        header.version = TRACE_VERSION;
+        header.event_size = sizeof(Trace_Event);
+        header.event_count = size(trace.events);
+        header.site_count = size(trace.sites);
+        header.string_bytes = string_bytes;
+        header.allocation_count = trace.allocation_count;
+
+        reserve(into, size(*into) + (isize) sizeof(header) + string_bytes
+            + size(trace.sites) * (isize) sizeof(Serialized_Site) + size(trace.events) * (isize) sizeof(Trace_Event));
+        push_bytes(into, &header, sizeof(header));
+
+        for(isize i = 0; i < size(trace.sites); i++)
+        {
+            Line_Info const& info = trace.sites[i];
+            Serialized_Site site = {info.line, (int32_t) cstring_size(info.file), (int32_t) cstring_size(info.func)};
+            push_bytes(into, &site, sizeof(site));
+        }
+
+        for(isize i = 0; i < size(trace.sites); i++)
+        {
+            Line_Info const& info = trace.sites[i];
+            push_bytes(into, info.file, cstring_size(info.file));
+            push(into, '\0');
+            push_bytes(into, info.func, cstring_size(info.func));
+            push(into, '\0');
+        }
+
+        push_bytes(into, data(trace.events), size(trace.events) * (isize) sizeof(Trace_Event));
+    }
+
+    ///Records the current trace of the allocator. Can be called while it is in use
+    inline void serialize_trace_into(Array<char>* into, Tracing_Allocator* tracing)
+    {
+        std::lock_guard<std::mutex> lock(tracing->mutex);
+        serialize_trace_into(into, tracing->trace);
+    }
+
+    ///Parses trace serialized by serialize_trace_into. Returns false if the data is not a valid trace in which case
+    /// trace is left unchanged
+    inline bool deserialize_trace(Allocation_Trace* trace, Slice<const char> from)
+    {
+        using namespace tracing_internal;
+        Trace_Header header = {};
+        if(pop_bytes(&from, &header, sizeof(header)) == false)
+            return false;
+
+        if(header.magic != TRACE_MAGIC || header.version != TRACE_VERSION || header.event_size != sizeof(Trace_Event))
+            return false;
+
+        //The counts are checked against the data size before multiplying so that they cannot overflow
+        if(header.site_count < 0 || header.string_bytes < 0 || header.event_count < 0 || header.allocation_count < 0)
+            return false;
+
+        if(header.site_count > from.size / (isize) sizeof(Serialized_Site) 
+            || header.event_count > from.size / (isize) sizeof(Trace_Event) 
+            || header.string_bytes > from.size)
+            return false;
+
+        isize expected_size = header.site_count * (isize) sizeof(Serialized_Site) + header.string_bytes + header.event_count * (isize) sizeof(Trace_Event);
+        if(from.size != expected_size)
+            return false;
+
+        Allocation_Trace parsed;
+        Slice<const char> strings = {from.data + header.site_count * (isize) sizeof(Serialized_Site), header.string_bytes};
+        resize(&parsed.strings, header.string_bytes);
+        memcpy(data(&parsed.strings), strings.data, (size_t) strings.size);
+
+        resize(&parsed.sites, header.site_count);
+        isize string_offset = 0;
+        for(isize i = 0; i < header.site_count; i++)
+        {
+            Serialized_Site site = {};
+            pop_bytes(&from, &site, sizeof(site));
+            if(site.file_size < 0 || site.func_size < 0 || string_offset + site.file_size + site.func_size + 2 > header.string_bytes)
+                return false;
+
+            //the strings are used as c strings so they must be terminated where the site says they end
+            const char* file = data(&parsed.strings) + string_offset;
+            const char* func = file + site.file_size + 1;
+            if(file[site.file_size] != '\0' || func[site.func_size] != '\0')
+                return false;
+
+            parsed.sites[i] = Line_Info{file, func, (isize) site.line};
+            string_offset += site.file_size + site.func_size + 2;
+        }
+
+        from.data += header.string_bytes;
+        from.size -= header.string_bytes;
+
+        resize(&parsed.events, header.event_count);
+        pop_bytes(&from, data(&parsed.events), header.event_count * (isize) sizeof(Trace_Event));
+        parsed.allocation_count = header.allocation_count;
+
+        for(isize i = 0; i < header.event_count; i++)
+        {
+            Trace_Event const& event = parsed.events[i];
+            if(event.id >= (uint64_t) parsed.allocation_count || event.site >= (uint64_t) header.site_count || event.align_log2 >= 63)
+                return false;
+
+            if(event.kind > Trace_Event_Kind::RESIZE || event.size < 0 || event.old_size < 0)
+                return false;
+        }
+
+        //The sites point into the heap storage of strings which stays the same when moved
+        *trace = (Allocation_Trace&&) parsed;
+        return true;
+    }
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "memory.h"
+#include "virtual_memory.h"
+
+namespace jot
+{
+    ///Allocates lineary from a single large reserved range of address space committing pages as needed.
+    /// Because the range never moves the last allocation can always be resized in place (up to the reserved size).
+    struct Virtual_Arena : Allocator
+    {
+        //The reserved range is split into:
+        // [reserved_from, available_from) - allocated
+        // [available_from, committed_to)  - committed but not yet allocated
+        // [committed_to, reserved_to)     - reserved only (any access faults)
+        //
+        //Committing is done in multiples of commit_granularity so that we dont call into the os on every
+        // allocation. reset() decommits everything past retain_committed bytes so that a single peak doesnt
+        // hold on to its physical memory forever.
+
+        uint8_t* reserved_from = nullptr;
+        uint8_t* reserved_to = nullptr;
+        uint8_t* committed_to = nullptr;
+        uint8_t* available_from = nullptr;
+        uint8_t* last_allocation = nullptr;
+
+        isize commit_granularity = 0;
+        isize retain_committed = 0;
+
+        isize bytes_alloced = 0;
+        isize max_bytes_alloced = 0;
+        isize max_bytes_committed = 0;
+        isize allocation_count = 0;
+        isize deallocation_count = 0;
+        isize resize_count = 0;
+
+        static constexpr isize DEFAULT_RESERVE_SIZE = sizeof(void*) == 8
+            ? 64 * memory_constants::GIBI_BYTE
+            : 256 * memory_constants::MEBI_BYTE;
+
+        explicit Virtual_Arena(
+            isize reserve_size = DEFAULT_RESERVE_SIZE,
+            isize retain_committed = memory_constants::MEBI_BYTE,
+            isize commit_granularity = 64 * memory_constants::KIBI_BYTE) noexcept
+            : commit_granularity(commit_granularity), retain_committed(retain_committed)
+        {
+            isize page = virtual_page_size();
+            assert(commit_granularity > 0 && retain_committed >= 0);
+            reserve_size = div_round_up(reserve_size, page) * page;
+            this->commit_granularity = div_round_up(commit_granularity, page) * page;
+
+            reserved_from = (uint8_t*) virtual_reserve(reserve_size);
+            if(reserved_from != nullptr)
+                reserved_to = reserved_from + reserve_size;
+
+            committed_to = reserved_from;
+            available_from = reserved_from;
+            assert(is_invariant());
+        }
+
+        Virtual_Arena(Virtual_Arena const&) = delete;
+        Virtual_Arena& operator=(Virtual_Arena const&) = delete;
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info) noexcept override
+        {
+            assert(size >= 0 && is_power_of_two(align));
+            uint8_t* aligned = (uint8_t*) align_forward(available_from, align);
+            if(size > reserved_to - aligned || commit_to(aligned + size) == false)
+                return nullptr;
+
+            available_from = aligned + size;
+            last_allocation = aligned;
+
+            allocation_count ++;
+            bytes_alloced += size;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            return aligned;
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info) noexcept override
+        {
+            (void) align;
+            assert(old_size >= 0 && is_power_of_two(align));
+            deallocation_count ++;
+            bytes_alloced -= old_size;
+            assert(bytes_alloced >= 0);
+
+            uint8_t* ptr = (uint8_t*) allocated;
+            if(ptr == last_allocation && ptr + old_size == available_from)
+                available_from = ptr;
+
+            return true;
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info) noexcept override
+        {
+            (void) align;
+            assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
+            resize_count ++;
+
+            uint8_t* ptr = (uint8_t*) allocated;
+            if(ptr != last_allocation || ptr + old_size != available_from)
+                return false;
+
+            if(new_size > reserved_to - ptr || commit_to(ptr + new_size) == false)
+                return false;
+
+            available_from = ptr + new_size;
+            bytes_alloced += new_size - old_size;
+            max_bytes_alloced = max(max_bytes_alloced, bytes_alloced);
+            assert(bytes_alloced >= 0);
+            return true;
+        }
+
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Virtual_Arena";
+            stats.supports_resize = true;
+
+            stats.bytes_allocated = bytes_alloced;
+            stats.max_bytes_allocated = max_bytes_alloced;
+            stats.bytes_used = committed_to - reserved_from;
+            stats.max_bytes_used = max_bytes_committed;
+
+            stats.allocation_count = allocation_count;
+            stats.deallocation_count = deallocation_count;
+            stats.resize_count = resize_count;
+            return stats;
+        }
+
+        ///Frees all allocations at once and decommits everything past retain_committed
+        void reset() noexcept
+        {
+            available_from = reserved_from;
+            last_allocation = nullptr;
+            bytes_alloced = 0;
+
+            isize page = virtual_page_size();
+            isize retained = div_round_up(retain_committed, page) * page;
+            if(committed_to - reserved_from > retained)
+            {
+                uint8_t* decommit_from = reserved_from + retained;
+                if(virtual_decommit(decommit_from, committed_to - decommit_from))
+                    committed_to = decommit_from;
+            }
+
+            assert(is_invariant());
+        }
+
+        ///Decommits all committed pages past the last allocation
+        virtual
+        isize release_extra_memory() noexcept override
+        {
+            isize page = virtual_page_size();
+            uint8_t* decommit_from = reserved_from + div_round_up(available_from - reserved_from, page) * page;
+            if(decommit_from >= committed_to || virtual_decommit(decommit_from, committed_to - decommit_from) == false)
+                return 0;
+
+            isize released = committed_to - decommit_from;
+            committed_to = decommit_from;
+            assert(is_invariant());
+            return released;
+        }
+
+        ///Returns true if the address range was succesfully reserved
+        bool is_reserved() const noexcept
+        {
+            return reserved_from != nullptr;
+        }
+
+        bool commit_to(uint8_t* to) noexcept
+        {
+            if(to <= committed_to)
+                return true;
+
+            isize needed = to - committed_to;
+            isize commit_size = div_round_up(needed, commit_granularity) * commit_granularity;
+            if(commit_size > reserved_to - committed_to)
+                commit_size = reserved_to - committed_to;
+
+            if(virtual_commit(committed_to, commit_size) == false)
+                return false;
+
+            committed_to += commit_size;
+            max_bytes_committed = max(max_bytes_committed, committed_to - reserved_from);
+            return true;
+        }
+
+        bool is_invariant() const noexcept
+        {
+            bool range_inv = reserved_from <= available_from && available_from <= committed_to && committed_to <= reserved_to;
+            bool null_inv = (reserved_from == nullptr) == (reserved_to == nullptr);
+            bool stat_inv = bytes_alloced >= 0 && max_bytes_alloced >= bytes_alloced;
+            return range_inv && null_inv && stat_inv;
+        }
+
+        virtual
+        ~Virtual_Arena() noexcept override
+        {
+            assert(is_invariant());
+            if(reserved_from != nullptr)
+                virtual_release(reserved_from, reserved_to - reserved_from);
+        }
+    };
+}
@@ -4,18 +4,22 @@
 
 namespace jot
 {
-    ///Resizable dynamic array also used to represent dynamic strings
-    template <typename T_>
+    ///Resizable dynamic array also used to represent dynamic strings. 
+    ///By default the allocator is called through the virtual Allocator interface. A concrete allocator type can be 
+    /// given as A_ (ie. Array<int, Arena_Allocator>) in which case the calls are dispatched statically and can be inlined.
+    /// Such arrays have no default allocator and copies use the allocator of the array they were copied from.
+    template <typename T_, typename A_ = Allocator>
     struct Array
     {   
         using T = T_;
+        using A = A_;
 
         T* _data = nullptr;
-        Allocator* _allocator = default_allocator();
+        A* _allocator = nullptr;
         isize _size = 0;
         isize _capacity = 0;
         
-        explicit Array(Allocator* allocator = default_allocator()) noexcept;
+        explicit Array(A* allocator = default_allocator()) noexcept;
         Array(Array && other) noexcept;
         Array(Array const& other);
         ~Array() noexcept;
@@ -35,41 +39,41 @@ namespace jot
     };
 
     ///Getters 
-    template<class T> const T*   data(Array<T> const& array) noexcept       { return array._data; }
-    template<class T> T*         data(Array<T>* array) noexcept             { return array->_data; }
-    template<class T> isize      size(Array<T> const& array) noexcept       { return array._size; }
-    template<class T> isize      size(Array<T>* array) noexcept             { return array->_size; }
-    template<class T> isize      capacity(Array<T> const& array) noexcept   { return array._capacity; }
-    template<class T> isize      capacity(Array<T>* array) noexcept         { return array->_capacity; }
-    template<class T> Allocator* allocator(Array<T> const& array) noexcept  { return array._allocator; }
-    template<class T> Allocator* allocator(Array<T>* array) noexcept        { return array->_allocator; }
+    template<class T, class A> const T*   data(Array<T, A> const& array) noexcept       { return array._data; }
+    template<class T, class A> T*         data(Array<T, A>* array) noexcept             { return array->_data; }
+    template<class T, class A> isize      size(Array<T, A> const& array) noexcept       { return array._size; }
+    template<class T, class A> isize      size(Array<T, A>* array) noexcept             { return array->_size; }
+    template<class T, class A> isize      capacity(Array<T, A> const& array) noexcept   { return array._capacity; }
+    template<class T, class A> isize      capacity(Array<T, A>* array) noexcept         { return array->_capacity; }
+    template<class T, class A> A*         allocator(Array<T, A> const& array) noexcept  { return array._allocator; }
+    template<class T, class A> A*         allocator(Array<T, A>* array) noexcept        { return array->_allocator; }
 
     ///iterators
-    template<typename T> T*       begin(Array<T>& array) noexcept           { return array._data; }
-    template<typename T> const T* begin(Array<T> const& array) noexcept     { return array._data; }
-    template<typename T> T*       end(Array<T>& array) noexcept             { return array._data + array._size; }
-    template<typename T> const T* end(Array<T> const& array) noexcept       { return array._data + array._size; }
+    template<typename T, typename A> T*       begin(Array<T, A>& array) noexcept           { return array._data; }
+    template<typename T, typename A> const T* begin(Array<T, A> const& array) noexcept     { return array._data; }
+    template<typename T, typename A> T*       end(Array<T, A>& array) noexcept             { return array._data + array._size; }
+    template<typename T, typename A> const T* end(Array<T, A> const& array) noexcept       { return array._data + array._size; }
 
     ///Returns a slice containing all items of the array
-    template<class T> Slice<const T> slice(Array<T> const& array) noexcept  { return {array._data, array._size}; }
-    template<class T> Slice<T>       slice(Array<T>* array) noexcept        { return {array->_data, array->_size}; }
+    template<class T, class A> Slice<const T> slice(Array<T, A> const& array) noexcept  { return {array._data, array._size}; }
+    template<class T, class A> Slice<T>       slice(Array<T, A>* array) noexcept        { return {array->_data, array->_size}; }
 
     ///Get first and last items of a array. Cannot be used on empty array!
-    template<class T> T*       last(Array<T>* array) noexcept        { return &(*array)[array->_size - 1]; }
-    template<class T> T const& last(Array<T> const& array) noexcept  { return (array)[array._size - 1]; }
-    template<class T> T*       first(Array<T>* array) noexcept       { return &(*array)[0]; }
-    template<class T> T const& first(Array<T> const& array) noexcept { return (array)[0]; }
+    template<class T, class A> T*       last(Array<T, A>* array) noexcept        { return &(*array)[array->_size - 1]; }
+    template<class T, class A> T const& last(Array<T, A> const& array) noexcept  { return (array)[array._size - 1]; }
+    template<class T, class A> T*       first(Array<T, A>* array) noexcept       { return &(*array)[0]; }
+    template<class T, class A> T const& first(Array<T, A> const& array) noexcept { return (array)[0]; }
     
     ///Returns true if the structure state is correct which should be always
-    template<class T> bool is_invariant(Array<T> const& array) noexcept;
-    template<class T> bool is_empty(Array<T> const& array) noexcept;
+    template<class T, class A> bool is_invariant(Array<T, A> const& array) noexcept;
+    template<class T, class A> bool is_empty(Array<T, A> const& array) noexcept;
 
     ///swaps contents of left and right arrays
-    template<class T> void swap(Array<T>* left, Array<T>* right) noexcept;
+    template<class T, class A> void swap(Array<T, A>* left, Array<T, A>* right) noexcept;
     ///Copies items to array. Items within the array before this opperations are discarded
-    template<class T> void copy(Array<T>* array, Slice<const T> items);
+    template<class T, class A> void copy(Array<T, A>* array, Slice<const T> items);
     ///Removes all items from array
-    template<class T> void clear(Array<T>* array) noexcept;
+    template<class T, class A> void clear(Array<T, A>* array) noexcept;
 
     ///Makes a new array with copied items using the probided allocator
     template<class T> Array<T> own(Slice<const T> from, Allocator* alloc = default_allocator());
@@ -79,48 +83,57 @@ namespace jot
 
     ///Reallocates array to the specified capacity. If the capacity is smaller then its size, shrinks it destroying items
     ///in process
-    template<class T> bool set_capacity_failing(Array<T>* array, isize new_capacity) noexcept;
-    template<class T> void set_capacity(Array<T>* array, isize new_capacity);
+    template<class T, class A> bool set_capacity_failing(Array<T, A>* array, isize new_capacity) noexcept;
+    template<class T, class A> void set_capacity(Array<T, A>* array, isize new_capacity);
 
     ///Potentially reallocates array so that capacity is at least to_size. If capacity is already greater than to_size
     ///does nothing.
-    template<class T> bool reserve_failing(Array<T>* array, isize to_size) noexcept;
-    template<class T> void reserve(Array<T>* array, isize to_size);
+    template<class T, class A> bool reserve_failing(Array<T, A>* array, isize to_size) noexcept;
+    template<class T, class A> void reserve(Array<T, A>* array, isize to_size);
+
+    ///Reallocates array so that its capacity equals its size returning the unused memory to the allocator
+    template<class T, class A> void shrink_to_fit(Array<T, A>* array);
 
     ///Same as reserve expect when reallocation happens grows 3/2*size + 8
-    template<class T> void grow(Array<T>* array, isize to_fit);
+    template<class T, class A> void grow(Array<T, A>* array, isize to_fit);
 
     ///Sets size of array. If to_size is smaller then array size trims the array. If is greater fills the added space with fill_with
-    template<class T> void resize(Array<T>* array, isize to_size, typename Array<T>::T const& fill_with = {}) noexcept;
+    template<class T, class A> void resize(Array<T, A>* array, isize to_size, typename Array<T, A>::T const& fill_with = {}) noexcept;
     ///Sets size of array. If to_size is smaller then array size trims the array. 
     ///If is greater and the T type allows it leaves the space uninitialized
-    template<class T> void resize_for_overwrite(Array<T>* array, isize to);
+    template<class T, class A> void resize_for_overwrite(Array<T, A>* array, isize to);
 
     ///Adds an item to the end of the array
-    template<class T> void push(Array<T>* array, typename Array<T>::T what);
+    template<class T, class A> void push(Array<T, A>* array, typename Array<T, A>::T what);
     ///Removes an item at the end array. The array must not be empty!
-    template<class T>    T pop(Array<T>* array) noexcept;
+    template<class T, class A>    T pop(Array<T, A>* array) noexcept;
 
     ///Pushes all items from inserted slice into the array
-    template<class T> void push_multiple(Array<T>* array, Slice<const typename Array<T>::T> inserted);
+    template<class T, class A> void push_multiple(Array<T, A>* array, Slice<const typename Array<T, A>::T> inserted);
     ///Pushes all items from inserted slice into the array moving them out of inserted slice
-    template<class T> void push_multiple_move(Array<T>* array, Slice<typename Array<T>::T> inserted);
+    template<class T, class A> void push_multiple_move(Array<T, A>* array, Slice<typename Array<T, A>::T> inserted);
     ///Pops multiple items from array. The array must contain at least count elements!
-    template<class T> void pop_multiple(Array<T>* array, isize count) noexcept;
+    template<class T, class A> void pop_multiple(Array<T, A>* array, isize count) noexcept;
 
     ///Inserts an item into the array so that its index is at. Moves all later elemnts forward one index
-    template<class T> void insert(Array<T>* array, isize at, typename Array<T>::T what);
+    template<class T, class A> void insert(Array<T, A>* array, isize at, typename Array<T, A>::T what);
     ///Removes an item from the array at specified index. Moves all later elemnts backwards one index. The array most not be empty!
-    template<class T>    T remove(Array<T>* array, isize at) noexcept;
+    template<class T, class A>    T remove(Array<T, A>* array, isize at) noexcept;
 
     ///Inserts an item into the array so that its index is at. The item that was originally at this index becomes last
-    template<class T> void unordered_insert(Array<T>* array, isize at, typename Array<T>::T what);
+    template<class T, class A> void unordered_insert(Array<T, A>* array, isize at, typename Array<T, A>::T what);
     ///Removes an item from the array at specified index. Moves the last item into freed up spot. The array most not be empty!
-    template<class T>    T unordered_remove(Array<T>* array, isize at) noexcept;
+    template<class T, class A>    T unordered_remove(Array<T, A>* array, isize at) noexcept;
     
     ///Tells array if this type should be null terminated. Provide specialization for your desired type if you
     /// want it to be considered a string (see string.h)
     template<class T> static constexpr bool is_string_char = false;
+
+    ///Tells array if moving an item to a new address and destroying the original can be done by memcpy alone.
+    /// True for trivially copyable types and for arrays themselves. Provide specialization for your type if it 
+    /// has a destructor but does not point into itself (holds owning pointers, handles, etc.)
+    template<class T> static constexpr bool is_trivially_relocatable = __is_trivially_copyable(T);
+    template<class T, class A> static constexpr bool is_trivially_relocatable<Array<T, A>> = true;
 }
 
 namespace jot
@@ -133,15 +146,15 @@ namespace jot
             return NULL_TERMINATION_ARRAY;
         }
 
-        template<class T> 
-        static void null_terminate(Array<T>* array) noexcept 
+        template<class T, class A> 
+        static void null_terminate(Array<T, A>* array) noexcept 
         {
             if (is_string_char<T>)
                 memset(array->_data + array->_size, 0, sizeof(T));
         }
 
-        template<class T> 
-        void set_data_to_termination(Array<T>* array)
+        template<class T, class A> 
+        void set_data_to_termination(Array<T, A>* array)
         {
             if (is_string_char<T>)
                 array->_data = (T*) null_termination();
@@ -149,6 +162,11 @@ namespace jot
                 array->_data = nullptr;
         }   
         
+        //Allocator of arrays constructed from other arrays. The runtime dispatched arrays use the default allocator
+        // while the statically dispatched ones have none so they use the one of the other array
+        inline Allocator* allocator_for_copy(Allocator*) noexcept { return default_allocator(); }
+        template<class A> A* allocator_for_copy(A* other) noexcept  { return other; }
+
         template<typename T> constexpr 
         void destruct_items(T* data, isize from, isize to) noexcept
         {
@@ -157,8 +175,8 @@ namespace jot
         }
     }
     
-    template<class T>
-    bool set_capacity_failing(Array<T>* array, isize new_capacity) noexcept
+    template<class T, class A>
+    bool set_capacity_failing(Array<T, A>* array, isize new_capacity) noexcept
     {
         assert(is_invariant(*array));
 
@@ -172,6 +190,29 @@ namespace jot
         if(is_string && old_byte_cap != 0)
             old_byte_cap += (isize) sizeof(T);
 
+        //Trivially relocatable items can be moved by the allocator itself which might not need to copy at all 
+        // (mremap, realloc). The allocator does not know how much of the capacity is used and copies all of it 
+        // when it cannot avoid the copy. We thus only relocate when the allocator might do better than the plain 
+        // copy below (for runtime dispatched allocators we cannot know) and at least half of the capacity is used.
+        //Shrinks cutting off items go the other way since the cut items must be destroyed before relocating
+        // and could not be brought back if the relocation failed.
+        bool try_relocate = (has_own_relocate<A> || is_runtime_allocator<A>) 
+            && array->_size * 2 >= array->_capacity
+            && new_capacity >= array->_size;
+
+        if(is_trivially_relocatable<T> && try_relocate && old_byte_cap != 0 && new_byte_cap != 0)
+        {
+            void* relocated = dispatch_relocate(array->_allocator, array->_data, old_byte_cap, new_byte_cap, (isize) alignof(T), GET_LINE_INFO());
+            if(relocated == nullptr)
+                return false;
+
+            array->_data = (T*) relocated;
+            array->_capacity = new_capacity;
+            array_internal::null_terminate(array);
+            assert(is_invariant(*array));
+            return true;
+        }
+
         void* new_data = nullptr;
         bool state = memory_resize_allocate(array->_allocator, &new_data, new_byte_cap, 
             array->_data, old_byte_cap, (isize) alignof(T), GET_LINE_INFO());
@@ -183,17 +224,25 @@ namespace jot
         if(new_capacity < to_size)
             to_size = new_capacity;
 
+        array_internal::destruct_items(array->_data, new_capacity, array->_size);
         if(new_data != array->_data)
         {
             T* new_data_t = (T*) new_data; 
-            for(isize i = 0; i < to_size; i++)
+            if(is_trivially_relocatable<T>)
+            {
+                if(to_size > 0)
+                    memcpy((void*) new_data_t, (void*) array->_data, (size_t) to_size * sizeof(T));
+            }
+            else
             {
-                new(new_data_t + i) T((T&&) array->_data[i]);
-                array->_data[i].~T();
+                for(isize i = 0; i < to_size; i++)
+                {
+                    new(new_data_t + i) T((T&&) array->_data[i]);
+                    array->_data[i].~T();
+                }
             }
         }
 
-        array_internal::destruct_items(array->_data, new_capacity, array->_size);
         memory_resize_deallocate(array->_allocator, &new_data, new_byte_cap, 
             array->_data, old_byte_cap, (isize) alignof(T), GET_LINE_INFO());
 
@@ -210,55 +259,57 @@ namespace jot
         return true;
     }
 
-    template<typename T>
-    Array<T>::Array(Allocator* allocator) noexcept
+    template<typename T, typename A>
+    Array<T, A>::Array(A* allocator) noexcept
     {
         array_internal::set_data_to_termination(this);
         _allocator = allocator;
     }
 
-    template<typename T>
-    Array<T>::~Array() noexcept 
+    template<typename T, typename A>
+    Array<T, A>::~Array() noexcept 
     {
         assert(is_invariant(*this));
         if(_capacity != 0)
         {
             array_internal::destruct_items(_data, 0, _size);
             isize cap = _capacity + (isize) is_string_char<T>;
-            _allocator->deallocate(_data, cap * (isize) sizeof(T), (isize) alignof(T), GET_LINE_INFO());
+            dispatch_deallocate(_allocator, _data, cap * (isize) sizeof(T), (isize) alignof(T), GET_LINE_INFO());
         }
     }
 
-    template<typename T>
-    Array<T>::Array(Array && other) noexcept 
+    template<typename T, typename A>
+    Array<T, A>::Array(Array && other) noexcept 
     {
         array_internal::set_data_to_termination(this);
+        _allocator = array_internal::allocator_for_copy(other._allocator);
         *this = (Array&&) other;
     }
 
-    template<typename T>
-    Array<T>& Array<T>::operator=(Array<T> && other) noexcept 
+    template<typename T, typename A>
+    Array<T, A>& Array<T, A>::operator=(Array<T, A> && other) noexcept 
     {
         swap(this, &other);
         return *this;
     }
     
-    template<typename T>
-    Array<T>::Array(Array const& other) 
+    template<typename T, typename A>
+    Array<T, A>::Array(Array const& other) 
     {
         array_internal::set_data_to_termination(this);
+        _allocator = array_internal::allocator_for_copy(other._allocator);
         copy(this, slice(other));
     }
 
-    template<typename T>
-    Array<T>& Array<T>::operator=(Array<T> const& other) 
+    template<typename T, typename A>
+    Array<T, A>& Array<T, A>::operator=(Array<T, A> const& other) 
     {
         copy(this, slice(other));
         return *this;
     }
 
-    template<class T>
-    bool is_invariant(Array<T> const& array) noexcept
+    template<class T, class A>
+    bool is_invariant(Array<T, A> const& array) noexcept
     {
         bool size_inv = array._capacity >= array._size;
         bool capa_inv = array._capacity >= 0; 
@@ -278,8 +329,8 @@ namespace jot
         return result;
     }
      
-    template<class T>
-    bool reserve_failing(Array<T>* array, isize to_size) noexcept
+    template<class T, class A>
+    bool reserve_failing(Array<T, A>* array, isize to_size) noexcept
     {
         if (array->_capacity >= to_size)
             return true;
@@ -287,15 +338,15 @@ namespace jot
         return set_capacity_failing(array, to_size);
     }
     
-    template<class T>
-    void set_capacity(Array<T>* array, isize new_capacity)
+    template<class T, class A>
+    void set_capacity(Array<T, A>* array, isize new_capacity)
     {
         if(set_capacity_failing(array, new_capacity) == false)
         {
             const char* alloc_name = array->_allocator->get_stats().name; 
             isize requested = new_capacity* (isize) sizeof(T);
             memory_globals::out_of_memory_hadler()(GET_LINE_INFO(),
-                "Array<T> memory allocation failed! "
+                "Array<T, A> memory allocation failed! "
                 "Attempted to allocated %t bytes from allocator %p name %s"
                 "Array: {size: %t, capacity: %t} sizeof(T): %z",
                 requested, array->_allocator, 
@@ -304,15 +355,22 @@ namespace jot
         }
     }
 
-    template<class T>
-    void reserve(Array<T>* array, isize to_capacity)
+    template<class T, class A>
+    void reserve(Array<T, A>* array, isize to_capacity)
     {
         if (array->_capacity < to_capacity)
             set_capacity(array, to_capacity);
     }
 
-    template<class T>
-    void grow(Array<T>* array, isize to_fit)
+    template<class T, class A>
+    void shrink_to_fit(Array<T, A>* array)
+    {
+        if(array->_capacity != array->_size)
+            set_capacity(array, array->_size);
+    }
+
+    template<class T, class A>
+    void grow(Array<T, A>* array, isize to_fit)
     {
         if (array->_capacity >= to_fit)
             return;
@@ -325,8 +383,8 @@ namespace jot
         set_capacity(array, new_capacity);
     }
 
-    template<class T>
-    void copy(Array<T>* to, Slice<const T> from)
+    template<class T, class A>
+    void copy(Array<T, A>* to, Slice<const T> from)
     {
         assert(is_invariant(*to));
         reserve(to, from.size);
@@ -368,8 +426,8 @@ namespace jot
         return out;
     }
     
-    template <typename T>
-    void swap(Array<T>* left, Array<T>* right) noexcept
+    template <typename T, typename A>
+    void swap(Array<T, A>* left, Array<T, A>* right) noexcept
     { 
         swap(&left->_data, &right->_data);
         swap(&left->_size, &right->_size);
@@ -377,14 +435,14 @@ namespace jot
         swap(&left->_allocator, &right->_allocator);
     }
     
-    template<class T>
-    bool is_empty(Array<T> const& array) noexcept
+    template<class T, class A>
+    bool is_empty(Array<T, A> const& array) noexcept
     {
         return array._size == 0;
     }
     
-    template<class T>
-    void push(Array<T>* array, typename Array<T>::T what)
+    template<class T, class A>
+    void push(Array<T, A>* array, typename Array<T, A>::T what)
     {
         grow(array, array->_size + 1);
         
@@ -395,8 +453,8 @@ namespace jot
         assert(is_invariant(*array));
     }
 
-    template<class T> 
-    T pop(Array<T>* array) noexcept
+    template<class T, class A> 
+    T pop(Array<T, A>* array) noexcept
     {
         assert(is_invariant(*array));
         assert(array->_size != 0);
@@ -411,8 +469,8 @@ namespace jot
         return ret;
     }
 
-    template <class T>
-    void push_multiple(Array<T>* array, Slice<const typename Array<T>::T> inserted)
+    template <class T, class A>
+    void push_multiple(Array<T, A>* array, Slice<const typename Array<T, A>::T> inserted)
     {
         grow(array, array->_size + inserted.size);
         
@@ -425,8 +483,8 @@ namespace jot
         assert(is_invariant(*array));
     }
     
-    template <class T>
-    void push_multiple_move(Array<T>* array, Slice<typename Array<T>::T> inserted)
+    template <class T, class A>
+    void push_multiple_move(Array<T, A>* array, Slice<typename Array<T, A>::T> inserted)
     {
         grow(array, array->_size + inserted.size);
         
@@ -439,8 +497,8 @@ namespace jot
         assert(is_invariant(*array));
     }
 
-    template<class T> 
-    void pop_multiple(Array<T>* array, isize count) noexcept
+    template<class T, class A> 
+    void pop_multiple(Array<T, A>* array, isize count) noexcept
     {
         assert(count <= size(*array));
         array_internal::destruct_items(array->_data, array->_size - count, array->_size);
@@ -450,14 +508,14 @@ namespace jot
         assert(is_invariant(*array));
     }
     
-    template<class T> 
-    void clear(Array<T>* array) noexcept
+    template<class T, class A> 
+    void clear(Array<T, A>* array) noexcept
     {
         pop_multiple(array, array->_size);
     }
 
-    template <class T>
-    void resize(Array<T>* array, isize to, typename Array<T>::T const& fill_with) noexcept
+    template <class T, class A>
+    void resize(Array<T, A>* array, isize to, typename Array<T, A>::T const& fill_with) noexcept
     {
         assert(is_invariant(*array));
         assert(0 <= to);
@@ -474,8 +532,8 @@ namespace jot
         assert(is_invariant(*array));
     }
 
-    template<class T> 
-    void resize_for_overwrite(Array<T>* array, isize to)
+    template<class T, class A> 
+    void resize_for_overwrite(Array<T, A>* array, isize to)
     {
         assert(is_invariant(*array));
         reserve(array, to);
@@ -483,8 +541,8 @@ namespace jot
         array_internal::null_terminate(array);
     }
 
-    template<class T> 
-    void insert(Array<T>* array, isize at, typename Array<T>::T what)
+    template<class T, class A> 
+    void insert(Array<T, A>* array, isize at, typename Array<T, A>::T what)
     {
         assert(0 <= at && at <= array->_size);
         if(at >= size(*array))
@@ -492,6 +550,17 @@ namespace jot
             
         grow(array, array->_size + 1);
 
+        //Shift the items up bytewise and construct the new one in the gap
+        if(is_trivially_relocatable<T>)
+        {
+            memmove((void*) (array->_data + at + 1), (void*) (array->_data + at), (size_t) (array->_size - at) * sizeof(T));
+            new(array->_data + at) T((T&&) what);
+            array->_size += 1;
+            array_internal::null_terminate(array);
+            assert(is_invariant(*array));
+            return;
+        }
+
         T* created = &array->_data[array->_size];
         new(created) T((T&&) *(created - 1));
 
@@ -504,13 +573,22 @@ namespace jot
         assert(is_invariant(*array));
     }
 
-    template<class T> 
-    T remove(Array<T>* array, isize at) noexcept
+    template<class T, class A> 
+    T remove(Array<T, A>* array, isize at) noexcept
     {
         assert(0 <= at && at < array->_size);
         assert(array->_size > 0);
         
         T removed = (T&&) array->_data[at];
+        if(is_trivially_relocatable<T>)
+        {
+            array->_data[at].~T();
+            memmove((void*) (array->_data + at), (void*) (array->_data + at + 1), (size_t) (array->_size - at - 1) * sizeof(T));
+            array->_size -= 1;
+            array_internal::null_terminate(array);
+            assert(is_invariant(*array));
+            return removed;
+        }
         
         for(isize i = at; i < array->_size - 1; i++)
             array->_data[i] = (T&&) array->_data[i + 1];
@@ -522,8 +600,8 @@ namespace jot
         return removed;
     }
 
-    template<class T> 
-    T unordered_remove(Array<T>* array, isize at) noexcept
+    template<class T, class A> 
+    T unordered_remove(Array<T, A>* array, isize at) noexcept
     {
         assert(0 <= at && at < array->_size);
         assert(array->_size > 0);
@@ -532,8 +610,8 @@ namespace jot
         return pop(array);
     }
 
-    template<class T>
-    void unordered_insert(Array<T>* array, isize at, typename Array<T>::T what)
+    template<class T, class A>
+    void unordered_insert(Array<T, A>* array, isize at, typename Array<T, A>::T what)
     {
         assert(0 <= at && at <= array->_size);
 
@@ -5,6 +5,7 @@
 
 #include "time.h"
 #include "defines.h"
+#include "format.h"
 
 namespace jot
 {
@@ -374,4 +375,16 @@ namespace jot
     #endif
 }
 
-#include "undefs.h"
\ No newline at end of file
+#include "undefs.h"
+
+namespace jot
+{
+    template <> struct Formattable<Bench_Result>
+    {
+        static
+        void format(String_Builder* appender, Bench_Result result) noexcept
+        {
+            format_into(appender, "{ ", CFormat_Float{result.mean_ms, "%.8lf"}, "ms ", result.deviation_ms, " δ ", to_padded_format(result.iters, 9, ' '), " i }");
+        }
+    };
+}
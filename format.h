@@ -549,8 +549,13 @@ namespace jot
 
     static void format_adapted_into(String_Builder* into, String format_str, Slice<Format_Adaptor> adapted)
     {
-        //estimate the needed size so we dont need to reallocate so much
-        grow(into, size(into) + format_str.size + 5*adapted.size);
+        //estimate the needed size so we dont need to reallocate so much.
+        //Only the passed adaptors count - the unused trailing ones are null
+        isize used_adaptors = 0;
+        while(used_adaptors < adapted.size && adapted[used_adaptors]._data != nullptr)
+            used_adaptors ++;
+
+        grow(into, size(into) + format_str.size + 5*used_adaptors);
         constexpr String sub_for = make_constexpr_string("{}");
 
         isize last = 0;
@@ -1,6 +1,17 @@
 #pragma once
 
 #include "memory.h"
+#include "intrin.h"
+
+#ifndef JOT_HASH_TABLE_NO_SIMD
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #include <emmintrin.h>
+        #define JOT_HASH_TABLE_SSE2
+    #elif defined(__ARM_NEON) || defined(_M_ARM64)
+        #include <arm_neon.h>
+        #define JOT_HASH_TABLE_NEON
+    #endif
+#endif
 
 namespace jot
 {   
@@ -28,11 +39,16 @@ namespace jot
     {
         using Key = Key_;
         using Value = Value_;
+
+        static_assert(is_self_referential<Key_> == false && is_self_referential<Value_> == false, 
+            "Hash_Table moves its entries with memmove so they must not point into themselves");
         
         Allocator* _allocator = memory_globals::default_allocator();
         Key* _keys = nullptr;
         Value* _values = nullptr;
+        uint32_t* _hashes = nullptr; //low 32 bits of the hash of each entry. Only allocated when _stores_hashes
         uint32_t* _linker = nullptr;
+        uint8_t* _control = nullptr; //one tag byte per linker slot. Lives in the same allocation as _linker
         
         uint32_t _linker_size = 0;
         uint32_t _entries_size = 0;
@@ -45,6 +61,7 @@ namespace jot
         uint32_t _hash_collisions = 0; //The count of hash colisions currently in the table. Multiplicit keys are counted into this
         uint32_t _max_hash_collisions = 0;
         uint64_t _seed = *hash_table_globals::seed_ptr(); //The current set seed. Can be changed during rehash
+        bool _stores_hashes = false; //see store_hashes()
         
         //@NOTE: 
         // We store the jump table, keys and values all in seperate arrays for maximum cache utilization.
@@ -53,6 +70,15 @@ namespace jot
         // Because it doesnt have explicit links between keys with the same hash has to only ever delete entries in the jump table by marking 
         // them as deleted. After sufficient ammount of deleted entries rehashing is triggered (exactly the same ways as while adding) which 
         // only then properly removes the deleted jump table entries.
+        //
+        // Next to each jump table slot we keep a control byte holding either EMPTY, GRAVESTONE or the top 7 bits of the
+        // hash of the key it links to. Probing loads 16 control bytes at once (SSE2/NEON or a scalar loop) and only 
+        // dereferences _keys for the slots with matching tag. That way almost all negative lookups never touch the keys at all.
+        // The probe order is still plain linear probing slot by slot, the groups only skip the non matching slots.
+        // The first 16 control bytes are mirrored past the end so that a group can be loaded from any slot without wrapping.
+        //
+        // Both the slot and the control tag are derived only from the low 32 bits of the hash. Thus when the table is set to
+        // store hashes the 32 bits kept per entry are enough to rehash without calling hash at all.
 
         Hash_Table() noexcept {};
         explicit Hash_Table(Allocator* alloc, uint64_t seed = *hash_table_globals::seed_ptr()) noexcept 
@@ -156,16 +182,29 @@ namespace jot
         return table._max_hash_collisions;
     }
     
+    template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
+    bool stores_hashes(Hash_Table<Key, Value, hash, equals> const& table)
+    {
+        return table._stores_hashes;
+    }
+    
     template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
     void swap(Hash_Table<Key, Value, hash, equals>* left, Hash_Table<Key, Value, hash, equals>* right) noexcept
     {
         swap(&left->_allocator, &right->_allocator);
         swap(&left->_keys, &right->_keys);
         swap(&left->_values, &right->_values);
+        swap(&left->_hashes, &right->_hashes);
         swap(&left->_linker, &right->_linker);
+        swap(&left->_control, &right->_control);
+        swap(&left->_linker_size, &right->_linker_size);
         swap(&left->_entries_size, &right->_entries_size);
         swap(&left->_entries_capacity, &right->_entries_capacity);
         swap(&left->_gravestone_count, &right->_gravestone_count);
+        swap(&left->_hash_collisions, &right->_hash_collisions);
+        swap(&left->_max_hash_collisions, &right->_max_hash_collisions);
+        swap(&left->_seed, &right->_seed);
+        swap(&left->_stores_hashes, &right->_stores_hashes);
     }
 
     template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
@@ -185,11 +224,13 @@ namespace jot
         bool are_entries_simulatinous_alloced = (table._keys == nullptr) == (table._values == nullptr);
         bool are_entry_sizes_correct = (table._keys == nullptr) == (table._entries_capacity == 0);
         bool are_linker_sizes_correct = (table._linker == nullptr) == (table._linker_size == 0);
+        bool is_control_simulatinous_alloced = (table._linker == nullptr) == (table._control == nullptr);
+        bool are_hashes_alloced = (table._hashes != nullptr) == (table._stores_hashes && table._entries_capacity > 0);
 
         bool are_sizes_in_range = table._entries_size <= table._entries_capacity;
 
         bool res = is_size_power && is_alloc_not_null && are_entries_simulatinous_alloced 
-            && are_entry_sizes_correct && are_linker_sizes_correct && are_sizes_in_range;
+            && are_entry_sizes_correct && are_linker_sizes_correct && is_control_simulatinous_alloced && are_hashes_alloced && are_sizes_in_range;
 
         assert(res);
         return res;
@@ -201,6 +242,102 @@ namespace jot
         constexpr uint32_t GRAVESTONE_LINK = (uint32_t) -2;
         constexpr isize HASH_TABLE_LINKER_ALIGN = 8;
         constexpr isize HASH_TABLE_LINKER_BASE_SIZE = 16;
+
+        constexpr isize CONTROL_GROUP_SIZE = 16;
+        constexpr uint8_t CONTROL_EMPTY = 0x80;
+        constexpr uint8_t CONTROL_GRAVESTONE = 0xFE;
+        //Full slots hold 0xxxxxxx so EMPTY and GRAVESTONE are the only values with the top bit set
+
+        //Bit masks of slots within a group. Each slot takes 2^CONTROL_MASK_STRIDE_LOG2 bits of which only the lowest can be set
+        #ifdef JOT_HASH_TABLE_NEON
+        constexpr isize CONTROL_MASK_STRIDE_LOG2 = 2;
+        #else
+        constexpr isize CONTROL_MASK_STRIDE_LOG2 = 0;
+        #endif
+
+        struct Control_Group
+        {
+            uint64_t tags;    //slots whose control byte equals the searched tag
+            uint64_t empties; //EMPTY slots
+            uint64_t frees;   //EMPTY or GRAVESTONE slots
+        };
+
+        inline uint8_t control_tag(uint64_t hashed) noexcept
+        {
+            //The low bits select the slot. Multiplying spreads all 32 bits into the top ones 
+            // so the tag still differs for neighbouring slots once the table is larger than 2^25 slots.
+            return (uint8_t) (((uint32_t) hashed * (uint32_t) 0x9E3779B9) >> 25);
+        }
+
+        inline isize linker_alloc_size(isize linker_size) noexcept
+        {
+            if(linker_size == 0)
+                return 0;
+
+            return linker_size * (isize) sizeof(uint32_t) + linker_size + CONTROL_GROUP_SIZE;
+        }
+
+        inline Control_Group match_control_group(const uint8_t* group, uint8_t tag) noexcept
+        {
+            Control_Group out = {};
+            #if defined(JOT_HASH_TABLE_SSE2)
+                __m128i controls = _mm_loadu_si128((const __m128i*) (const void*) group);
+                __m128i tag_eq = _mm_cmpeq_epi8(controls, _mm_set1_epi8((char) tag));
+                __m128i empty_eq = _mm_cmpeq_epi8(controls, _mm_set1_epi8((char) CONTROL_EMPTY));
+                out.tags = (uint64_t) (uint32_t) _mm_movemask_epi8(tag_eq);
+                out.empties = (uint64_t) (uint32_t) _mm_movemask_epi8(empty_eq);
+                out.frees = (uint64_t) (uint32_t) _mm_movemask_epi8(controls);
+            #elif defined(JOT_HASH_TABLE_NEON)
+                //NEON has no movemask. Narrowing shift packs each 8 bit lane into 4 bits of a single 64 bit value.
+                uint8x16_t controls = vld1q_u8(group);
+                uint8x16_t tag_eq = vceqq_u8(controls, vdupq_n_u8(tag));
+                uint8x16_t empty_eq = vceqq_u8(controls, vdupq_n_u8(CONTROL_EMPTY));
+                uint8x16_t free_eq = vcltq_s8(vreinterpretq_s8_u8(controls), vdupq_n_s8(0));
+
+                const uint64_t lowest_bits = 0x1111111111111111ull;
+                out.tags = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(tag_eq), 4)), 0) & lowest_bits;
+                out.empties = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(empty_eq), 4)), 0) & lowest_bits;
+                out.frees = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(free_eq), 4)), 0) & lowest_bits;
+            #else
+                for(isize i = 0; i < CONTROL_GROUP_SIZE; i++)
+                {
+                    out.tags |= (uint64_t) (group[i] == tag) << i;
+                    out.empties |= (uint64_t) (group[i] == CONTROL_EMPTY) << i;
+                    out.frees |= (uint64_t) (group[i] >> 7) << i;
+                }
+            #endif
+            return out;
+        }
+
+        //offset of the first slot in mask. Mask must not be 0
+        inline isize first_in_mask(uint64_t mask) noexcept
+        {
+            size_t index = 0;
+            intrin__find_first_set_64(&index, mask);
+            return (isize) index >> CONTROL_MASK_STRIDE_LOG2;
+        }
+
+        //mask of all slots before the first slot in mask (all slots if mask is 0)
+        inline uint64_t before_first_in_mask(uint64_t mask) noexcept
+        {
+            return (mask & (0 - mask)) - 1;
+        }
+
+        inline void set_control(uint8_t* control, isize linker_size, isize slot, uint8_t value) noexcept
+        {
+            control[slot] = value;
+            //update the mirrored copy past the end. Runs at most once unless linker_size < CONTROL_GROUP_SIZE
+            for(isize i = slot; i < CONTROL_GROUP_SIZE; i += linker_size)
+                control[linker_size + i] = value;
+        }
+
+        template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
+        void set_slot(Hash_Table<Key, Value, hash, equals>* table, isize slot, uint32_t link, uint8_t control) noexcept
+        {
+            assert(0 <= slot && slot < table->_linker_size);
+            table->_linker[slot] = link;
+            set_control(table->_control, table->_linker_size, slot, control);
+        }
         
         template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
         bool set_entries_capacity(Hash_Table<Key, Value, hash, equals>* table, isize new_capacity) noexcept
@@ -211,17 +348,22 @@ namespace jot
             isize capa = table->_entries_capacity;
             isize key_size = (isize) sizeof(Key);
             isize value_size = (isize) sizeof(Value);
+            isize hash_size = table->_stores_hashes ? (isize) sizeof(uint32_t) : 0;
 
             void* new_keys = nullptr;
             void* new_values = nullptr;
+            void* new_hashes = nullptr;
             
             bool state1 = memory_resize_allocate(alloc, &new_keys, new_capacity*key_size, table->_keys, capa*key_size, (isize) alignof(Key), GET_LINE_INFO());
             bool state2 = memory_resize_allocate(alloc, &new_values, new_capacity*value_size, table->_values, capa*value_size, (isize) alignof(Value), GET_LINE_INFO());
+            bool state3 = memory_resize_allocate(alloc, &new_hashes, new_capacity*hash_size, table->_hashes, capa*hash_size, (isize) alignof(uint32_t), GET_LINE_INFO());
 
-            if(!state1 || !state2)
+            if(!state1 || !state2 || !state3)
             {
                 memory_resize_undo(alloc, &new_keys,   new_capacity*key_size,   table->_keys,   capa*key_size, (isize) alignof(Key), GET_LINE_INFO());
                 memory_resize_undo(alloc, &new_values, new_capacity*value_size, table->_values, capa*value_size, (isize) alignof(Value), GET_LINE_INFO());
+                memory_resize_undo(alloc, &new_hashes, new_capacity*hash_size,  table->_hashes, capa*hash_size, (isize) alignof(uint32_t), GET_LINE_INFO());
+                return false;
             }
 
             //destruct extra
@@ -239,14 +381,17 @@ namespace jot
 
             if(new_keys != table->_keys)        memmove(new_keys, table->_keys, new_size*sizeof(Key));
             if(new_values != table->_values)    memmove(new_values, table->_values, new_size*sizeof(Value));
+            if(new_hashes != table->_hashes)    memmove(new_hashes, table->_hashes, new_size*(size_t) hash_size);
         
             memory_resize_deallocate(alloc, &new_keys,   new_capacity*key_size,   table->_keys,   capa*key_size, (isize) alignof(Key), GET_LINE_INFO());
             memory_resize_deallocate(alloc, &new_values, new_capacity*value_size, table->_values, capa*value_size, (isize) alignof(Value), GET_LINE_INFO());
+            memory_resize_deallocate(alloc, &new_hashes, new_capacity*hash_size,  table->_hashes, capa*hash_size, (isize) alignof(uint32_t), GET_LINE_INFO());
 
             table->_entries_size = (uint32_t) new_size;
             table->_entries_capacity = (uint32_t) new_capacity;
             table->_keys = (Key*) new_keys;
             table->_values = (Value*) new_values;
+            table->_hashes = (uint32_t*) new_hashes;
         
             assert(is_invariant(*table));
             return true;
@@ -266,7 +411,7 @@ namespace jot
                 "must be big enough (no more shrinking than by factor of 4 at a time) and power of two");
             #endif
 
-            isize alloc_size = to_size * (isize) sizeof(uint32_t);
+            isize alloc_size = linker_alloc_size(to_size);
             void* allocation_result = table->_allocator->allocate(alloc_size, HASH_TABLE_LINKER_ALIGN, GET_LINE_INFO());
             if(allocation_result == nullptr)
                 return false; 
@@ -328,6 +473,8 @@ namespace jot
 
                 table->_keys[forward_index] = move(&table->_keys[backward_index]);
                 table->_values[forward_index] = move(&table->_values[backward_index]);
+                if(table->_hashes != nullptr)
+                    table->_hashes[forward_index] = table->_hashes[backward_index];
 
                 swap(&marks[forward_index], &marks[backward_index]);
 
@@ -335,31 +482,48 @@ namespace jot
                 backward_index--;
             }
 
-            //fill new_linker to empty
+            //fill new_linker and new_control to empty
             Slice<uint32_t> new_linker = {(uint32_t*) allocation_result, to_size};
             for(isize i = 0; i < new_linker.size; i++)
                 new_linker[i] = EMPTY_LINK;
+            
+            uint8_t* new_control = (uint8_t*) (void*) (new_linker.data + to_size);
+            memset(new_control, CONTROL_EMPTY, (size_t) (to_size + CONTROL_GROUP_SIZE));
 
             //rehash every entry up to alive_count
             uint64_t mask = (uint64_t) new_linker.size - 1;
             uint32_t hash_collision_count = 0;
 
+            //stored hashes are valid only for the seed they were computed with
+            bool use_stored = table->_hashes != nullptr && seed == table->_seed;
             assert(alive_count <= new_linker.size && "there must be enough size to fit all entries");
             for(isize entry_index = 0; entry_index < alive_count; entry_index++)
             {
-                uint64_t hashed = hash(table->_keys[entry_index], seed);
+                uint64_t hashed = 0;
+                if(use_stored)
+                    hashed = table->_hashes[entry_index];
+                else
+                {
+                    hashed = hash(table->_keys[entry_index], seed);
+                    if(table->_hashes != nullptr)
+                        table->_hashes[entry_index] = (uint32_t) hashed;
+                }
                 uint64_t slot = hashed & mask;
 
                 //if linker slot is taken iterate until we find an empty slot
-                for(isize passed = 0;; slot = (slot + 1) & mask, passed ++)
+                for(isize passed = 0;; passed += CONTROL_GROUP_SIZE)
                 {
-                    uint32_t link = new_linker[(isize) slot];
-                    if(link == hash_table_internal::EMPTY_LINK)
-                        break;
-
                     assert(passed < new_linker.size && 
                         "there must be enough size to fit all entries"
                         "this assert should never occur");
+
+                    uint64_t group_i = ((hashed & mask) + (uint64_t) passed) & mask;
+                    Control_Group group = match_control_group(new_control + group_i, 0);
+                    if(group.empties != 0)
+                    {
+                        slot = (group_i + (uint64_t) first_in_mask(group.empties)) & mask;
+                        break;
+                    }
                 }
 
                 //if was not placed in it originalindex => hash collision occured
@@ -367,6 +531,7 @@ namespace jot
                     hash_collision_count += 1;
 
                 new_linker[(isize) slot] = (uint32_t) entry_index;
+                set_control(new_control, to_size, (isize) slot, control_tag(hashed));
             }
 
             //destroy the dead entries
@@ -382,11 +547,12 @@ namespace jot
             table->_gravestone_count = 0;
             table->_entries_size = (uint32_t) alive_count;
             table->_linker = new_linker.data;
+            table->_control = new_control;
             table->_linker_size = (uint32_t) to_size;
 
             if(old_linker.size != 0)
             {
-                isize dealloc_size = old_linker.size * (isize) sizeof(uint32_t);
+                isize dealloc_size = linker_alloc_size(old_linker.size);
                 table->_allocator->deallocate(old_linker.data, dealloc_size, HASH_TABLE_LINKER_ALIGN, GET_LINE_INFO());
             }
             
@@ -405,38 +571,95 @@ namespace jot
         }
     }
     
-    template <class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
-    Hash_Found find(Hash_Table<Key, Value, hash, equals> const& table, Id<Key> const& key, uint64_t hashed) noexcept
+    namespace hash_table_internal
     {
-        assert(is_invariant(table));
-        Hash_Found found = {};
-        found.hash_index = -1;
-        found.entry_index = -1;
+        //Linearly probes from start_slot until the first empty slot comparing only the keys with matching control tag
+        template <class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
+        Hash_Found find_from(Hash_Table<Key, Value, hash, equals> const& table, Id<Key> const& key, uint64_t hashed, uint64_t start_slot) noexcept
+        {
+            assert(is_invariant(table));
+            Hash_Found found = {};
+            found.hash_index = -1;
+            found.entry_index = -1;
+
+            if(table._linker_size == 0)
+                return found;
+
+            uint64_t mask = (uint64_t) table._linker_size - 1;
+            uint8_t tag = control_tag(hashed);
+            for(isize passed = 0; passed < table._linker_size; passed += CONTROL_GROUP_SIZE)
+            {
+                uint64_t group_i = (start_slot + (uint64_t) passed) & mask;
+                Control_Group group = match_control_group(table._control + group_i, tag);
+                for(uint64_t candidates = group.tags & before_first_in_mask(group.empties); candidates != 0; candidates &= candidates - 1)
+                {
+                    isize offset = first_in_mask(candidates);
+                    if(passed + offset >= table._linker_size)
+                        return found;
+
+                    isize slot = (isize) ((group_i + (uint64_t) offset) & mask);
+                    uint32_t link = table._linker[slot];
+                    assert(link < table._entries_size);
+                    if(table._hashes != nullptr && table._hashes[link] != (uint32_t) hashed)
+                        continue;
+
+                    if(equals(table._keys[link], key))
+                    {
+                        found.hash_index = slot;
+                        found.entry_index = link;
+                        return found;
+                    }
+                }
+
+                if(group.empties != 0)
+                    break;
+            }
 
-        if(table._linker_size == 0)
             return found;
+        }
 
-        uint64_t mask = (uint64_t) table._linker_size - 1;
-        uint64_t i = hashed & mask;
-        for(isize passed = 0;; i = (i + 1) & mask, passed ++)
+        //Linearly probes from the slot of hashed until the first free (empty or gravestone) slot and returns it
+        // In found_existing returns the slot of the first key equal to key before it or -1
+        template <class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
+        uint64_t find_free_slot(Hash_Table<Key, Value, hash, equals> const& table, Id<Key> const* key, uint64_t hashed, isize* found_existing) noexcept
         {
-            uint32_t link = table._linker[(isize) i];
-            if(link == hash_table_internal::EMPTY_LINK || passed > table._linker_size)
-                break;
+            assert(table._linker_size > 0);
+            uint64_t mask = (uint64_t) table._linker_size - 1;
+            uint8_t tag = control_tag(hashed);
+            for(isize passed = 0;; passed += CONTROL_GROUP_SIZE)
+            {
+                assert(passed < table._linker_size && "should never make a full rotation!");
 
-            if(link == hash_table_internal::GRAVESTONE_LINK)
-                continue;
+                uint64_t group_i = ((hashed & mask) + (uint64_t) passed) & mask;
+                Control_Group group = match_control_group(table._control + group_i, tag);
+                if(key != nullptr)
+                {
+                    for(uint64_t candidates = group.tags & before_first_in_mask(group.frees); candidates != 0; candidates &= candidates - 1)
+                    {
+                        isize slot = (isize) ((group_i + (uint64_t) first_in_mask(candidates)) & mask);
+                        uint32_t link = table._linker[slot];
+                        assert(link < table._entries_size);
+                        if(table._hashes != nullptr && table._hashes[link] != (uint32_t) hashed)
+                            continue;
+
+                        if(equals(table._keys[link], *key))
+                        {
+                            *found_existing = slot;
+                            return (uint64_t) slot;
+                        }
+                    }
+                }
 
-            assert(link < table._entries_size);
-            if(equals(table._keys[link], key))
-            {
-                found.hash_index = (isize) i;
-                found.entry_index = link;
-                break;
+                if(group.frees != 0)
+                    return (group_i + (uint64_t) first_in_mask(group.frees)) & mask;
             }
         }
+    }
 
-        return found;
+    template <class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
+    Hash_Found find(Hash_Table<Key, Value, hash, equals> const& table, Id<Key> const& key, uint64_t hashed) noexcept
+    {
+        return hash_table_internal::find_from(table, key, hashed, hashed);
     }
 
     template <class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
@@ -451,20 +674,30 @@ namespace jot
         if(table._linker_size == 0)
             return found;
 
+        using namespace hash_table_internal;
         uint64_t mask = (uint64_t) table._linker_size - 1;
-        uint64_t i = hashed & mask;
-        for(isize passed = 0;; i = (i + 1) & mask, passed ++)
+        uint8_t tag = control_tag(hashed);
+        for(isize passed = 0; passed < table._linker_size; passed += CONTROL_GROUP_SIZE)
         {
-            uint32_t link = table._linker[(isize) i];
-            if(link == (uint32_t) hash_table_internal::EMPTY_LINK || passed > table._linker_size)
-                break;
-
-            if(link == (uint32_t) entry_i)
+            uint64_t group_i = (hashed + (uint64_t) passed) & mask;
+            Control_Group group = match_control_group(table._control + group_i, tag);
+            for(uint64_t candidates = group.tags & before_first_in_mask(group.empties); candidates != 0; candidates &= candidates - 1)
             {
-                found.hash_index = (isize) i;
-                found.entry_index = link;
-                break;
+                isize offset = first_in_mask(candidates);
+                if(passed + offset >= table._linker_size)
+                    return found;
+
+                isize slot = (isize) ((group_i + (uint64_t) offset) & mask);
+                if(table._linker[slot] == (uint32_t) entry_i)
+                {
+                    found.hash_index = slot;
+                    found.entry_index = entry_i;
+                    return found;
+                }
             }
+
+            if(group.empties != 0)
+                break;
         }
 
         return found;
@@ -476,7 +709,7 @@ namespace jot
     {
         assert(0 <= removed.hash_index && removed.hash_index < table->_linker_size && "out of range!");
 
-        table->_linker[removed.hash_index] = (uint32_t) hash_table_internal::GRAVESTONE_LINK;
+        hash_table_internal::set_slot(table, removed.hash_index, hash_table_internal::GRAVESTONE_LINK, hash_table_internal::CONTROL_GRAVESTONE);
         table->_gravestone_count += 2; //one for the link and one for the entry 
         //=> when only marking entries we will rehash faster then when removing them
     }
@@ -496,7 +729,7 @@ namespace jot
         Slice<Key> keys         = {table->_keys,   table->_entries_size};
         Slice<Value> values     = {table->_values, table->_entries_size};
 
-        linker[removed.hash_index] = (uint32_t) hash_table_internal::GRAVESTONE_LINK;
+        hash_table_internal::set_slot(table, removed.hash_index, hash_table_internal::GRAVESTONE_LINK, hash_table_internal::CONTROL_GRAVESTONE);
         table->_gravestone_count += 1;
         
         Hash_Table_Entry<Key, Value> removed_entry_data = {
@@ -507,7 +740,9 @@ namespace jot
         bool delete_last = true;
         if(removed_i != last)
         {
-            uint64_t last_hash = hash(keys[last], table->_seed);
+            uint64_t last_hash = table->_hashes != nullptr 
+                ? table->_hashes[last] 
+                : hash(keys[last], table->_seed);
             Hash_Found changed_for = find_found_entry(*table, last, last_hash);
 
             //in the case the table contains 'mark_removed' entries
@@ -518,9 +753,12 @@ namespace jot
             //  arent when using mark_removed)
             if(changed_for.hash_index != -1)
             {
+                //the moved key keeps its hash and thus also its control tag
                 linker[changed_for.hash_index] = (uint32_t) removed_i;
                 keys[removed_i] = move(&keys[last]);
                 values[removed_i] = move(&values[last]);
+                if(table->_hashes != nullptr)
+                    table->_hashes[removed_i] = table->_hashes[last];
             }
             else
                 delete_last = false;
@@ -597,7 +835,7 @@ namespace jot
     void rehash(Hash_Table<Key, Value, hash, equals>* table, isize to_size, uint64_t seed, Hash_Table_Growth growth = {})
     {
         if(rehash_failing(table, to_size, seed, growth) == false)
-            hash_table_internal::panic_out_of_memory(*table, GET_LINE_INFO(), to_size * (isize) sizeof(uint32_t), "rehash");
+            hash_table_internal::panic_out_of_memory(*table, GET_LINE_INFO(), hash_table_internal::linker_alloc_size(to_size), "rehash");
     }
 
     template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals> 
@@ -619,6 +857,44 @@ namespace jot
     }
 
 
+    ///When enabled keeps the low 32 bits of the hash of every entry in a separate array. Probes then compare 
+    /// the stored hashes before calling equals and rehashing (with unchanged seed) never calls hash. 
+    ///Costs 4 bytes per entry. Worth it for keys with expensive hash or equals such as strings.
+    template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
+    void store_hashes(Hash_Table<Key, Value, hash, equals>* table, bool store = true)
+    {
+        assert(is_invariant(*table));
+        if(table->_stores_hashes == store)
+            return;
+
+        isize alloc_size = (isize) table->_entries_capacity * (isize) sizeof(uint32_t);
+        if(store == false)
+        {
+            if(table->_hashes != nullptr)
+                table->_allocator->deallocate(table->_hashes, alloc_size, (isize) alignof(uint32_t), GET_LINE_INFO());
+
+            table->_hashes = nullptr;
+            table->_stores_hashes = false;
+            return;
+        }
+
+        if(alloc_size > 0)
+        {
+            uint32_t* hashes = (uint32_t*) table->_allocator->allocate(alloc_size, (isize) alignof(uint32_t), GET_LINE_INFO());
+            if(hashes == nullptr)
+                hash_table_internal::panic_out_of_memory(*table, GET_LINE_INFO(), alloc_size, "store_hashes");
+
+            //also hashes the entries only marked as removed. They will be removed on next rehash
+            for(isize i = 0; i < table->_entries_size; i++)
+                hashes[i] = (uint32_t) hash(table->_keys[i], table->_seed);
+
+            table->_hashes = hashes;
+        }
+
+        table->_stores_hashes = true;
+        assert(is_invariant(*table));
+    }
+
     template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
     Hash_Table<Key, Value, hash, equals>::~Hash_Table() noexcept 
     {
@@ -627,7 +903,7 @@ namespace jot
 
         if(_linker != nullptr)
         {
-            isize dealloc_size = _linker_size * (isize) sizeof(uint32_t);
+            isize dealloc_size = hash_table_internal::linker_alloc_size(_linker_size);
             _allocator->deallocate(_linker, dealloc_size, hash_table_internal::HASH_TABLE_LINKER_ALIGN, GET_LINE_INFO());
         }
     }
@@ -677,14 +953,14 @@ namespace jot
                 rehash_to = growth.jump_table_base_size;
 
             if(hash_table_internal::unsafe_rehash(table, rehash_to, table->_seed) == false)
-                hash_table_internal::panic_out_of_memory(*table, GET_LINE_INFO(), rehash_to * (isize) sizeof(uint32_t), "grow_if_overfull");
+                hash_table_internal::panic_out_of_memory(*table, GET_LINE_INFO(), hash_table_internal::linker_alloc_size(rehash_to), "grow_if_overfull");
         }
     }
     
     namespace hash_table_internal
     {
         template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
-        void push_new(Hash_Table<Key, Value, hash, equals>* table, Key key, Value value, uint64_t original_hash_index, uint64_t insert_at_index, Hash_Table_Growth growth)
+        void push_new(Hash_Table<Key, Value, hash, equals>* table, Key key, Value value, uint64_t original_hash_index, uint64_t insert_at_index, uint64_t hashed, Hash_Table_Growth growth)
         {
             assert(is_invariant(*table));
             assert(insert_at_index < table->_linker_size && "must be within array!");
@@ -711,9 +987,11 @@ namespace jot
 
             new (&table->_keys[size]) Key(move(&key));
             new (&table->_values[size]) Value(move(&value));
+            if(table->_hashes != nullptr)
+                table->_hashes[size] = (uint32_t) hashed;
 
             table->_entries_size += 1;
-            table->_linker[insert_at_index] = (uint32_t) table->_entries_size - 1;
+            set_slot(table, (isize) insert_at_index, (uint32_t) table->_entries_size - 1, control_tag(hashed));
         
             assert(is_invariant(*table));
         }
@@ -724,25 +1002,17 @@ namespace jot
         grow_if_overfull(table, growth);
         assert(table->_linker_size != 0);
 
-        uint64_t mask = (uint64_t) table->_linker_size - 1;
-        uint64_t start_i = hash(key, table->_seed) & mask;
-        uint64_t i = start_i;
-        for(isize passed = 0;; i = (i + 1) & mask, passed ++)
+        uint64_t hashed = hash(key, table->_seed);
+        uint64_t start_i = hashed & ((uint64_t) table->_linker_size - 1);
+        isize existing = -1;
+        uint64_t i = hash_table_internal::find_free_slot(*table, &key, hashed, &existing);
+        if(existing != -1)
         {
-            assert(passed < table->_linker_size);
-
-            uint32_t link = table->_linker[(isize) i];
-            if(link == hash_table_internal::EMPTY_LINK || link == hash_table_internal::GRAVESTONE_LINK)
-                break;
-
-            if(equals(table->_keys[link], key))
-            {
-                values(table)[link] = move(&value);
-                return i;
-            }
+            values(table)[table->_linker[existing]] = move(&value);
+            return existing;
         }
 
-        hash_table_internal::push_new(table, move(&key), move(&value), start_i, i, growth);
+        hash_table_internal::push_new(table, move(&key), move(&value), start_i, i, hashed, growth);
         return table->_entries_size;
     }
     
@@ -752,7 +1022,11 @@ namespace jot
         Hash_Found find_next(Hash_Table<Key, Value, hash, equals> const& table, Id<Key> const& prev_key, Hash_Found prev) noexcept
         {
             assert(prev.hash_index != -1 && prev.entry_index != -1 && "must be found!");
-            return find(table, prev_key, (uint64_t) prev.hash_index + 1);
+            //probing uses only the low 32 bits so the stored hash is just as good
+            uint64_t hashed = table._hashes != nullptr 
+                ? table._hashes[prev.entry_index] 
+                : hash(prev_key, table._seed);
+            return hash_table_internal::find_from(table, prev_key, hashed, (uint64_t) prev.hash_index + 1);
         }
 
         template<class Key, class Value, Hash_Fn<Key> hash, Equal_Fn<Key> equals>
@@ -762,18 +1036,11 @@ namespace jot
             grow_if_overfull(table, growth);
             
             assert(table->_linker_size > 0);
-            uint64_t mask = (uint64_t) table->_linker_size - 1;
-            uint64_t start_i = hash(key, table->_seed) & mask;
-            uint64_t i = start_i;
-            for(isize passed = 0;; i = (i + 1) & mask, passed ++)
-            {
-                assert(passed < table->_linker_size && "should never make a full rotation!");
-                uint32_t link = table->_linker[i];
-                if(link == hash_table_internal::EMPTY_LINK || link == hash_table_internal::GRAVESTONE_LINK)
-                    break;
-            }
+            uint64_t hashed = hash(key, table->_seed);
+            uint64_t start_i = hashed & ((uint64_t) table->_linker_size - 1);
+            uint64_t i = hash_table_internal::find_free_slot<Key, Value, hash, equals>(*table, nullptr, hashed, nullptr);
 
-            hash_table_internal::push_new(table, move(&key), move(&value), start_i, i, growth);
+            hash_table_internal::push_new(table, move(&key), move(&value), start_i, i, hashed, growth);
             return table->_entries_size;
         }
     }
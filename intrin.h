@@ -9,6 +9,7 @@
 #if 0
 #define INTRIN_DISSABLE_ALL
 #define INTRIN_NO_FIND_FIRST_SET
+#define INTRIN_NO_FIND_LAST_SET
 #define INTRIN_NO_POPCOUNT
 #define INTRIN_NO_UNREACHABLE
 #define INTRIN_NO_TRAP
@@ -61,9 +62,12 @@
         // are simply missing and the program doesnt even compile
         #define INTRIN_NO_POPCOUNT
         #define INTRIN_NO_FIND_FIRST_SET
+        #define INTRIN_NO_FIND_LAST_SET
     #else
         #pragma intrinsic(_BitScanForward)
         #pragma intrinsic(_BitScanForward64)
+        #pragma intrinsic(_BitScanReverse)
+        #pragma intrinsic(_BitScanReverse64)
         #pragma intrinsic(__popcnt)
         #pragma intrinsic(__popcnt64)
     #endif
@@ -71,6 +75,7 @@
 
 #ifdef INTRIN_DISSABLE_ALL
 #define INTRIN_NO_FIND_FIRST_SET
+#define INTRIN_NO_FIND_LAST_SET
 #define INTRIN_NO_POPCOUNT
 #define INTRIN_NO_UNREACHABLE
 #define INTRIN_NO_TRAP
@@ -140,6 +145,78 @@ static bool intrin__find_first_set_64(size_t* out, uint64_t search_in)
         return _fallback_intrin__find_first_set_64(out, (uint64_t) search_in);
     #endif
 }
+
+static bool _fallback_intrin__find_last_set_64(size_t* out, uint64_t search_in)
+{
+    if(search_in == 0)
+    {
+        *out = (size_t) -1;
+        return false;
+    }
+
+    size_t k = 0;
+    if (search_in & 0xFFFFFFFF00000000u) { search_in >>= 32; k |= 32; }
+    if (search_in & 0x00000000FFFF0000u) { search_in >>= 16; k |= 16; }
+    if (search_in & 0x000000000000FF00u) { search_in >>= 8;  k |= 8;  }
+    if (search_in & 0x00000000000000F0u) { search_in >>= 4;  k |= 4;  }
+    if (search_in & 0x000000000000000Cu) { search_in >>= 2;  k |= 2;  }
+    if (search_in & 0x0000000000000002u) {                   k |= 1;  }
+
+    *out = k;
+    return true;
+}
+
+static bool intrin__find_last_set_32(size_t* out, uint32_t search_in)
+{
+    #if defined(INTRIN_COMPILER__MSVC) \
+        && !defined(INTRIN_NO_FIND_LAST_SET) 
+
+        unsigned long index = 0;
+        bool ret = _BitScanReverse(&index, (unsigned long) search_in) != 0;
+        *out = (size_t) index;
+        return ret;
+    #elif (defined(INTRIN_COMPILER__GNUC) || defined(INTRIN_COMPILER__CLANG)) \
+        && !defined(INTRIN_NO_FIND_LAST_SET) 
+
+        //__builtin_clz is undefined for 0
+        if(search_in == 0)
+        {
+            *out = (size_t) -1;
+            return false;
+        }
+
+        *out = (size_t) (31 - __builtin_clz((unsigned int) search_in));
+        return true;
+    #else
+        return _fallback_intrin__find_last_set_64(out, (uint64_t) search_in);
+    #endif
+}
+
+static bool intrin__find_last_set_64(size_t* out, uint64_t search_in)
+{
+    #if defined(INTRIN_COMPILER__MSVC) \
+        && !defined(INTRIN_NO_FIND_LAST_SET) 
+
+        unsigned long index = 0;
+        bool ret = _BitScanReverse64(&index, (unsigned long long) search_in) != 0;
+        *out = (size_t) index;
+        return ret;
+    #elif (defined(INTRIN_COMPILER__GNUC) || defined(INTRIN_COMPILER__CLANG)) \
+        && !defined(INTRIN_NO_FIND_LAST_SET) 
+
+        if(search_in == 0)
+        {
+            *out = (size_t) -1;
+            return false;
+        }
+
+        *out = (size_t) (63 - __builtin_clzll((unsigned long long) search_in));
+        return true;
+    #else
+        return _fallback_intrin__find_last_set_64(out, (uint64_t) search_in);
+    #endif
+}
+
 //ctz <=> forward
 //clz <=> backward
 
@@ -237,6 +314,10 @@ int main()
     printf("was_found: %d\n", (int) was_found); //1
     printf("index: %d\n", (int) index);         //4
 
+    was_found = intrin__find_last_set_32(&index, 0b010110000);
+    printf("was_found: %d\n", (int) was_found); //1
+    printf("index: %d\n", (int) index);         //7
+
     if(false) //will not get transleted into asembly
     {
         intrin__trap();
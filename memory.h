@@ -9,6 +9,26 @@
     #include <stdlib.h>
     #define JOT_MALLOC(size) malloc(size)
     #define JOT_FREE(ptr)    free(ptr)
+    #define JOT_REALLOC(ptr, size) realloc(ptr, size)
+
+    //Returns the free memory cached inside malloc back to the os
+    #if defined(__GLIBC__)
+        #include <malloc.h>
+        #define JOT_MALLOC_TRIM() malloc_trim(0)
+    #elif defined(_MSC_VER)
+        #include <malloc.h>
+        #define JOT_MALLOC_TRIM() _heapmin()
+    #endif
+#endif
+
+#ifndef JOT_MALLOC_TRIM
+    #define JOT_MALLOC_TRIM() 0
+#endif
+
+//Malloc_Allocator serves big allocations from its own mappings so that they can be grown with mremap
+#if defined(__linux__) && !defined(JOT_NO_MREMAP)
+    #define JOT_USE_MREMAP
+    #include <sys/mman.h>
 #endif
 
 using isize = ptrdiff_t;
@@ -37,6 +57,24 @@ namespace jot
         ///Returns partially filled Allocator_Stats. Not tracked fields are 0
         virtual Allocator_Stats get_stats() const noexcept = 0;
 
+        ///Resizes the allocation potentially moving it to a new address and returns it. The contents are moved
+        ///as if by memcpy so this must only be used for trivially relocatable data. On failure returns nullptr
+        ///and the original allocation is left untouched. By default tries resize then allocates, copies and deallocates.
+        virtual void* relocate(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept;
+
+        ///Makes count allocations of size bytes aligned to align writing them into out_ptrs. Either all allocations
+        ///succeed and returns true or none are made, out_ptrs are set to nullptr and returns false. Lets node heavy 
+        ///structures pay for a single call instead of count. By default calls allocate count times.
+        virtual bool allocate_batch(isize count, isize size, isize align, void** out_ptrs, Line_Info callee) noexcept;
+        
+        ///Deallocates count allocations of the same old_size and align. By default calls deallocate count times.
+        virtual bool deallocate_batch(isize count, isize old_size, isize align, void** allocated_ptrs, Line_Info callee) noexcept;
+
+        ///Returns memory not used by any allocation (cached blocks, unused tails of buffers) to the parent allocator 
+        ///or the os. All allocations stay valid. Returns the number of bytes released where it can be known. 
+        ///Does nothing by default.
+        virtual isize release_extra_memory() noexcept { return 0; }
+
         virtual ~Allocator() noexcept {}
         
         //@NOTE: We also pass line info to each allocation function. This is used to give better error/info messages esentially for free
@@ -55,15 +93,56 @@ namespace jot
     ///These three functions let us easily write custom 'set_capacity' or 'realloc' functions without losing on generality or safety. (see ALLOC_RESIZE_EXAMPLE)
     ///They primarily serve to simplify writing reallocation rutines for SOA structs where we want all of the arrays to have the same capacity.
     /// this means that if one fails all the allocations should be undone (precisely what memory_resize_undo does) and the funtion should fail
-    static bool memory_resize_allocate(Allocator* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept;
-    static bool memory_resize_deallocate(Allocator* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept;
-    static bool memory_resize_undo(Allocator* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept;
+    ///Can be called with any allocator type A (see dispatch_allocate)
+    template<class A> static bool memory_resize_allocate(A* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept;
+    template<class A> static bool memory_resize_deallocate(A* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept;
+    template<class A> static bool memory_resize_undo(A* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept;
+
+    ///The default relocate: tries resize then allocates, copies and deallocates. All calls go through 
+    /// dispatch_* so for concrete A none of them are virtual.
+    template<class A> static void* relocate_default(A* alloc, void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept;
+
+    ///Calls to allocators through their static type. When A is a concrete allocator (such as Arena_Allocator) the call
+    /// is not virtual and can be inlined into the caller. Used by containers which take the allocator type as a template
+    /// parameter. A must be the most derived type of the allocator! For A = Allocator these are the usual virtual calls.
+    template<class A> void* dispatch_allocate(A* alloc, isize size, isize align, Line_Info callee) noexcept;
+    template<class A> bool  dispatch_deallocate(A* alloc, void* allocated, isize old_size, isize align, Line_Info callee) noexcept;
+    template<class A> bool  dispatch_resize(A* alloc, void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept;
+    template<class A> void* dispatch_relocate(A* alloc, void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept;
+
+    ///True for the type erased Allocator whose calls are all virtual
+    template<class A> static constexpr bool is_runtime_allocator = false;
+    template<> constexpr bool is_runtime_allocator<Allocator> = true;
+
+    namespace allocator_internal
+    {
+        //&A::relocate has type of member of Allocator unless A overrides it
+        template<class Method> static constexpr bool is_base_method = false;
+        template<class R, class... Args> static constexpr bool is_base_method<R (Allocator::*)(Args...) noexcept> = true;
+    }
+
+    ///True if the allocator type A provides its own relocate (such as Malloc_Allocator using realloc or mremap) which 
+    /// might avoid copying. The default relocate always allocates and copies the whole old size. 
+    ///Cannot be known for the runtime dispatched Allocator and is false for it.
+    template<class A> static constexpr bool has_own_relocate = 
+        allocator_internal::is_base_method<decltype(&A::relocate)> == false && is_runtime_allocator<A> == false;
+
+    ///Tells containers that move their items with memcpy/memmove regardless of the item type (Hash_Table, Slot_Array)
+    /// that T points into itself and thus must not be stored in them. Provide specialization for such types.
+    template<class T> static constexpr bool is_self_referential = false;
+
+    inline void* dispatch_allocate(Allocator* alloc, isize size, isize align, Line_Info callee) noexcept;
+    inline bool  dispatch_deallocate(Allocator* alloc, void* allocated, isize old_size, isize align, Line_Info callee) noexcept;
+    inline bool  dispatch_resize(Allocator* alloc, void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept;
+    inline void* dispatch_relocate(Allocator* alloc, void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept;
 
     ///Similar to realloc. Attempts to grow the allocation in place if succeeds return the same adress else allocates a new storage and memcopies the data over.
     ///Returns NULL on error
     static void* reallocate(Allocator* alloc, void* old_allocated, isize new_size, isize old_size, isize align, Line_Info callee) noexcept;
 
-    ///Allocates using aligned_malloc/aligned_free
+    ///Allocates using aligned_malloc/aligned_free. On linux allocations of at least MMAP_THRESHOLD bytes
+    /// are given their own mapping which can be resized in place and relocated without copying using mremap.
+    /// Small allocations are relocated using realloc.
     struct Malloc_Allocator : Allocator
     {
         isize total_alloced = 0;
@@ -71,10 +150,16 @@ namespace jot
         isize allocation_count = 0;
         isize deallocation_count = 0;
         isize resize_count = 0;
+
+        static constexpr isize MMAP_THRESHOLD = 256 * 1024;
         
         virtual void* allocate(isize size, isize align, Line_Info) noexcept override;
         virtual bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override;
-        virtual bool resize(void* allocated, isize new_size, isize old_size, isize align, Line_Info callee) noexcept override;
+        virtual bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override;
+        virtual void* relocate(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override;
+        virtual bool allocate_batch(isize count, isize size, isize align, void** out_ptrs, Line_Info callee) noexcept override;
+        virtual bool deallocate_batch(isize count, isize old_size, isize align, void** allocated_ptrs, Line_Info callee) noexcept override;
+        virtual isize release_extra_memory() noexcept override;
         virtual Allocator_Stats get_stats() const noexcept override;
         virtual ~Malloc_Allocator() noexcept override {}
     };
@@ -82,6 +167,7 @@ namespace jot
     namespace memory_constants
     {
         static constexpr int64_t PAGE = 4096;
+        static constexpr int64_t HUGE_PAGE = 2 * ((int64_t) 1 << 20);
         static constexpr int64_t KIBI_BYTE = (int64_t) 1 << 10;
         static constexpr int64_t MEBI_BYTE = (int64_t) 1 << 20;
         static constexpr int64_t GIBI_BYTE = (int64_t) 1 << 30;
@@ -103,6 +189,14 @@ namespace jot
         isize allocation_count;
         isize deallocation_count;
         isize resize_count;
+
+        //bytes of bytes_used actually backed by huge pages
+        isize bytes_huge_page_backed;
+
+        //Blocks obtained from parent versus blocks kept from before that got used again. 
+        //Only tracked by allocators which keep their blocks around (Frame_Allocator)
+        isize blocks_added;
+        isize blocks_reused;
     };
     
     struct Line_Info
@@ -338,10 +432,51 @@ namespace jot
         JOT_FREE(original_ptr);
     }
     
+    namespace malloc_allocator_internal
+    {
+        //Mapped allocations are recognized purely from their size and align so no headers are needed
+        inline bool is_mapped(isize size, isize align) noexcept
+        {
+            #ifdef JOT_USE_MREMAP
+            return size >= Malloc_Allocator::MMAP_THRESHOLD && align <= memory_constants::PAGE;
+            #else
+            (void) size; (void) align;
+            return false;
+            #endif
+        }
+
+        inline size_t mapped_size(isize size) noexcept
+        {
+            return (size_t) div_round_up(size, memory_constants::PAGE) * memory_constants::PAGE;
+        }
+
+        //realloc keeps only the default malloc alignment
+        inline bool is_reallocable(isize size, isize align) noexcept
+        {
+            #ifdef JOT_REALLOC
+            return is_mapped(size, align) == false && align <= (isize) sizeof(size_t);
+            #else
+            (void) size; (void) align;
+            return false;
+            #endif
+        }
+    }
+
     void* Malloc_Allocator::allocate(isize size, isize align, Line_Info) noexcept
     {
         assert(size >= 0 && is_power_of_two(align));
-        void* out = aligned_malloc(size, align);
+        void* out = nullptr;
+        #ifdef JOT_USE_MREMAP
+        if(malloc_allocator_internal::is_mapped(size, align))
+        {
+            out = mmap(nullptr, malloc_allocator_internal::mapped_size(size), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(out == MAP_FAILED)
+                out = nullptr;
+        }
+        else
+        #endif
+            out = aligned_malloc(size, align);
+
         if(out == nullptr)
             return out;
 
@@ -357,25 +492,126 @@ namespace jot
     {
         assert(old_size > 0 && is_power_of_two(align));
         (void) old_size; (void) align; (void) callee;
-        aligned_free(allocated, align);
+        #ifdef JOT_USE_MREMAP
+        if(malloc_allocator_internal::is_mapped(old_size, align))
+            munmap(allocated, malloc_allocator_internal::mapped_size(old_size));
+        else
+        #endif
+            aligned_free(allocated, align);
+
         total_alloced -= old_size;
         deallocation_count ++;
         return true;
     }
 
-    bool Malloc_Allocator::resize(void* allocated, isize new_size, isize old_size, isize align, Line_Info callee) noexcept
+    bool Malloc_Allocator::resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept
     {
         assert(old_size > 0 && new_size >= 0 && is_power_of_two(align));
         (void) allocated; (void) new_size; (void) old_size; (void) align; (void) callee;
         resize_count++;
+
+        //Only mapped allocations can be resized in place (when the pages after them are free)
+        #ifdef JOT_USE_MREMAP
+        using namespace malloc_allocator_internal;
+        if(is_mapped(old_size, align) == false || is_mapped(new_size, align) == false)
+            return false;
+
+        size_t old_mapped = mapped_size(old_size);
+        size_t new_mapped = mapped_size(new_size);
+        if(old_mapped != new_mapped && mremap(allocated, old_mapped, new_mapped, 0) == MAP_FAILED)
+            return false;
+
+        total_alloced += new_size - old_size;
+        if(max_alloced < total_alloced)
+            max_alloced = total_alloced;
+        return true;
+        #else
         return false;
+        #endif
+    }
+
+    void* Malloc_Allocator::relocate(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept
+    {
+        assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
+        using namespace malloc_allocator_internal;
+        void* out = nullptr;
+        if(allocated == nullptr || old_size == 0 || new_size == 0)
+            return Allocator::relocate(allocated, old_size, new_size, align, callee);
+
+        #ifdef JOT_USE_MREMAP
+        //Moves the page table entries instead of copying the data
+        if(is_mapped(old_size, align) && is_mapped(new_size, align))
+        {
+            out = mremap(allocated, mapped_size(old_size), mapped_size(new_size), MREMAP_MAYMOVE);
+            if(out == MAP_FAILED)
+                return nullptr;
+        }
+        else
+        #endif
+        #ifdef JOT_REALLOC
+        if(is_reallocable(old_size, align) && is_reallocable(new_size, align))
+        {
+            out = JOT_REALLOC(allocated, (size_t) new_size);
+            if(out == nullptr)
+                return nullptr;
+        }
+        else
+        #endif
+            return Allocator::relocate(allocated, old_size, new_size, align, callee);
+
+        resize_count++;
+        total_alloced += new_size - old_size;
+        if(max_alloced < total_alloced)
+            max_alloced = total_alloced;
+        return out;
+    }
+
+    bool Malloc_Allocator::allocate_batch(isize count, isize size, isize align, void** out_ptrs, Line_Info callee) noexcept
+    {
+        assert(count >= 0 && size >= 0 && is_power_of_two(align));
+        //There is no batch interface to malloc so this only saves the dispatch per allocation
+        for(isize i = 0; i < count; i++)
+        {
+            out_ptrs[i] = Malloc_Allocator::allocate(size, align, callee);
+            if(out_ptrs[i] == nullptr)
+            {
+                Malloc_Allocator::deallocate_batch(i, size, align, out_ptrs, callee);
+                for(isize j = 0; j < count; j++)
+                    out_ptrs[j] = nullptr;
+
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Malloc_Allocator::deallocate_batch(isize count, isize old_size, isize align, void** allocated_ptrs, Line_Info callee) noexcept
+    {
+        assert(count >= 0 && old_size >= 0 && is_power_of_two(align));
+        for(isize i = 0; i < count; i++)
+            Malloc_Allocator::deallocate(allocated_ptrs[i], old_size, align, callee);
+
+        return true;
+    }
+
+    isize Malloc_Allocator::release_extra_memory() noexcept
+    {
+        //Mapped allocations are unmapped right away on deallocation so only malloc itself might cache memory.
+        // It does not report how much it released.
+        JOT_MALLOC_TRIM();
+        return 0;
     }
 
     Allocator_Stats Malloc_Allocator::get_stats() const noexcept
     {
         Allocator_Stats stats = {};
         stats.name = "Malloc_Allocator";
+        #ifdef JOT_USE_MREMAP
+        stats.supports_resize = true;
+        #else
         stats.supports_resize = false;
+        #endif
         stats.bytes_allocated = total_alloced;
         stats.max_bytes_allocated = max_alloced;
             
@@ -386,7 +622,56 @@ namespace jot
         return stats;
     }
 
-    static bool memory_resize_allocate(Allocator* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept
+    template<class A>
+    void* dispatch_allocate(A* alloc, isize size, isize align, Line_Info callee) noexcept
+    {
+        return alloc->A::allocate(size, align, callee);
+    }
+
+    template<class A>
+    bool dispatch_deallocate(A* alloc, void* allocated, isize old_size, isize align, Line_Info callee) noexcept
+    {
+        return alloc->A::deallocate(allocated, old_size, align, callee);
+    }
+
+    template<class A>
+    bool dispatch_resize(A* alloc, void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept
+    {
+        return alloc->A::resize(allocated, old_size, new_size, align, callee);
+    }
+
+    template<class A>
+    void* dispatch_relocate(A* alloc, void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept
+    {
+        //Allocator::relocate would call back into the allocator virtually
+        if(has_own_relocate<A>)
+            return alloc->A::relocate(allocated, old_size, new_size, align, callee);
+        else
+            return relocate_default(alloc, allocated, old_size, new_size, align, callee);
+    }
+
+    inline void* dispatch_allocate(Allocator* alloc, isize size, isize align, Line_Info callee) noexcept
+    {
+        return alloc->allocate(size, align, callee);
+    }
+
+    inline bool dispatch_deallocate(Allocator* alloc, void* allocated, isize old_size, isize align, Line_Info callee) noexcept
+    {
+        return alloc->deallocate(allocated, old_size, align, callee);
+    }
+
+    inline bool dispatch_resize(Allocator* alloc, void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept
+    {
+        return alloc->resize(allocated, old_size, new_size, align, callee);
+    }
+
+    inline void* dispatch_relocate(Allocator* alloc, void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept
+    {
+        return alloc->relocate(allocated, old_size, new_size, align, callee);
+    }
+
+    template<class A>
+    static bool memory_resize_allocate(A* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept
     {
         assert(alloc != nullptr && new_allocated != nullptr);
         assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
@@ -399,18 +684,19 @@ namespace jot
 
         if(old_allocated != nullptr && old_size != 0)
         {
-            if(alloc->resize(old_allocated, old_size, new_size, align, callee))
+            if(dispatch_resize(alloc, old_allocated, old_size, new_size, align, callee))
             {
                 *new_allocated = old_allocated;
                 return true;
             }
         }
 
-        *new_allocated = alloc->allocate(new_size, align, callee);
+        *new_allocated = dispatch_allocate(alloc, new_size, align, callee);
         return *new_allocated != nullptr;
     }
     
-    static bool memory_resize_deallocate(Allocator* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept
+    template<class A>
+    static bool memory_resize_deallocate(A* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept
     {
         assert(alloc != nullptr && new_allocated != nullptr);
         assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
@@ -419,12 +705,13 @@ namespace jot
             return true;
 
         if(new_size == 0 || *new_allocated != old_allocated)
-            return alloc->deallocate(old_allocated, old_size, align, callee);
+            return dispatch_deallocate(alloc, old_allocated, old_size, align, callee);
 
         return true;
     }
     
-    static bool memory_resize_undo(Allocator* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept
+    template<class A>
+    static bool memory_resize_undo(A* alloc, void** new_allocated, isize new_size, void* old_allocated, isize old_size, isize align, Line_Info callee) noexcept
     {
         assert(alloc != nullptr && new_allocated != nullptr);
         assert(old_size >= 0 && new_size >= 0 && is_power_of_two(align));
@@ -435,13 +722,19 @@ namespace jot
 
         //if resized resize back down
         if(*new_allocated == old_allocated)
-            return alloc->resize(*new_allocated, new_size, old_size, align, callee);
+            return dispatch_resize(alloc, *new_allocated, new_size, old_size, align, callee);
         
         //else deallocate newly allocated
-        return alloc->deallocate(*new_allocated, new_size, align, callee);
+        return dispatch_deallocate(alloc, *new_allocated, new_size, align, callee);
     }
     
     static void* reallocate(Allocator* alloc, void* old_allocated, isize new_size, isize old_size, isize align, Line_Info callee) noexcept
+    {
+        return alloc->relocate(old_allocated, old_size, new_size, align, callee);
+    }
+
+    template<class A>
+    static void* relocate_default(A* alloc, void* old_allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept
     {
         void* out = nullptr;
         if(memory_resize_allocate(alloc, &out, new_size, old_allocated, old_size, align, callee))
@@ -458,6 +751,40 @@ namespace jot
 
         return out;
     }
+
+    inline void* Allocator::relocate(void* old_allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept
+    {
+        return relocate_default(this, old_allocated, old_size, new_size, align, callee);
+    }
+
+    inline bool Allocator::allocate_batch(isize count, isize size, isize align, void** out_ptrs, Line_Info callee) noexcept
+    {
+        assert(count >= 0 && size >= 0 && is_power_of_two(align));
+        for(isize i = 0; i < count; i++)
+        {
+            out_ptrs[i] = allocate(size, align, callee);
+            if(out_ptrs[i] == nullptr)
+            {
+                deallocate_batch(i, size, align, out_ptrs, callee);
+                for(isize j = 0; j < count; j++)
+                    out_ptrs[j] = nullptr;
+
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    inline bool Allocator::deallocate_batch(isize count, isize old_size, isize align, void** allocated_ptrs, Line_Info callee) noexcept
+    {
+        assert(count >= 0 && old_size >= 0 && is_power_of_two(align));
+        bool state = true;
+        for(isize i = 0; i < count; i++)
+            state = deallocate(allocated_ptrs[i], old_size, align, callee) && state;
+
+        return state;
+    }
     
     namespace memory_globals
     {
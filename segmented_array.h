@@ -0,0 +1,332 @@
+#pragma once
+
+#include "memory.h"
+#include "slice.h"
+#include "intrin.h"
+
+namespace jot
+{
+    ///Growable array which never moves its items. Items are stored in segments of geometrically increasing size
+    /// so push is O(1) without the copy spikes of Array and pointers to items stay valid until the item is popped.
+    ///Indexing costs one find last set and one extra indirection compared to Array.
+    template<typename T>
+    struct Segmented_Array
+    {
+        //Segment k holds FIRST_SEGMENT_SIZE << k items. Thus the first k segments hold together
+        // FIRST_SEGMENT_SIZE * (2^k - 1) items and the segment of index i is the position of the highest
+        // set bit of (i + FIRST_SEGMENT_SIZE) minus FIRST_SEGMENT_LOG2.
+        //
+        //  segment:  0          1                      2
+        //  items:   [0 .. 15]  [16 ............ 47]   [48 .............................. 111]
+        //
+        //The segment pointers are stored inline. That way lookup touches only this struct and the item itself
+        // and growing never needs to reallocate a table.
+
+        static constexpr isize FIRST_SEGMENT_LOG2 = 4;
+        static constexpr isize FIRST_SEGMENT_SIZE = (isize) 1 << FIRST_SEGMENT_LOG2;
+        static constexpr isize MAX_SEGMENTS = 48;
+
+        T* _segments[MAX_SEGMENTS] = {nullptr};
+        Allocator* _allocator = nullptr;
+        isize _size = 0;
+        isize _segment_count = 0; //number of allocated segments
+
+        explicit Segmented_Array(Allocator* alloc = default_allocator()) noexcept
+            : _allocator(alloc) {}
+
+        Segmented_Array(Segmented_Array && other) noexcept;
+        Segmented_Array(Segmented_Array const& other);
+        ~Segmented_Array() noexcept;
+
+        Segmented_Array& operator=(Segmented_Array && other) noexcept;
+        Segmented_Array& operator=(Segmented_Array const& other);
+
+        T const& operator[](isize index) const noexcept;
+        T& operator[](isize index) noexcept;
+    };
+
+    struct Segment_Index
+    {
+        isize segment;
+        isize offset;
+    };
+
+    ///Getters
+    template<class T> isize      size(Segmented_Array<T> const& array) noexcept       { return array._size; }
+    template<class T> isize      size(Segmented_Array<T>* array) noexcept             { return array->_size; }
+    template<class T> Allocator* allocator(Segmented_Array<T> const& array) noexcept  { return array._allocator; }
+    template<class T> isize      segment_count(Segmented_Array<T> const& array) noexcept { return array._segment_count; }
+    template<class T> isize      capacity(Segmented_Array<T> const& array) noexcept;
+
+    ///Returns the segment and offset within it of item at index
+    template<class T> Segment_Index to_segment_index(Segmented_Array<T> const& array, isize index) noexcept;
+
+    ///Returns the used items of the segment_i-th segment. Iterate all items by iterating all segments
+    /// from 0 to segment_count. The slices of segments past the last item are empty.
+    template<class T> Slice<const T> segment(Segmented_Array<T> const& array, isize segment_i) noexcept;
+    template<class T> Slice<T>       segment(Segmented_Array<T>* array, isize segment_i) noexcept;
+
+    ///Get last item. Cannot be used on empty array!
+    template<class T> T*       last(Segmented_Array<T>* array) noexcept        { return &(*array)[array->_size - 1]; }
+    template<class T> T const& last(Segmented_Array<T> const& array) noexcept  { return array[array._size - 1]; }
+
+    template<class T> bool is_invariant(Segmented_Array<T> const& array) noexcept;
+    template<class T> bool is_empty(Segmented_Array<T> const& array) noexcept  { return array._size == 0; }
+
+    ///Allocates segments so that capacity is at least to_capacity. Never moves existing items
+    template<class T> bool reserve_failing(Segmented_Array<T>* array, isize to_capacity) noexcept;
+    template<class T> void reserve(Segmented_Array<T>* array, isize to_capacity);
+
+    ///Adds an item to the end of the array and returns pointer to it. The pointer stays valid until the item is popped
+    template<class T> T*   push(Segmented_Array<T>* array, Id<T> what);
+    ///Removes an item at the end array. The array must not be empty!
+    template<class T> T    pop(Segmented_Array<T>* array) noexcept;
+    ///Removes all items keeping the segments
+    template<class T> void clear(Segmented_Array<T>* array) noexcept;
+    ///Deallocates all segments that hold no items
+    template<class T> void shrink_to_fit(Segmented_Array<T>* array) noexcept;
+
+    template<class T> void swap(Segmented_Array<T>* left, Segmented_Array<T>* right) noexcept;
+}
+
+namespace jot
+{
+    namespace segmented_array_internal
+    {
+        template<class T> constexpr
+        isize segment_size(isize segment_i) noexcept
+        {
+            return Segmented_Array<T>::FIRST_SEGMENT_SIZE << segment_i;
+        }
+
+        //number of items in all segments before segment_i
+        template<class T> constexpr
+        isize segment_start(isize segment_i) noexcept
+        {
+            return segment_size<T>(segment_i) - Segmented_Array<T>::FIRST_SEGMENT_SIZE;
+        }
+    }
+
+    template<class T>
+    Segment_Index to_segment_index(Segmented_Array<T> const& array, isize index) noexcept
+    {
+        (void) array;
+        assert(index >= 0);
+        uint64_t biased = (uint64_t) index + (uint64_t) Segmented_Array<T>::FIRST_SEGMENT_SIZE;
+
+        size_t highest = 0;
+        intrin__find_last_set_64(&highest, biased);
+
+        Segment_Index out = {};
+        out.segment = (isize) highest - Segmented_Array<T>::FIRST_SEGMENT_LOG2;
+        out.offset = (isize) (biased - ((uint64_t) 1 << highest));
+        return out;
+    }
+
+    template<class T>
+    T const& Segmented_Array<T>::operator[](isize index) const noexcept
+    {
+        assert(0 <= index && index < _size && "index out of range");
+        Segment_Index at = to_segment_index(*this, index);
+        return _segments[at.segment][at.offset];
+    }
+
+    template<class T>
+    T& Segmented_Array<T>::operator[](isize index) noexcept
+    {
+        assert(0 <= index && index < _size && "index out of range");
+        Segment_Index at = to_segment_index(*this, index);
+        return _segments[at.segment][at.offset];
+    }
+
+    template<class T>
+    isize capacity(Segmented_Array<T> const& array) noexcept
+    {
+        return segmented_array_internal::segment_start<T>(array._segment_count);
+    }
+
+    template<class T>
+    Slice<const T> segment(Segmented_Array<T> const& array, isize segment_i) noexcept
+    {
+        assert(0 <= segment_i && segment_i < array._segment_count);
+        isize from = segmented_array_internal::segment_start<T>(segment_i);
+        isize used = min(max(array._size - from, 0), segmented_array_internal::segment_size<T>(segment_i));
+        return Slice<const T>{array._segments[segment_i], used};
+    }
+
+    template<class T>
+    Slice<T> segment(Segmented_Array<T>* array, isize segment_i) noexcept
+    {
+        assert(0 <= segment_i && segment_i < array->_segment_count);
+        isize from = segmented_array_internal::segment_start<T>(segment_i);
+        isize used = min(max(array->_size - from, 0), segmented_array_internal::segment_size<T>(segment_i));
+        return Slice<T>{array->_segments[segment_i], used};
+    }
+
+    template<class T>
+    bool is_invariant(Segmented_Array<T> const& array) noexcept
+    {
+        bool size_inv = 0 <= array._size && array._size <= capacity(array);
+        bool count_inv = 0 <= array._segment_count && array._segment_count <= Segmented_Array<T>::MAX_SEGMENTS;
+        bool segments_inv = true;
+        for(isize i = 0; i < Segmented_Array<T>::MAX_SEGMENTS; i++)
+            segments_inv = segments_inv && ((i < array._segment_count) == (array._segments[i] != nullptr));
+
+        bool result = size_inv && count_inv && segments_inv;
+        assert(result);
+        return result;
+    }
+
+    template<class T>
+    bool reserve_failing(Segmented_Array<T>* array, isize to_capacity) noexcept
+    {
+        assert(is_invariant(*array));
+        while(capacity(*array) < to_capacity)
+        {
+            isize segment_i = array->_segment_count;
+            if(segment_i >= Segmented_Array<T>::MAX_SEGMENTS)
+                return false;
+
+            isize bytes = segmented_array_internal::segment_size<T>(segment_i) * (isize) sizeof(T);
+            T* allocated = (T*) array->_allocator->allocate(bytes, (isize) alignof(T), GET_LINE_INFO());
+            if(allocated == nullptr)
+                return false;
+
+            array->_segments[segment_i] = allocated;
+            array->_segment_count += 1;
+        }
+
+        assert(is_invariant(*array));
+        return true;
+    }
+
+    template<class T>
+    void reserve(Segmented_Array<T>* array, isize to_capacity)
+    {
+        if(reserve_failing(array, to_capacity) == false)
+        {
+            const char* alloc_name = array->_allocator->get_stats().name;
+            memory_globals::out_of_memory_hadler()(GET_LINE_INFO(),
+                "Segmented_Array<T> memory allocation failed! "
+                "Attempted to allocate segment number %t from allocator %p name %s "
+                "Segmented_Array: {size: %t, capacity: %t} sizeof(T): %z",
+                array->_segment_count, array->_allocator,
+                alloc_name ? alloc_name : "<No alloc name>",
+                array->_size, capacity(*array), sizeof(T));
+        }
+    }
+
+    template<class T>
+    T* push(Segmented_Array<T>* array, Id<T> what)
+    {
+        if(array->_size >= capacity(*array))
+            reserve(array, array->_size + 1);
+
+        Segment_Index at = to_segment_index(*array, array->_size);
+        T* pushed = array->_segments[at.segment] + at.offset;
+        new(pushed) T((T&&) what);
+        array->_size += 1;
+        return pushed;
+    }
+
+    template<class T>
+    T pop(Segmented_Array<T>* array) noexcept
+    {
+        assert(array->_size > 0);
+        T* popped = last(array);
+        T out = (T&&) *popped;
+        popped->~T();
+        array->_size -= 1;
+        return out;
+    }
+
+    template<class T>
+    void clear(Segmented_Array<T>* array) noexcept
+    {
+        for(isize i = 0; i < array->_segment_count; i++)
+        {
+            Slice<T> items = segment(array, i);
+            for(isize j = 0; j < items.size; j++)
+                items[j].~T();
+        }
+
+        array->_size = 0;
+    }
+
+    template<class T>
+    void shrink_to_fit(Segmented_Array<T>* array) noexcept
+    {
+        isize used_segments = 0;
+        if(array->_size > 0)
+            used_segments = to_segment_index(*array, array->_size - 1).segment + 1;
+
+        for(isize i = used_segments; i < array->_segment_count; i++)
+        {
+            isize bytes = segmented_array_internal::segment_size<T>(i) * (isize) sizeof(T);
+            array->_allocator->deallocate(array->_segments[i], bytes, (isize) alignof(T), GET_LINE_INFO());
+            array->_segments[i] = nullptr;
+        }
+
+        array->_segment_count = used_segments;
+        assert(is_invariant(*array));
+    }
+
+    template<class T>
+    void swap(Segmented_Array<T>* left, Segmented_Array<T>* right) noexcept
+    {
+        for(isize i = 0; i < Segmented_Array<T>::MAX_SEGMENTS; i++)
+            swap(&left->_segments[i], &right->_segments[i]);
+
+        swap(&left->_allocator, &right->_allocator);
+        swap(&left->_size, &right->_size);
+        swap(&left->_segment_count, &right->_segment_count);
+    }
+
+    template<class T>
+    Segmented_Array<T>::~Segmented_Array() noexcept
+    {
+        clear(this);
+        shrink_to_fit(this);
+    }
+
+    template<class T>
+    Segmented_Array<T>::Segmented_Array(Segmented_Array && other) noexcept
+        : _allocator(other._allocator)
+    {
+        swap(this, &other);
+    }
+
+    template<class T>
+    Segmented_Array<T>::Segmented_Array(Segmented_Array const& other)
+        : _allocator(default_allocator())
+    {
+        *this = other;
+    }
+
+    template<class T>
+    Segmented_Array<T>& Segmented_Array<T>::operator=(Segmented_Array && other) noexcept
+    {
+        swap(this, &other);
+        return *this;
+    }
+
+    template<class T>
+    Segmented_Array<T>& Segmented_Array<T>::operator=(Segmented_Array const& other)
+    {
+        if(this == &other)
+            return *this;
+
+        clear(this);
+        reserve(this, other._size);
+        for(isize i = 0; i < other._segment_count; i++)
+        {
+            Slice<const T> items = segment(other, i);
+            T* to = _segments[i];
+            for(isize j = 0; j < items.size; j++)
+                new(to + j) T(items[j]);
+        }
+
+        _size = other._size;
+        return *this;
+    }
+}
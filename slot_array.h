@@ -19,6 +19,8 @@ namespace jot
     template<typename T>
     struct Slot_Array
     {
+        static_assert(is_self_referential<T> == false, "Slot_Array moves its items with memcpy so they must not point into themselves");
+
         T* _data = nullptr;
         slot_array_internal::Slot* _slots = nullptr;
         Allocator* _allocator = default_allocator();
@@ -0,0 +1,265 @@
+#pragma once
+
+#include "array.h"
+
+namespace jot
+{
+    ///Allocator owning a single fixed size inline buffer. Hands out the buffer when it is free and the request fits
+    /// otherwise forwards to parent. Used by Small_Array to keep its first items inline.
+    template <isize BUFFER_SIZE, isize BUFFER_ALIGN>
+    struct Inline_Allocator : Allocator
+    {
+        alignas(BUFFER_ALIGN) uint8_t buffer[BUFFER_SIZE];
+        Allocator* parent = nullptr;
+        bool is_buffer_used = false;
+
+        explicit Inline_Allocator(Allocator* parent = default_allocator()) noexcept
+            : parent(parent) {}
+
+        Inline_Allocator(Inline_Allocator const&) = delete;
+        Inline_Allocator& operator=(Inline_Allocator const&) = delete;
+
+        bool fits(isize size, isize align) const noexcept
+        {
+            return size <= BUFFER_SIZE && align <= BUFFER_ALIGN;
+        }
+
+        virtual
+        void* allocate(isize size, isize align, Line_Info callee) noexcept override
+        {
+            if(is_buffer_used == false && fits(size, align))
+            {
+                is_buffer_used = true;
+                return buffer;
+            }
+
+            return parent->allocate(size, align, callee);
+        }
+
+        virtual
+        bool deallocate(void* allocated, isize old_size, isize align, Line_Info callee) noexcept override
+        {
+            if(allocated == buffer)
+            {
+                is_buffer_used = false;
+                return true;
+            }
+
+            return parent->deallocate(allocated, old_size, align, callee);
+        }
+
+        virtual
+        bool resize(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            if(allocated == buffer)
+                return fits(new_size, align);
+
+            return parent->resize(allocated, old_size, new_size, align, callee);
+        }
+
+        //Moves between the buffer and parent in both directions so that shrinking a spilled array
+        // back under the inline capacity brings it back inline.
+        virtual
+        void* relocate(void* allocated, isize old_size, isize new_size, isize align, Line_Info callee) noexcept override
+        {
+            if(allocated == nullptr || old_size == 0)
+                return allocate(new_size, align, callee);
+
+            if(allocated == buffer)
+            {
+                if(fits(new_size, align))
+                    return buffer;
+
+                void* out = parent->allocate(new_size, align, callee);
+                if(out != nullptr)
+                {
+                    memcpy(out, buffer, (size_t) min(old_size, new_size));
+                    is_buffer_used = false;
+                }
+                return out;
+            }
+
+            if(is_buffer_used == false && fits(new_size, align))
+            {
+                memcpy(buffer, allocated, (size_t) min(old_size, new_size));
+                parent->deallocate(allocated, old_size, align, callee);
+                is_buffer_used = true;
+                return buffer;
+            }
+
+            return parent->relocate(allocated, old_size, new_size, align, callee);
+        }
+
+        virtual
+        Allocator_Stats get_stats() const noexcept override
+        {
+            Allocator_Stats stats = {};
+            stats.name = "Inline_Allocator";
+            stats.supports_resize = true;
+            stats.parent = parent;
+            stats.bytes_used = BUFFER_SIZE;
+            stats.max_bytes_used = BUFFER_SIZE;
+            return stats;
+        }
+
+        virtual
+        ~Inline_Allocator() noexcept override {}
+    };
+
+    namespace small_array_internal
+    {
+        template <typename T>
+        constexpr isize inline_bytes(isize capacity) noexcept
+        {
+            return (capacity + (isize) is_string_char<T>) * (isize) sizeof(T);
+        }
+
+        //Separate base so that the inline allocator is constructed before and destroyed after the Array
+        template <typename T, isize N>
+        struct Inline_Storage
+        {
+            Inline_Allocator<inline_bytes<T>(N), (isize) alignof(T)> _inline;
+
+            explicit Inline_Storage(Allocator* parent) noexcept : _inline(parent) {}
+        };
+    }
+
+    ///Array storing up to N items inline without allocating. Past N spills to the parent allocator.
+    /// Is an Array<T> so all of the array.h functions work on it and it can be passed as Array<T>*
+    /// (or String_Builder* for Small_String) to existing code. The only exceptions are moves and swaps through
+    /// the Array<T> base (ie. *array = Array<T>()) which would move the inline buffer pointer out of this object.
+    /// For the same reason it must not be stored in containers moving their items with memcpy/memmove such as 
+    /// Hash_Table or Slot_Array (see is_self_referential).
+    template <typename T_, isize N>
+    struct Small_Array : small_array_internal::Inline_Storage<T_, N>, Array<T_>
+    {
+        static_assert(N > 0, "inline capacity must be positive");
+
+        using T = T_;
+        using Storage = small_array_internal::Inline_Storage<T_, N>;
+        static constexpr isize INLINE_CAPACITY = N;
+
+        explicit Small_Array(Allocator* parent = default_allocator()) noexcept;
+        Small_Array(Small_Array && other) noexcept;
+        Small_Array(Small_Array const& other);
+
+        Small_Array& operator=(Small_Array && other) noexcept;
+        Small_Array& operator=(Small_Array const& other);
+    };
+
+    template <isize N>
+    using Small_String = Small_Array<char, N>;
+
+    template<class T, isize N> static constexpr bool is_trivially_relocatable<Small_Array<T, N>> = false;
+    template<class T, isize N> static constexpr bool is_self_referential<Small_Array<T, N>> = true;
+
+    ///Returns true if the items are stored inline
+    template<class T, isize N> bool is_inline(Small_Array<T, N> const& array) noexcept;
+
+    ///Swaps the contents of two small arrays. Inline items are moved one by one, spilled ones by pointer
+    template<class T, isize N> void swap(Small_Array<T, N>* left, Small_Array<T, N>* right) noexcept;
+}
+
+namespace jot
+{
+    namespace small_array_internal
+    {
+        template <typename T, isize N>
+        void set_inline(Small_Array<T, N>* array) noexcept
+        {
+            array->_inline.is_buffer_used = true;
+            array->_data = (T*) (void*) array->_inline.buffer;
+            array->_capacity = N;
+            array->_size = 0;
+            array_internal::null_terminate(array);
+        }
+
+        //Moves all items of from into to which must be empty and inline. Leaves from empty and inline.
+        template <typename T, isize N>
+        void take(Small_Array<T, N>* to, Small_Array<T, N>* from) noexcept
+        {
+            assert(size(*to) == 0 && is_inline(*to));
+            if(is_inline(*from))
+            {
+                if(is_trivially_relocatable<T>)
+                    memcpy((void*) to->_data, (void*) from->_data, (size_t) from->_size * sizeof(T));
+                else
+                    for(isize i = 0; i < from->_size; i++)
+                        new(to->_data + i) T((T&&) from->_data[i]);
+
+                to->_size = from->_size;
+                array_internal::null_terminate(to);
+
+                if(is_trivially_relocatable<T>)
+                    from->_size = 0;
+                clear(from);
+                return;
+            }
+
+            //The parents must match since the spilled memory will be freed by the parent of to
+            to->_inline.is_buffer_used = false;
+            to->_inline.parent = from->_inline.parent;
+            to->_data = from->_data;
+            to->_size = from->_size;
+            to->_capacity = from->_capacity;
+            set_inline(from);
+        }
+    }
+
+    template <typename T, isize N>
+    Small_Array<T, N>::Small_Array(Allocator* parent) noexcept
+        : Storage(parent), Array<T>(&this->_inline)
+    {
+        small_array_internal::set_inline(this);
+    }
+
+    template <typename T, isize N>
+    Small_Array<T, N>::Small_Array(Small_Array && other) noexcept
+        : Storage(other._inline.parent), Array<T>(&this->_inline)
+    {
+        small_array_internal::set_inline(this);
+        small_array_internal::take(this, &other);
+    }
+
+    template <typename T, isize N>
+    Small_Array<T, N>::Small_Array(Small_Array const& other)
+        : Storage(other._inline.parent), Array<T>(&this->_inline)
+    {
+        small_array_internal::set_inline(this);
+        copy(this, slice(other));
+    }
+
+    template <typename T, isize N>
+    Small_Array<T, N>& Small_Array<T, N>::operator=(Small_Array && other) noexcept
+    {
+        if(this == &other)
+            return *this;
+
+        clear(this);
+        set_capacity(this, 0);
+        small_array_internal::set_inline(this);
+        small_array_internal::take(this, &other);
+        return *this;
+    }
+
+    template <typename T, isize N>
+    Small_Array<T, N>& Small_Array<T, N>::operator=(Small_Array const& other)
+    {
+        copy(this, slice(other));
+        return *this;
+    }
+
+    template<class T, isize N>
+    bool is_inline(Small_Array<T, N> const& array) noexcept
+    {
+        return (const void*) array._data == (const void*) array._inline.buffer;
+    }
+
+    template<class T, isize N>
+    void swap(Small_Array<T, N>* left, Small_Array<T, N>* right) noexcept
+    {
+        Small_Array<T, N> temp = (Small_Array<T, N>&&) *left;
+        *left = (Small_Array<T, N>&&) *right;
+        *right = (Small_Array<T, N>&&) temp;
+    }
+}
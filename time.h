@@ -94,7 +94,7 @@ namespace jot
         struct timespec ts;
         (void) clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
 
-        return ts.tv_nsec;
+        return (int64_t) ts.tv_sec * 1'000'000'000 + ts.tv_nsec;
     }
 
     inline int64_t clock_ns()
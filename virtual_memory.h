@@ -0,0 +1,372 @@
+#pragma once
+
+#include "memory.h"
+
+//Thin wrapper around the platform virtual memory api.
+//Address space is first reserved (no memory is used and any access faults)
+// then parts of it get committed (backed by physical memory on first touch)
+// and decommitted (physical memory returned to the os but the address range stays reserved).
+//All addresses and sizes passed in must be multiples of virtual_page_size()
+// with the exception of sizes passed to virtual_reserve
+namespace jot
+{
+    enum class Page_Backing : uint8_t
+    {
+        NORMAL,
+        TRANSPARENT_HUGE, //normal mapping advised to be backed by huge pages (linux THP)
+        HUGE,             //explicit huge page mapping (linux hugetlbfs, windows large pages)
+    };
+
+    ///Returns the granularity of commit/decommit
+    inline isize virtual_page_size() noexcept;
+
+    ///Reserves size bytes of address space. Returns nullptr on failure
+    inline void* virtual_reserve(isize size) noexcept;
+    ///Releases the entire reservation previously obtained from virtual_reserve
+    inline bool virtual_release(void* reserved, isize size) noexcept;
+
+    ///Makes the range readable and writable
+    inline bool virtual_commit(void* address, isize size) noexcept;
+    ///Returns the physical memory of the range to the os. The range becomes inaccessible again
+    inline bool virtual_decommit(void* address, isize size) noexcept;
+    ///Tells the os the contents of the range are no longer needed so its physical memory can be reused.
+    /// The range stays accessible but its contents become undefined. Can be used on any writable memory 
+    /// and the range does not need to be page aligned: only the whole pages within it are discarded.
+    /// Returns the number of bytes discarded
+    inline isize virtual_discard(void* address, isize size) noexcept;
+
+    ///Allocates committed pages aligned to align (which must be at least virtual_page_size()).
+    /// Tries to obtain the preferred backing falling back HUGE -> TRANSPARENT_HUGE -> NORMAL.
+    /// The backing actually obtained is written to obtained. When huge backing is preferred size 
+    /// should be a multiple of memory_constants::HUGE_PAGE. Returns nullptr on failure
+    inline void* virtual_allocate_pages(isize size, isize align, Page_Backing preferred, Page_Backing* obtained) noexcept;
+    ///Frees pages obtained from virtual_allocate_pages
+    inline bool virtual_free_pages(void* address, isize size, Page_Backing backing) noexcept;
+
+    ///Advises the whole huge pages within the range to be backed by transparent huge pages. The range can be 
+    /// any writable memory. Returns the number of bytes advised (0 if transparent huge pages are not available)
+    inline isize virtual_advise_huge_pages(void* address, isize size) noexcept;
+    ///Returns true if the os will back TRANSPARENT_HUGE mappings with huge pages
+    inline bool is_transparent_huge_page_enabled() noexcept;
+
+    ///Returns the most physical memory (resident set size) the process used so far in bytes or 0 if unknown
+    inline isize process_peak_resident_size() noexcept;
+    ///Returns the physical memory (resident set size) the process currently uses in bytes or 0 if unknown
+    inline isize process_resident_size() noexcept;
+}
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+#include <windows.h>
+#include <psapi.h>
+namespace jot
+{
+    inline isize virtual_page_size() noexcept
+    {
+        static isize page_size = 0;
+        if(page_size == 0)
+        {
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            page_size = (isize) info.dwPageSize;
+        }
+        return page_size;
+    }
+
+    inline void* virtual_reserve(isize size) noexcept
+    {
+        return VirtualAlloc(nullptr, (SIZE_T) size, MEM_RESERVE, PAGE_NOACCESS);
+    }
+
+    inline bool virtual_release(void* reserved, isize) noexcept
+    {
+        return VirtualFree(reserved, 0, MEM_RELEASE) != 0;
+    }
+
+    inline bool virtual_commit(void* address, isize size) noexcept
+    {
+        return VirtualAlloc(address, (SIZE_T) size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+    }
+
+    inline bool virtual_decommit(void* address, isize size) noexcept
+    {
+        return VirtualFree(address, (SIZE_T) size, MEM_DECOMMIT) != 0;
+    }
+
+    inline isize virtual_discard(void* address, isize size) noexcept
+    {
+        uint8_t* from = (uint8_t*) align_forward(address, virtual_page_size());
+        uint8_t* to = (uint8_t*) align_backward((uint8_t*) address + size, virtual_page_size());
+        if(from >= to)
+            return 0;
+
+        if(VirtualAlloc(from, (SIZE_T) (to - from), MEM_RESET, PAGE_READWRITE) == nullptr)
+            return 0;
+
+        return to - from;
+    }
+    
+    inline bool is_transparent_huge_page_enabled() noexcept
+    {
+        return false;
+    }
+
+    inline isize virtual_advise_huge_pages(void*, isize) noexcept
+    {
+        return 0;
+    }
+
+    inline isize process_peak_resident_size() noexcept
+    {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        if(K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == false)
+            return 0;
+
+        return (isize) counters.PeakWorkingSetSize;
+    }
+
+    inline isize process_resident_size() noexcept
+    {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        if(K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == false)
+            return 0;
+
+        return (isize) counters.WorkingSetSize;
+    }
+
+    inline void* virtual_allocate_pages(isize size, isize align, Page_Backing preferred, Page_Backing* obtained) noexcept
+    {
+        //Large pages require SeLockMemoryPrivilege so this fails for most processes
+        SIZE_T large_page = GetLargePageMinimum();
+        if(preferred != Page_Backing::NORMAL && large_page != 0 && size % (isize) large_page == 0 && align <= (isize) large_page)
+        {
+            void* out = VirtualAlloc(nullptr, (SIZE_T) size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if(out != nullptr)
+            {
+                *obtained = Page_Backing::HUGE;
+                return out;
+            }
+        }
+
+        *obtained = Page_Backing::NORMAL;
+        void* out = VirtualAlloc(nullptr, (SIZE_T) size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if(out == nullptr || ((uintptr_t) out & (uintptr_t) (align - 1)) == 0)
+            return out;
+
+        //Overaligned: reserve bigger range, release it and try to claim the aligned part of it. 
+        // Can race with other threads mapping memory so we try a few times
+        VirtualFree(out, 0, MEM_RELEASE);
+        for(int i = 0; i < 8; i++)
+        {
+            uint8_t* reserved = (uint8_t*) VirtualAlloc(nullptr, (SIZE_T) (size + align), MEM_RESERVE, PAGE_NOACCESS);
+            if(reserved == nullptr)
+                return nullptr;
+
+            uintptr_t aligned = ((uintptr_t) reserved + (uintptr_t) align - 1) & ~((uintptr_t) align - 1);
+            VirtualFree(reserved, 0, MEM_RELEASE);
+            out = VirtualAlloc((void*) aligned, (SIZE_T) size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if(out != nullptr)
+                return out;
+        }
+
+        return nullptr;
+    }
+
+    inline bool virtual_free_pages(void* address, isize, Page_Backing) noexcept
+    {
+        return VirtualFree(address, 0, MEM_RELEASE) != 0;
+    }
+}
+#else
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+namespace jot
+{
+    inline isize virtual_page_size() noexcept
+    {
+        static isize page_size = (isize) sysconf(_SC_PAGESIZE);
+        return page_size;
+    }
+
+    inline void* virtual_reserve(isize size) noexcept
+    {
+        //MAP_NORESERVE so that huge reservations dont count towards overcommit limits
+        void* reserved = mmap(nullptr, (size_t) size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(reserved == MAP_FAILED)
+            return nullptr;
+
+        return reserved;
+    }
+
+    inline bool virtual_release(void* reserved, isize size) noexcept
+    {
+        return munmap(reserved, (size_t) size) == 0;
+    }
+
+    inline bool virtual_commit(void* address, isize size) noexcept
+    {
+        return mprotect(address, (size_t) size, PROT_READ | PROT_WRITE) == 0;
+    }
+
+    inline bool virtual_decommit(void* address, isize size) noexcept
+    {
+        //MADV_DONTNEED drops the pages right away (they read as zero when committed again)
+        if(madvise(address, (size_t) size, MADV_DONTNEED) != 0)
+            return false;
+
+        return mprotect(address, (size_t) size, PROT_NONE) == 0;
+    }
+
+    inline isize virtual_discard(void* address, isize size) noexcept
+    {
+        uint8_t* from = (uint8_t*) align_forward(address, virtual_page_size());
+        uint8_t* to = (uint8_t*) align_backward((uint8_t*) address + size, virtual_page_size());
+        if(from >= to)
+            return 0;
+
+        if(madvise(from, (size_t) (to - from), MADV_DONTNEED) != 0)
+            return 0;
+
+        return to - from;
+    }
+
+    inline bool is_transparent_huge_page_enabled() noexcept
+    {
+        static int enabled = -1;
+        if(enabled == -1)
+        {
+            //contains for example: "always [madvise] never"
+            enabled = 0;
+            char buffer[128] = {0};
+            FILE* file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "rb");
+            if(file != nullptr)
+            {
+                size_t read = fread(buffer, 1, sizeof(buffer) - 1, file);
+                buffer[read] = '\0';
+                fclose(file);
+                enabled = read > 0 && strstr(buffer, "[never]") == nullptr;
+            }
+        }
+
+        return enabled == 1;
+    }
+
+    inline isize virtual_advise_huge_pages(void* address, isize size) noexcept
+    {
+        #ifdef MADV_HUGEPAGE
+        if(is_transparent_huge_page_enabled() == false)
+            return 0;
+
+        uint8_t* from = (uint8_t*) align_forward(address, memory_constants::HUGE_PAGE);
+        uint8_t* to = (uint8_t*) align_backward((uint8_t*) address + size, memory_constants::HUGE_PAGE);
+        if(from >= to)
+            return 0;
+
+        if(madvise(from, (size_t) (to - from), MADV_HUGEPAGE) != 0)
+            return 0;
+
+        return to - from;
+        #else
+        (void) address;
+        (void) size;
+        return 0;
+        #endif
+    }
+
+    inline isize process_peak_resident_size() noexcept
+    {
+        struct rusage usage = {};
+        if(getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+
+        #ifdef __APPLE__
+        return (isize) usage.ru_maxrss;
+        #else
+        return (isize) usage.ru_maxrss * 1024; //in kilobytes
+        #endif
+    }
+
+    inline isize process_resident_size() noexcept
+    {
+        #if defined(__APPLE__)
+        mach_task_basic_info_data_t info = {};
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS)
+            return 0;
+
+        return (isize) info.resident_size;
+        #else
+        //second field is the resident size in pages
+        FILE* statm = fopen("/proc/self/statm", "r");
+        if(statm == nullptr)
+            return 0;
+
+        long long total_pages = 0;
+        long long resident_pages = 0;
+        int read = fscanf(statm, "%lld %lld", &total_pages, &resident_pages);
+        fclose(statm);
+        if(read != 2)
+            return 0;
+
+        return (isize) resident_pages * virtual_page_size();
+        #endif
+    }
+
+    inline void* virtual_allocate_pages(isize size, isize align, Page_Backing preferred, Page_Backing* obtained) noexcept
+    {
+        //Huge tlb pages are always aligned to their size and need preallocated pool (vm.nr_hugepages)
+        #ifdef MAP_HUGETLB
+        if(preferred == Page_Backing::HUGE && size % memory_constants::HUGE_PAGE == 0 && align <= memory_constants::HUGE_PAGE)
+        {
+            void* out = mmap(nullptr, (size_t) size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if(out != MAP_FAILED)
+            {
+                *obtained = Page_Backing::HUGE;
+                return out;
+            }
+        }
+        #endif
+
+        //Map bigger range then trim it to the desired alignment
+        isize page = virtual_page_size();
+        isize map_size = size;
+        if(align > page)
+            map_size += align;
+
+        uint8_t* mapped = (uint8_t*) mmap(nullptr, (size_t) map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mapped == MAP_FAILED)
+            return nullptr;
+
+        uint8_t* aligned = mapped;
+        if(align > page)
+        {
+            aligned = (uint8_t*) (((uintptr_t) mapped + (uintptr_t) align - 1) & ~((uintptr_t) align - 1));
+            isize head = aligned - mapped;
+            isize tail = map_size - head - size;
+            if(head > 0) munmap(mapped, (size_t) head);
+            if(tail > 0) munmap(aligned + size, (size_t) tail);
+        }
+        
+        *obtained = Page_Backing::NORMAL;
+        #ifdef MADV_HUGEPAGE
+        if(preferred != Page_Backing::NORMAL && is_transparent_huge_page_enabled())
+        {
+            if(madvise(aligned, (size_t) size, MADV_HUGEPAGE) == 0)
+                *obtained = Page_Backing::TRANSPARENT_HUGE;
+        }
+        #endif
+
+        return aligned;
+    }
+
+    inline bool virtual_free_pages(void* address, isize size, Page_Backing) noexcept
+    {
+        return munmap(address, (size_t) size) == 0;
+    }
+}
+#endif